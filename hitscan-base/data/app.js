@@ -5,14 +5,22 @@ class RaceTimer {
     this.startTime = 0;
     this.timerInterval = null;
     this.updateInterval = null;
+    this.events = null;
     this.currentMode = "race";
     this.racers = [];
 
+    // Results are fetched as deltas: only entries newer than this.seq.
+    // A different race number from the server means start over.
+    this.results = [];
+    this.seq = 0;
+    this.raceNumber = null;
+
     this.initElements();
     this.attachEventListeners();
     this.loadRacers();
     this.loadMode();
     this.startPolling();
+    this.subscribe();
   }
 
   initElements() {
@@ -66,6 +74,7 @@ class RaceTimer {
       });
       if (response.ok) {
         this.currentMode = mode;
+        this.forgetResults();
         this.updateModeUI();
         await this.resetRace();
       }
@@ -91,22 +100,24 @@ class RaceTimer {
     });
   }
 
-  editRacers() {
-    const racersData = this.racers.map((r) => {
+  async editRacers() {
+    const changed = [];
+    this.racers.forEach((r) => {
       const newName = prompt(`Enter name for Racer ${r.id}:`, r.name);
-      return newName ? { id: r.id, name: newName } : r;
+      if (newName && newName !== r.name) changed.push({ id: r.id, name: newName });
     });
+    if (changed.length === 0) return;
 
-    racersData.forEach(async (racer) => {
-      try {
-        await fetch("/racers", {
-          method: "POST",
-          body: JSON.stringify(racer),
-        });
-      } catch (error) {
-        console.error("Failed to update racer:", error);
-      }
-    });
+    // One request for all names; the base station saves them together
+    try {
+      const response = await fetch("/racers", {
+        method: "PUT",
+        body: JSON.stringify(changed),
+      });
+      if (!response.ok) console.error("Failed to update racers:", response.status);
+    } catch (error) {
+      console.error("Failed to update racers:", error);
+    }
 
     this.loadRacers();
   }
@@ -114,41 +125,47 @@ class RaceTimer {
   async startRace() {
     try {
       const response = await fetch("/start");
-      if (response.ok) {
-        this.raceActive = true;
-        this.startTime = Date.now();
-        this.startBtn.disabled = true;
-        this.stopBtn.disabled = false;
-        this.statusEl.textContent = "RACING";
-        this.statusEl.style.color = "#00ff41";
-        this.clearResults();
-        this.startTimer();
-      }
+      if (response.ok) this.onRaceStarted();
     } catch (error) {
       console.error("Failed to start race:", error);
       this.showError();
     }
   }
 
+  // Also called for races started from another browser
+  onRaceStarted() {
+    if (this.raceActive) return;
+    this.raceActive = true;
+    this.startTime = Date.now();
+    this.startBtn.disabled = true;
+    this.stopBtn.disabled = false;
+    this.statusEl.textContent = "RACING";
+    this.statusEl.style.color = "#00ff41";
+    this.clearResults();
+    this.startTimer();
+  }
+
   async stopRace() {
     try {
       const response = await fetch("/stop");
-      if (response.ok) {
-        this.raceActive = false;
-        this.startBtn.disabled = false;
-        this.stopBtn.disabled = true;
-        this.statusEl.textContent = "STOPPED";
-        this.statusEl.style.color = "#ff0055";
-        this.stopTimer();
-      }
+      if (response.ok) this.onRaceStopped();
     } catch (error) {
       console.error("Failed to stop race:", error);
     }
   }
 
+  onRaceStopped() {
+    this.raceActive = false;
+    this.startBtn.disabled = false;
+    this.stopBtn.disabled = true;
+    this.statusEl.textContent = "STOPPED";
+    this.statusEl.style.color = "#ff0055";
+    this.stopTimer();
+  }
+
   async resetRace() {
     await this.stopRace();
-    this.timerEl.textContent = "00:00.000";
+    this.timerEl.textContent = "00:00.0000";
     this.statusEl.textContent = "IDLE";
     this.statusEl.style.color = "#fff";
     this.clearResults();
@@ -158,7 +175,7 @@ class RaceTimer {
   startTimer() {
     this.timerInterval = setInterval(() => {
       const elapsed = Date.now() - this.startTime;
-      this.timerEl.textContent = this.formatTime(elapsed);
+      this.timerEl.textContent = this.formatTime(elapsed * 1000);
     }, 10);
   }
 
@@ -169,22 +186,44 @@ class RaceTimer {
     }
   }
 
-  formatTime(ms) {
-    const totalSeconds = Math.floor(ms / 1000);
+  // Times from the base station are microseconds; show to 0.1ms
+  formatTime(us) {
+    const totalSeconds = Math.floor(us / 1000000);
     const minutes = Math.floor(totalSeconds / 60);
     const seconds = totalSeconds % 60;
-    const milliseconds = ms % 1000;
+    const fraction = Math.floor((us % 1000000) / 100);
 
-    return `${String(minutes).padStart(2, "0")}:${String(seconds).padStart(2, "0")}.${String(milliseconds).padStart(3, "0")}`;
+    return `${String(minutes).padStart(2, "0")}:${String(seconds).padStart(2, "0")}.${String(fraction).padStart(4, "0")}`;
+  }
+
+  forgetResults() {
+    this.results = [];
+    this.seq = 0;
   }
 
   async fetchResults() {
     try {
-      const response = await fetch("/results");
+      const response = await fetch(`/results?since=${this.seq}`);
       if (!response.ok) throw new Error("Failed to fetch results");
 
       const data = await response.json();
-      this.updateResults(data);
+      const race = response.headers.get("X-Race");
+      if (this.seq > 0 && race !== this.raceNumber) {
+        // New race since the last poll - this delta is relative to old data
+        this.forgetResults();
+        this.raceNumber = race;
+        return this.fetchResults();
+      }
+      this.raceNumber = race;
+
+      // A pushed crossing may have landed while this request was in flight
+      const reload = this.seq === 0;
+      const fresh = reload ? data : data.filter((entry) => entry.seq > this.seq);
+      this.seq = Math.max(this.seq, Number(response.headers.get("X-Seq")) || 0);
+      if (reload || fresh.length > 0) {
+        this.results = reload ? data : this.results.concat(fresh);
+        this.updateResults(this.results);
+      }
       this.updateConnection(true);
       this.lastUpdateEl.textContent = new Date().toLocaleTimeString();
     } catch (error) {
@@ -202,7 +241,7 @@ class RaceTimer {
 
     if (this.currentMode === "race") {
       // Race mode - show positions
-      this.resultsEl.innerHTML = results
+      this.resultsEl.innerHTML = [...results]
         .sort((a, b) => a.position - b.position)
         .map((result) => {
           const medal =
@@ -230,7 +269,7 @@ class RaceTimer {
       });
     } else {
       // Lap timer mode - show all laps
-      this.resultsEl.innerHTML = results
+      this.resultsEl.innerHTML = [...results]
         .sort((a, b) => b.timestamp - a.timestamp) // Most recent first
         .map((result, index) => {
           return `
@@ -290,6 +329,8 @@ class RaceTimer {
   }
 
   startPolling() {
+    if (this.updateInterval) return;
+
     // Poll for results every 250ms
     this.updateInterval = setInterval(() => {
       this.fetchResults();
@@ -298,6 +339,58 @@ class RaceTimer {
     // Initial fetch
     this.fetchResults();
   }
+
+  stopPolling() {
+    if (this.updateInterval) {
+      clearInterval(this.updateInterval);
+      this.updateInterval = null;
+    }
+  }
+
+  // Live events from /events. Polling stays as the fallback while the
+  // stream is down; every (re)connect resyncs from /results first.
+  subscribe() {
+    if (!window.EventSource) return;
+
+    this.events = new EventSource("/events");
+    this.events.addEventListener("open", () => {
+      this.stopPolling();
+      this.fetchResults();
+    });
+    this.events.addEventListener("error", () => {
+      this.updateConnection(false);
+      this.startPolling();
+    });
+
+    this.events.addEventListener("crossing", (event) => {
+      const entry = JSON.parse(event.data);
+      if (this.seq > 0 && entry.seq === this.seq + 1) {
+        this.seq = entry.seq;
+        this.results = this.results.concat([entry]);
+        this.updateResults(this.results);
+        this.lastUpdateEl.textContent = new Date().toLocaleTimeString();
+      } else if (entry.seq > this.seq) {
+        // Missed something (or nothing loaded yet) - fetch the gap
+        this.fetchResults();
+      }
+    });
+    this.events.addEventListener("mode", (event) => {
+      // Also for our own change: the server applies it after replying
+      const { mode } = JSON.parse(event.data);
+      this.currentMode = mode;
+      this.forgetResults();
+      this.updateModeUI();
+      this.fetchResults();
+    });
+    this.events.addEventListener("start", (event) => {
+      const { race } = JSON.parse(event.data);
+      this.raceNumber = String(race);
+      this.forgetResults();
+      this.onRaceStarted();
+      this.fetchResults();
+    });
+    this.events.addEventListener("stop", () => this.onRaceStopped());
+  }
 }
 
 // Initialize app when DOM is ready
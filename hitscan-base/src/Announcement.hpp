@@ -0,0 +1,309 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "RaceState.hpp"
+
+// ============================================================================
+// Announcement
+// ============================================================================
+// Spoken lap times ("<racer> - twenty three point four") assembled from a
+// small set of recorded clips: the numbers 0-19, the tens, "hundred",
+// "point", "racer" and optionally one name clip per racer. Hardware
+// independent: Announcer plays the phrases, tools/announcer_bench times
+// the assembly and the cache.
+class Announcement
+{
+public:
+    // Clip ids
+    static constexpr uint8_t NUMBER = 0;   // 0-19: the number itself
+    static constexpr uint8_t TENS = 20;    // 20-27: twenty .. ninety
+    static constexpr uint8_t HUNDRED = 28;
+    static constexpr uint8_t POINT = 29;
+    static constexpr uint8_t RACER = 30;   // "racer", before the number when there is no name clip
+    static constexpr uint8_t NAME = 31;    // 31-38: recorded name of each racer
+    static constexpr uint8_t PAUSE = 39;   // Not a file: a short silence
+    static constexpr uint8_t CLIP_COUNT = 40;
+
+    static constexpr uint8_t MAX_CLIPS = 12;
+    static constexpr uint64_t MAX_TIME_US = 999949999; // 999.9 s: longer laps are not read out
+
+    struct Phrase
+    {
+        uint8_t clips[MAX_CLIPS];
+        uint8_t length = 0;
+
+        void add(uint8_t clip)
+        {
+            if (length < MAX_CLIPS)
+                clips[length++] = clip;
+        }
+    };
+
+    // SD card path of a clip: /voice/7.wav, /voice/40.wav, /voice/point.wav,
+    // /voice/racer3.wav (names count from 1, like the web app)
+    static void clipPath(uint8_t clip, char *out, size_t size)
+    {
+        if (clip < TENS)
+            snprintf(out, size, "/voice/%u.wav", clip);
+        else if (clip < HUNDRED)
+            snprintf(out, size, "/voice/%u.wav", (clip - TENS + 2) * 10);
+        else if (clip == HUNDRED)
+            snprintf(out, size, "/voice/hundred.wav");
+        else if (clip == POINT)
+            snprintf(out, size, "/voice/point.wav");
+        else if (clip == RACER)
+            snprintf(out, size, "/voice/racer.wav");
+        else
+            snprintf(out, size, "/voice/racer%u.wav", clip - NAME + 1);
+    }
+
+    // 0-999 as words
+    static void number(uint16_t value, Phrase &phrase)
+    {
+        if (value >= 100)
+        {
+            phrase.add(NUMBER + value / 100);
+            phrase.add(HUNDRED);
+            value %= 100;
+            if (value == 0)
+                return;
+        }
+        if (value < 20)
+        {
+            phrase.add(NUMBER + value);
+            return;
+        }
+        phrase.add(TENS + value / 10 - 2);
+        if (value % 10)
+            phrase.add(NUMBER + value % 10);
+    }
+
+    // "<name> - 23.4", or "racer 3 - 23.4" without a name clip. Times are
+    // rounded to tenths; a time past MAX_TIME_US only says who it was.
+    static Phrase lap(uint8_t racerId, uint64_t timeUs, bool haveName)
+    {
+        Phrase phrase;
+        if (haveName)
+        {
+            phrase.add(NAME + racerId);
+        }
+        else
+        {
+            phrase.add(RACER);
+            number(racerId + 1, phrase);
+        }
+        if (timeUs > MAX_TIME_US)
+            return phrase;
+
+        uint32_t tenths = (uint32_t)((timeUs + 50000) / 100000);
+        phrase.add(PAUSE);
+        number(tenths / 10, phrase);
+        phrase.add(POINT);
+        phrase.add(NUMBER + tenths % 10);
+        return phrase;
+    }
+
+    // ------------------------------------------------------------------
+    // Backlog: what is still to be announced, at most one lap per racer
+    // ------------------------------------------------------------------
+    // A racer who laps again before their last time was read out only
+    // gets the newer time; times that waited longer than MAX_AGE_MS are
+    // dropped, so the announcer never drifts behind the race.
+    class Backlog
+    {
+    public:
+        static constexpr uint32_t MAX_AGE_MS = 8000;
+
+    private:
+        struct Pending
+        {
+            uint64_t timeUs;
+            uint32_t queuedMs;
+            bool waiting;
+        };
+
+        Pending pending[RaceState::MAX_RACERS] = {};
+        uint32_t coalesced = 0;
+        uint32_t expired = 0;
+
+    public:
+        void add(uint8_t racerId, uint64_t timeUs, uint32_t nowMs)
+        {
+            if (racerId >= RaceState::MAX_RACERS)
+                return;
+            Pending &p = pending[racerId];
+            if (p.waiting)
+                coalesced++;
+            else
+                p.queuedMs = nowMs; // Keeps its place in line when replaced
+            p.timeUs = timeUs;
+            p.waiting = true;
+        }
+
+        // The racer waiting longest, if any
+        bool next(uint32_t nowMs, uint8_t &racerId, uint64_t &timeUs)
+        {
+            int oldest = -1;
+            for (uint8_t r = 0; r < RaceState::MAX_RACERS; r++)
+            {
+                Pending &p = pending[r];
+                if (!p.waiting)
+                    continue;
+                if (nowMs - p.queuedMs > MAX_AGE_MS)
+                {
+                    p.waiting = false;
+                    expired++;
+                    continue;
+                }
+                if (oldest < 0 || (int32_t)(p.queuedMs - pending[oldest].queuedMs) < 0)
+                    oldest = r;
+            }
+            if (oldest < 0)
+                return false;
+
+            pending[oldest].waiting = false;
+            racerId = oldest;
+            timeUs = pending[oldest].timeUs;
+            return true;
+        }
+
+        bool waiting() const
+        {
+            for (const Pending &p : pending)
+            {
+                if (p.waiting)
+                    return true;
+            }
+            return false;
+        }
+
+        void clear()
+        {
+            for (Pending &p : pending)
+                p.waiting = false;
+        }
+
+        uint32_t coalescedCount() const { return coalesced; }
+        uint32_t expiredCount() const { return expired; }
+    };
+};
+
+// ============================================================================
+// Clip Cache
+// ============================================================================
+// Decoded clips in RAM, indexed by clip id, within a byte budget. A miss
+// calls load(clip, entry), which allocates entry.samples with malloc; least
+// recently used clips are freed to make room, except the ones in the pinned
+// mask (the phrase being assembled). A clip that failed to load is
+// remembered as missing and not retried.
+//
+// Single-threaded: only the announcer task touches it, and it evicts only
+// while nothing is being spoken, so a clip is never freed under the mixer.
+class ClipCache
+{
+public:
+    static constexpr size_t DEFAULT_BYTES = 80 * 1024;
+
+    struct Entry
+    {
+        int16_t *samples = nullptr;
+        uint32_t count = 0;
+        uint32_t sampleRate = 0;
+    };
+
+private:
+    enum class State : uint8_t
+    {
+        UNKNOWN,
+        LOADED,
+        MISSING
+    };
+
+    Entry entries[Announcement::CLIP_COUNT];
+    State states[Announcement::CLIP_COUNT] = {};
+    uint32_t lastUsed[Announcement::CLIP_COUNT] = {};
+    size_t budget;
+    size_t used = 0;
+    uint32_t clock = 0;
+
+    uint32_t hitCount = 0;
+    uint32_t missCount = 0;
+    uint32_t evictionCount = 0;
+
+    void evict(uint8_t clip)
+    {
+        used -= entries[clip].count * sizeof(int16_t);
+        free(entries[clip].samples);
+        entries[clip] = Entry();
+        states[clip] = State::UNKNOWN;
+        evictionCount++;
+    }
+
+    // Free least recently used clips until extra more bytes fit
+    void makeRoom(size_t extra, uint64_t pinned)
+    {
+        while (used + extra > budget)
+        {
+            int victim = -1;
+            for (uint8_t c = 0; c < Announcement::CLIP_COUNT; c++)
+            {
+                if (states[c] != State::LOADED || (pinned >> c & 1))
+                    continue;
+                if (victim < 0 || lastUsed[c] < lastUsed[victim])
+                    victim = c;
+            }
+            if (victim < 0)
+                return; // Everything left is pinned: go over budget
+            evict(victim);
+        }
+    }
+
+public:
+    explicit ClipCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+    ~ClipCache()
+    {
+        for (Entry &entry : entries)
+            free(entry.samples);
+    }
+
+    // The clip, loaded on a miss; nullptr if it does not exist
+    template <typename Loader>
+    const Entry *get(uint8_t clip, Loader load, uint64_t pinned = 0)
+    {
+        if (clip >= Announcement::CLIP_COUNT || states[clip] == State::MISSING)
+            return nullptr;
+
+        lastUsed[clip] = ++clock;
+        if (states[clip] == State::LOADED)
+        {
+            hitCount++;
+            return &entries[clip];
+        }
+
+        missCount++;
+        Entry entry;
+        if (!load(clip, entry) || !entry.samples || entry.count == 0)
+        {
+            free(entry.samples);
+            states[clip] = State::MISSING;
+            return nullptr;
+        }
+        makeRoom(entry.count * sizeof(int16_t), pinned | (uint64_t)1 << clip);
+        entries[clip] = entry;
+        states[clip] = State::LOADED;
+        used += entry.count * sizeof(int16_t);
+        return &entries[clip];
+    }
+
+    // Known not to exist (only after a get())
+    bool missing(uint8_t clip) const { return clip < Announcement::CLIP_COUNT && states[clip] == State::MISSING; }
+
+    size_t bytes() const { return used; }
+    uint32_t hits() const { return hitCount; }
+    uint32_t misses() const { return missCount; }
+    uint32_t evictions() const { return evictionCount; }
+};
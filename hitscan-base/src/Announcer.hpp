@@ -0,0 +1,205 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_timer.h>
+#include "Announcement.hpp"
+#include "AudioPlayer.hpp"
+#include "SpscRing.hpp"
+
+// ============================================================================
+// Lap Announcer
+// ============================================================================
+// Reads lap times out over the speaker from clips in /voice on the SD card
+// (see Announcement::clipPath). The loop only queues (racer, time) in O(1);
+// a low-priority task on core 0 assembles the phrase, loads missing clips
+// into the ClipCache and queues them on the AudioPlayer speech channel, so
+// neither clip loading nor playback can hold up detection.
+//
+// One phrase plays at a time. Laps that arrive meanwhile wait in the
+// Backlog, newest time per racer, oldest racer first.
+class Announcer
+{
+private:
+    static constexpr size_t CACHE_BYTES = ClipCache::DEFAULT_BYTES;
+    static constexpr uint32_t PAUSE_MS = 120; // Between name and time
+    static constexpr uint32_t POLL_MS = 20;   // While a phrase plays with laps waiting
+    static constexpr uint8_t CLEAR = 0xFF;    // Request: forget the backlog
+
+    struct Request
+    {
+        uint8_t racerId;
+        uint64_t timeUs;
+    };
+
+    AudioPlayer &audio;
+    fs::FS *fs = nullptr;
+    ClipCache cache{CACHE_BYTES};
+    Announcement::Backlog backlog;     // Task owned
+    SpscRing<Request, 16> requests;    // Loop produces, task consumes
+    TaskHandle_t taskHandle = NULL;
+    bool ready = false;
+
+    std::atomic<uint32_t> announced{0};
+    std::atomic<uint32_t> slowestAssemblyUs{0};
+
+    static void announcerTask(void *parameter)
+    {
+        Announcer *announcer = (Announcer *)parameter;
+
+        // Warm the cache with the clips every time needs
+        for (uint8_t digit = 0; digit < 10; digit++)
+            announcer->clip(Announcement::NUMBER + digit, 0);
+        announcer->clip(Announcement::POINT, 0);
+
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, announcer->backlog.waiting() ? pdMS_TO_TICKS(POLL_MS) : portMAX_DELAY);
+
+            Request request;
+            while (announcer->requests.pop(request))
+            {
+                if (request.racerId == CLEAR)
+                    announcer->backlog.clear();
+                else
+                    announcer->backlog.add(request.racerId, request.timeUs, millis());
+            }
+
+            // The clips of the phrase playing must stay in the cache
+            if (announcer->audio.speaking())
+                continue;
+
+            uint8_t racerId;
+            uint64_t timeUs;
+            if (announcer->backlog.next(millis(), racerId, timeUs))
+                announcer->announce(racerId, timeUs);
+        }
+    }
+
+    // Read a clip's WAV file into RAM, downmixed to mono
+    bool loadClip(uint8_t id, ClipCache::Entry &entry)
+    {
+        char path[32];
+        Announcement::clipPath(id, path, sizeof(path));
+        File file = fs->open(path, FILE_READ);
+        AudioPlayer::WavInfo info;
+        if (!file || !AudioPlayer::readWavHeader(file, info))
+            return false;
+
+        size_t bytes = info.dataBytes - info.dataBytes % (info.channels * sizeof(int16_t));
+        if (bytes == 0 || bytes > CACHE_BYTES)
+            return false;
+        entry.samples = (int16_t *)malloc(bytes);
+        if (!entry.samples)
+            return false;
+
+        size_t count = file.read(reinterpret_cast<uint8_t *>(entry.samples), bytes) /
+                       (info.channels * sizeof(int16_t));
+        if (info.channels == 2)
+        {
+            for (size_t i = 0; i < count; i++)
+                entry.samples[i] = (entry.samples[i * 2] + entry.samples[i * 2 + 1]) / 2;
+        }
+        entry.count = count;
+        entry.sampleRate = info.sampleRate;
+        return true;
+    }
+
+    const ClipCache::Entry *clip(uint8_t id, uint64_t pinned)
+    {
+        return cache.get(id, [this](uint8_t clipId, ClipCache::Entry &entry)
+                         { return loadClip(clipId, entry); }, pinned);
+    }
+
+    void announce(uint8_t racerId, uint64_t timeUs)
+    {
+        uint64_t start = esp_timer_get_time();
+
+        bool haveName = clip(Announcement::NAME + racerId, 0) != nullptr;
+        Announcement::Phrase phrase = Announcement::lap(racerId, timeUs, haveName);
+
+        // Resolve every clip before queueing any, so a missing file never
+        // leaves half a phrase
+        const ClipCache::Entry *entries[Announcement::MAX_CLIPS];
+        uint64_t pinned = 0;
+        for (uint8_t i = 0; i < phrase.length; i++)
+        {
+            uint8_t id = phrase.clips[i];
+            if (id == Announcement::PAUSE)
+            {
+                entries[i] = nullptr;
+                continue;
+            }
+            entries[i] = clip(id, pinned);
+            if (!entries[i])
+            {
+                Serial.printf("Announcer: clip %u missing\n", id);
+                return;
+            }
+            pinned |= (uint64_t)1 << id;
+        }
+
+        for (uint8_t i = 0; i < phrase.length; i++)
+        {
+            if (entries[i])
+                audio.say({entries[i]->samples, entries[i]->count, entries[i]->sampleRate});
+            else
+                audio.say({nullptr, PAUSE_MS, 1000});
+        }
+
+        uint32_t took = esp_timer_get_time() - start;
+        if (took > slowestAssemblyUs.load(std::memory_order_relaxed))
+            slowestAssemblyUs.store(took, std::memory_order_relaxed);
+        announced.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    explicit Announcer(AudioPlayer &audio) : audio(audio) {}
+
+    // Start the announcer task if the card has clips
+    bool begin(fs::FS &clipFs)
+    {
+        fs = &clipFs;
+        if (!audio.enabled() || !fs->exists("/voice/point.wav"))
+        {
+            Serial.println("Announcer: no clips in /voice, lap times will not be read out");
+            return false;
+        }
+
+        xTaskCreatePinnedToCore(
+            announcerTask, // Task function
+            "Announcer",   // Name
+            4096,          // Stack size (bytes)
+            this,          // Parameters
+            1,             // Priority (low)
+            &taskHandle,   // Task handle
+            0              // Core 0, away from detection
+        );
+        ready = true;
+        return true;
+    }
+
+    // Queue a lap (or finish) time for racerId; O(1), from the loop
+    void lap(uint8_t racerId, uint64_t timeUs)
+    {
+        if (ready && requests.push({racerId, timeUs}))
+            xTaskNotifyGive(taskHandle);
+    }
+
+    // Drop anything not yet read out (new race)
+    void clear()
+    {
+        if (ready && requests.push({CLEAR, 0}))
+            xTaskNotifyGive(taskHandle);
+    }
+
+    bool enabled() const { return ready; }
+    uint32_t announcements() const { return announced.load(std::memory_order_relaxed); }
+    uint32_t slowestAssembly() const { return slowestAssemblyUs.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return requests.droppedCount(); }
+    // Read from the task's counters; approximate while it runs
+    uint32_t coalesced() const { return backlog.coalescedCount(); }
+    uint32_t expired() const { return backlog.expiredCount(); }
+    uint32_t cacheHits() const { return cache.hits(); }
+    uint32_t cacheMisses() const { return cache.misses(); }
+};
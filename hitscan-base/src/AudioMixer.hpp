@@ -0,0 +1,369 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include "SpscRing.hpp"
+
+// ============================================================================
+// PCM Stream
+// ============================================================================
+// Double buffer between a file reader (producer) and the mixer (consumer).
+// The reader fills whichever buffer is empty and commits it; the mixer plays
+// one while the other is being read, and hands a buffer back as soon as it
+// has played through it. Samples are mono 16-bit at the source rate; the
+// mixer steps through them in Q16 to convert to the output rate.
+class PcmStream
+{
+public:
+    static constexpr size_t BUFFER_SAMPLES = 1024;
+
+private:
+    int16_t buffers[2][BUFFER_SAMPLES];
+    std::atomic<uint16_t> filled[2] = {{0}, {0}}; // Non-zero: the mixer owns it
+    std::atomic<bool> active{false};
+    std::atomic<bool> ended{false};
+    std::atomic<bool> cancelPending{false};
+    std::atomic<bool> refill{false};
+    uint32_t step = 1 << 16;
+
+    uint8_t nextFill = 0; // Reader side
+    uint8_t current = 0;  // Mixer side
+    uint32_t position = 0;
+    uint32_t underruns = 0;
+
+public:
+    // ------------------------------------------------------------------
+    // Reader side
+    // ------------------------------------------------------------------
+
+    // Only while !playing()
+    void begin(uint32_t sourceRate, uint32_t outputRate)
+    {
+        step = (uint32_t)(((uint64_t)sourceRate << 16) / outputRate);
+        filled[0] = 0;
+        filled[1] = 0;
+        nextFill = 0;
+        current = 0;
+        position = 0;
+        ended = false;
+    }
+
+    // The buffer to read into next, or nullptr while both are queued
+    int16_t *emptyBuffer()
+    {
+        return filled[nextFill].load(std::memory_order_acquire) ? nullptr : buffers[nextFill];
+    }
+
+    void commit(uint16_t count)
+    {
+        if (count == 0)
+            return;
+        filled[nextFill].store(count, std::memory_order_release);
+        nextFill ^= 1;
+        active.store(true, std::memory_order_release);
+    }
+
+    // No more buffers: playback ends once the queued ones are played
+    void finish() { ended.store(true, std::memory_order_release); }
+
+    // Stop now; completes at the mixer's next block
+    void cancel()
+    {
+        if (active.load(std::memory_order_acquire))
+            cancelPending.store(true, std::memory_order_release);
+    }
+
+    bool cancelling() const { return cancelPending.load(std::memory_order_acquire); }
+
+    // ------------------------------------------------------------------
+    // Mixer side
+    // ------------------------------------------------------------------
+
+    bool playing() const { return active.load(std::memory_order_acquire); }
+
+    // Once per block, before next()
+    void service()
+    {
+        if (!cancelPending.load(std::memory_order_acquire))
+            return;
+        filled[0].store(0, std::memory_order_release);
+        filled[1].store(0, std::memory_order_release);
+        active.store(false, std::memory_order_release);
+        cancelPending.store(false, std::memory_order_release);
+    }
+
+    int32_t next()
+    {
+        uint16_t count = filled[current].load(std::memory_order_acquire);
+        if (count == 0)
+        {
+            if (ended.load(std::memory_order_acquire))
+                active.store(false, std::memory_order_release);
+            else
+                underruns++;
+            return 0;
+        }
+
+        int16_t sample = buffers[current][position >> 16];
+        position += step;
+        if ((position >> 16) >= count)
+        {
+            position -= (uint32_t)count << 16;
+            filled[current].store(0, std::memory_order_release);
+            current ^= 1;
+            refill.store(true, std::memory_order_release);
+        }
+        return sample;
+    }
+
+    // True once per buffer handed back (wake the reader)
+    bool takeRefillRequest() { return refill.exchange(false, std::memory_order_acq_rel); }
+    uint32_t underrunSamples() const { return underruns; }
+};
+
+// ============================================================================
+// Audio Mixer
+// ============================================================================
+// Tone synthesis and mixing in fixed point, independent of the output. Cues
+// (a tone with an attack/release envelope, optionally delayed) are queued
+// in O(1) from one producer through a lock-free ring and picked up at the
+// next block; up to MAX_VOICES play at once and mix with a PcmStream.
+//
+// Speech is a separate channel: clips (PCM already in RAM) queued from a
+// second producer play back to back with no gap, one at a time, so
+// concatenated words never overlap each other.
+//
+// Tones come from a 256-entry Q15 sine table with linear interpolation,
+// stepped by a 32-bit phase accumulator; envelopes are a Q16 gain with a
+// constant per-sample step, so the inner loop has no float or division.
+class AudioMixer
+{
+public:
+    static constexpr uint8_t MAX_VOICES = 4;
+    static constexpr uint16_t DEFAULT_ATTACK_MS = 5;
+    static constexpr uint16_t DEFAULT_RELEASE_MS = 15;
+
+    struct Cue
+    {
+        uint16_t frequency;  // Hz
+        uint16_t durationMs; // Including attack and release
+        uint8_t volume;      // 0-255
+        uint16_t attackMs;
+        uint16_t releaseMs;
+        uint16_t delayMs; // Start this long after being picked up
+    };
+
+    // Mono 16-bit PCM that stays valid until speaking() turns false.
+    // samples == nullptr is count / sampleRate seconds of silence.
+    struct Clip
+    {
+        const int16_t *samples;
+        uint32_t count;
+        uint32_t sampleRate;
+    };
+
+    static Cue tone(uint16_t frequency, uint16_t durationMs, uint8_t volume = 80, uint16_t delayMs = 0)
+    {
+        return {frequency, durationMs, volume, DEFAULT_ATTACK_MS, DEFAULT_RELEASE_MS, delayMs};
+    }
+
+private:
+    static constexpr size_t TABLE_BITS = 8;
+    static constexpr size_t TABLE_SIZE = 1 << TABLE_BITS;
+    static constexpr uint32_t UNITY = 1 << 16; // Envelope gain 1.0
+
+    struct Voice
+    {
+        uint32_t phase;
+        uint32_t increment;
+        uint32_t delay;     // Samples before it starts
+        uint32_t remaining; // Samples left, release included
+        uint32_t attack;    // Samples
+        uint32_t release;
+        int32_t gain; // Q16
+        int32_t gainStep;
+        uint8_t volume;
+        bool active;
+    };
+
+    int16_t sineTable[TABLE_SIZE + 1]; // +1 so interpolation never wraps
+    Voice voices[MAX_VOICES] = {};
+    SpscRing<Cue, 16> cues;
+    uint32_t sampleRate;
+    uint32_t voicesStolen = 0;
+
+    struct SpeechClip
+    {
+        const int16_t *samples;
+        uint32_t count;
+        uint32_t step; // Q16 source samples per output sample
+    };
+
+    SpscRing<SpeechClip, 32> speech; // Speech producer, mixer consumes
+    SpeechClip clip = {};
+    uint32_t clipPosition = 0; // Q16
+    bool clipActive = false;
+    std::atomic<uint32_t> clipsQueued{0};
+    std::atomic<uint32_t> clipsDone{0};
+
+    uint32_t samples(uint32_t ms) const { return (uint32_t)((uint64_t)ms * sampleRate / 1000); }
+
+    void start(const Cue &cue)
+    {
+        // A free voice, else the one closest to finishing
+        Voice *voice = &voices[0];
+        for (Voice &v : voices)
+        {
+            if (!v.active)
+            {
+                voice = &v;
+                break;
+            }
+            if (v.remaining < voice->remaining)
+                voice = &v;
+        }
+        if (voice->active)
+            voicesStolen++;
+
+        uint32_t total = samples(cue.durationMs);
+        uint32_t attack = samples(cue.attackMs);
+        uint32_t release = samples(cue.releaseMs);
+        if (attack + release > total)
+            attack = release = total / 2;
+
+        voice->phase = 0;
+        voice->increment = (uint32_t)(((uint64_t)cue.frequency << 32) / sampleRate);
+        voice->delay = samples(cue.delayMs);
+        voice->remaining = total;
+        voice->attack = attack;
+        voice->release = release;
+        voice->gain = attack ? 0 : UNITY;
+        voice->gainStep = attack ? (int32_t)(UNITY / attack) : 0;
+        voice->volume = cue.volume;
+        voice->active = total > 0;
+    }
+
+    int32_t renderVoice(Voice &v)
+    {
+        if (v.delay)
+        {
+            v.delay--;
+            return 0;
+        }
+
+        uint32_t index = v.phase >> (32 - TABLE_BITS);
+        int32_t fraction = (v.phase >> (16 - TABLE_BITS)) & 0xFFFF;
+        int32_t a = sineTable[index];
+        int32_t b = sineTable[index + 1];
+        int32_t sample = a + (((b - a) * fraction) >> 16);
+        v.phase += v.increment;
+
+        // Envelope: ramp up for attack samples, hold, ramp down over the
+        // last release samples
+        if (v.remaining == v.release)
+            v.gainStep = v.release ? -(v.gain / (int32_t)v.release) : -v.gain;
+        v.gain += v.gainStep;
+        if (v.gain >= (int32_t)UNITY)
+        {
+            v.gain = UNITY;
+            v.gainStep = 0;
+        }
+        if (v.gain < 0)
+            v.gain = 0;
+        if (--v.remaining == 0)
+            v.active = false;
+
+        return ((sample * (v.gain >> 1)) >> 15) * v.volume >> 8;
+    }
+
+    int32_t renderSpeech()
+    {
+        if (!clipActive)
+        {
+            if (!speech.pop(clip))
+                return 0;
+            clipActive = true;
+            clipPosition = 0;
+        }
+
+        uint32_t index = clipPosition >> 16;
+        int32_t sample = clip.samples ? clip.samples[index] : 0;
+        clipPosition += clip.step;
+        if ((clipPosition >> 16) >= clip.count)
+        {
+            clipActive = false;
+            clipsDone.fetch_add(1, std::memory_order_release);
+        }
+        return sample;
+    }
+
+public:
+    explicit AudioMixer(uint32_t sampleRate) : sampleRate(sampleRate)
+    {
+        for (size_t i = 0; i <= TABLE_SIZE; i++)
+            sineTable[i] = (int16_t)lrintf(32767.0f * sinf(2.0f * (float)M_PI * i / TABLE_SIZE));
+    }
+
+    // O(1), never blocks. False if the cue ring is full.
+    bool play(const Cue &cue) { return cues.push(cue); }
+
+    // Speech side: O(1), never blocks. False (counted) if the ring is full.
+    bool say(const Clip &clip)
+    {
+        if (clip.count == 0 || clip.sampleRate == 0)
+            return true;
+        uint32_t step = (uint32_t)(((uint64_t)clip.sampleRate << 16) / sampleRate);
+        if (!speech.push({clip.samples, clip.count, step}))
+            return false;
+        clipsQueued.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // Any clip queued or playing; the clips' samples must stay valid
+    bool speaking() const
+    {
+        return clipsDone.load(std::memory_order_acquire) != clipsQueued.load(std::memory_order_acquire);
+    }
+
+    // Mix frames mono samples of every voice, speech and the stream
+    void render(int16_t *out, size_t frames, PcmStream *stream = nullptr)
+    {
+        Cue cue;
+        while (cues.pop(cue))
+            start(cue);
+        if (stream)
+            stream->service();
+        bool streaming = stream && stream->playing();
+        bool talking = speaking();
+
+        for (size_t i = 0; i < frames; i++)
+        {
+            int32_t mix = streaming ? stream->next() : 0;
+            if (talking)
+                mix += renderSpeech();
+            for (Voice &v : voices)
+            {
+                if (v.active)
+                    mix += renderVoice(v);
+            }
+            out[i] = mix > 32767 ? 32767 : mix < -32768 ? -32768 : (int16_t)mix;
+        }
+    }
+
+    // Anything left to render (voices or speech playing, cues waiting)
+    bool busy() const
+    {
+        for (const Voice &v : voices)
+        {
+            if (v.active)
+                return true;
+        }
+        return !cues.empty() || speaking();
+    }
+
+    uint32_t rate() const { return sampleRate; }
+    uint32_t stolenVoices() const { return voicesStolen; }
+    uint32_t droppedCues() const { return cues.droppedCount() + speech.droppedCount(); }
+};
@@ -1,19 +1,221 @@
+#pragma once
 
 #include <Arduino.h>
+#include <FS.h>
 #include <driver/i2s.h>
+#include "AudioMixer.hpp"
+#include "SpscRing.hpp"
 
 // ============================================================================
 // Audio Player Class (MAX98357A)
 // ============================================================================
+// The I2S port belongs to a mixer task on core 0. It renders one DMA
+// buffer's worth of frames at a time from the AudioMixer and writes it
+// whole; the write blocks only that task, which is what paces it. When
+// nothing is playing it sleeps until a cue arrives.
+//
+// playTone()/play()/playWav() only queue a request, so the loop never waits
+// for audio. They are single-producer: call them from the loop (or setup);
+// say() is the speech channel's own producer.
+// WAV files stream from the file system through a PcmStream double buffer,
+// filled by a separate reader task so a slow card read never stalls the
+// mixer; tones keep playing over the file.
 class AudioPlayer
 {
+public:
+    static constexpr uint8_t DEFAULT_VOLUME = 80;
+
+    struct WavInfo
+    {
+        uint16_t channels;
+        uint32_t sampleRate;
+        uint32_t dataBytes;
+    };
+
+    // Walk the RIFF chunks up to the start of the samples. Only 16-bit PCM,
+    // mono or stereo; any sample rate (the mixer converts it).
+    static bool readWavHeader(File &file, WavInfo &info)
+    {
+        uint8_t header[16];
+        if (file.read(header, 12) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+            return false;
+
+        bool haveFormat = false;
+        while (file.read(header, 8) == 8)
+        {
+            uint32_t size = le32(header + 4);
+            size_t next = file.position() + size + (size & 1);
+
+            if (!memcmp(header, "data", 4))
+            {
+                info.dataBytes = size;
+                return haveFormat;
+            }
+            if (!memcmp(header, "fmt ", 4))
+            {
+                if (size < 16 || file.read(header, 16) != 16)
+                    return false;
+                info.channels = le16(header + 2);
+                info.sampleRate = le32(header + 4);
+                if (le16(header) != 1 || le16(header + 14) != 16 || info.channels < 1 || info.channels > 2 ||
+                    info.sampleRate == 0)
+                    return false;
+                haveFormat = true;
+            }
+            file.seek(next);
+        }
+        return false;
+    }
+
 private:
     static constexpr i2s_port_t I2S_PORT = I2S_NUM_0;
     static constexpr int SAMPLE_RATE = 44100;
+    static constexpr int DMA_BUFFERS = 8;
+    static constexpr int BLOCK_FRAMES = 64; // One DMA buffer, ~1.5 ms
+    static constexpr size_t MAX_PATH = 48;
+
+    static uint32_t le32(const uint8_t *bytes)
+    {
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    }
+
+    static uint16_t le16(const uint8_t *bytes) { return bytes[0] | bytes[1] << 8; }
+
+    struct WavRequest
+    {
+        char path[MAX_PATH];
+    };
+
+    uint8_t bckPin, wsPin, dataPin;
+    AudioMixer mixer{SAMPLE_RATE};
+    PcmStream stream;
+    SpscRing<WavRequest, 4> wavRequests; // Loop produces, reader task consumes
+
+    TaskHandle_t mixerTaskHandle = NULL;
+    TaskHandle_t readerTaskHandle = NULL;
+    bool ready = false;
+    uint8_t toneVolume = DEFAULT_VOLUME; // Loop only
+
+    // Reader task state
+    fs::FS *fs = nullptr;
+    File wavFile;
+    uint8_t wavChannels = 1;
+    uint32_t wavBytesLeft = 0;
+    int16_t readBuffer[PcmStream::BUFFER_SAMPLES * 2];
+
+    static void mixerTask(void *parameter)
+    {
+        AudioPlayer *player = (AudioPlayer *)parameter;
+        int16_t mono[BLOCK_FRAMES];
+        int16_t frames[BLOCK_FRAMES * 2];
+
+        while (true)
+        {
+            if (!player->mixer.busy() && !player->stream.playing() && !player->stream.cancelling())
+            {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                continue;
+            }
+
+            player->mixer.render(mono, BLOCK_FRAMES, &player->stream);
+            if (player->stream.takeRefillRequest())
+                xTaskNotifyGive(player->readerTaskHandle);
+
+            for (int i = 0; i < BLOCK_FRAMES; i++)
+            {
+                frames[i * 2] = mono[i];
+                frames[i * 2 + 1] = mono[i];
+            }
+            size_t written;
+            i2s_write(I2S_PORT, frames, sizeof(frames), &written, portMAX_DELAY);
+        }
+    }
+
+    static void readerTask(void *parameter)
+    {
+        AudioPlayer *player = (AudioPlayer *)parameter;
+
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            // Only the newest request matters
+            WavRequest request;
+            bool requested = false;
+            while (player->wavRequests.pop(request))
+                requested = true;
+            if (requested)
+                player->openWav(request.path);
+
+            player->fillStream();
+        }
+    }
+
+    void openWav(const char *path)
+    {
+        // Stop whatever is playing; the mixer lets go of the buffers at its
+        // next block
+        stream.cancel();
+        xTaskNotifyGive(mixerTaskHandle);
+        while (stream.cancelling())
+            vTaskDelay(1);
+
+        wavFile.close();
+        wavFile = fs ? fs->open(path, FILE_READ) : File();
+        WavInfo info;
+        if (!wavFile || !readWavHeader(wavFile, info))
+        {
+            Serial.printf("Audio: cannot play %s\n", path);
+            wavFile.close();
+            return;
+        }
+        wavChannels = info.channels;
+        wavBytesLeft = info.dataBytes;
+        stream.begin(info.sampleRate, SAMPLE_RATE);
+        Serial.printf("Audio: playing %s (%u Hz, %u ch)\n", path, info.sampleRate, wavChannels);
+    }
+
+    // Read into every buffer the mixer has handed back
+    void fillStream()
+    {
+        int16_t *buffer;
+        while (wavFile && (buffer = stream.emptyBuffer()) != nullptr)
+        {
+            size_t want = PcmStream::BUFFER_SAMPLES * wavChannels * sizeof(int16_t);
+            if (want > wavBytesLeft)
+                want = wavBytesLeft;
+            size_t got = wavFile.read(reinterpret_cast<uint8_t *>(readBuffer), want);
+            wavBytesLeft -= got;
+
+            size_t count = got / (wavChannels * sizeof(int16_t));
+            for (size_t i = 0; i < count; i++)
+            {
+                buffer[i] = wavChannels == 2 ? (readBuffer[i * 2] + readBuffer[i * 2 + 1]) / 2
+                                             : readBuffer[i];
+            }
+            stream.commit(count);
+            xTaskNotifyGive(mixerTaskHandle); // May be asleep before the first buffer
+
+            if (count == 0 || wavBytesLeft == 0)
+            {
+                stream.finish();
+                wavFile.close();
+            }
+        }
+    }
 
 public:
     AudioPlayer(uint8_t bckPin, uint8_t wsPin, uint8_t dataPin)
+        : bckPin(bckPin), wsPin(wsPin), dataPin(dataPin)
     {
+    }
+
+    // Install the I2S driver and start the mixer and reader tasks. WAV
+    // files are opened from wavFs.
+    void begin(fs::FS &wavFs)
+    {
+        fs = &wavFs;
+
         i2s_config_t i2s_config = {
             .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
             .sample_rate = SAMPLE_RATE,
@@ -21,10 +223,10 @@ public:
             .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
             .communication_format = I2S_COMM_FORMAT_STAND_I2S,
             .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-            .dma_buf_count = 8,
-            .dma_buf_len = 64,
+            .dma_buf_count = DMA_BUFFERS,
+            .dma_buf_len = BLOCK_FRAMES,
             .use_apll = false,
-            .tx_desc_auto_clear = true,
+            .tx_desc_auto_clear = true, // Silence rather than repeats when idle
             .fixed_mclk = 0};
 
         i2s_pin_config_t pin_config = {
@@ -33,37 +235,81 @@ public:
             .data_out_num = dataPin,
             .data_in_num = I2S_PIN_NO_CHANGE};
 
-        i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
-        i2s_set_pin(I2S_PORT, &pin_config);
+        if (i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL) != 0 || i2s_set_pin(I2S_PORT, &pin_config) != 0)
+        {
+            Serial.println("Audio: I2S init failed");
+            return;
+        }
+
+        xTaskCreatePinnedToCore(
+            mixerTask,        // Task function
+            "Audio_Mixer",    // Name
+            4096,             // Stack size (bytes)
+            this,             // Parameters
+            3,                // Priority (above the SD writers: it has a deadline)
+            &mixerTaskHandle, // Task handle
+            0                 // Core 0, away from detection
+        );
+        xTaskCreatePinnedToCore(
+            readerTask,        // Task function
+            "Audio_Reader",    // Name
+            4096,              // Stack size (bytes)
+            this,              // Parameters
+            2,                 // Priority
+            &readerTaskHandle, // Task handle
+            0                  // Core 0
+        );
+        ready = true;
     }
 
-    void playWav(const char *filename)
+    // Queue a cue; O(1), never blocks. False if not started or the queue
+    // is full (counted).
+    bool play(const AudioMixer::Cue &cue)
     {
-        // TODO: Implement WAV file playback from SD card
-        // 1. Open file from SD
-        // 2. Parse WAV header
-        // 3. Stream audio data to I2S
-        Serial.printf("Playing: %s\n", filename);
+        if (!ready || !mixer.play(cue))
+            return false;
+        xTaskNotifyGive(mixerTaskHandle);
+        return true;
     }
 
-    void playTone(int frequency, int duration)
+    bool playTone(uint16_t frequency, uint16_t durationMs, uint8_t volume)
     {
-        // Non-blocking tone generation using task
-        // Store params for background task
-        static int toneFreq = frequency;
-        static int toneDuration = duration;
-
-        // Quick fire-and-forget tone (simplified, doesn't actually block main loop)
-        // For true non-blocking, would need FreeRTOS task
-        // For now, keep tones SHORT (< 150ms) to minimize impact
-        const int sampleCount = (SAMPLE_RATE * duration) / 1000;
-        int16_t sample;
-        size_t bytesWritten;
-
-        for (int i = 0; i < sampleCount && i < 6615; i++)
-        { // Max ~150ms at 44.1kHz
-            sample = (int16_t)(sin(2.0 * PI * frequency * i / SAMPLE_RATE) * 10000);
-            i2s_write(I2S_PORT, &sample, sizeof(sample), &bytesWritten, 0); // No wait
-        }
+        return play(AudioMixer::tone(frequency, durationMs, volume));
+    }
+
+    // At the volume set by setVolume()
+    bool playTone(uint16_t frequency, uint16_t durationMs)
+    {
+        return playTone(frequency, durationMs, toneVolume);
     }
+
+    void setVolume(uint8_t volume) { toneVolume = volume; }
+
+    // Start streaming a 16-bit PCM WAV file, replacing any file playing
+    bool playWav(const char *filename)
+    {
+        WavRequest request;
+        strlcpy(request.path, filename, sizeof(request.path));
+        if (!ready || !wavRequests.push(request))
+            return false;
+        xTaskNotifyGive(readerTaskHandle);
+        return true;
+    }
+
+    // Speech channel, for one other task (the announcer): clips play back
+    // to back. The samples must stay valid while speaking().
+    bool say(const AudioMixer::Clip &clip)
+    {
+        if (!ready || !mixer.say(clip))
+            return false;
+        xTaskNotifyGive(mixerTaskHandle);
+        return true;
+    }
+
+    bool speaking() const { return mixer.speaking(); }
+
+    bool enabled() const { return ready; }
+    uint32_t droppedCues() const { return mixer.droppedCues(); }
+    uint32_t stolenVoices() const { return mixer.stolenVoices(); }
+    uint32_t underrunSamples() const { return stream.underrunSamples(); }
 };
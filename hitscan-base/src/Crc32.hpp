@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// CRC-32 (IEEE 802.3, as zlib)
+// ============================================================================
+// Bitwise, no table: the records it checks are small and rarely written.
+// Pass the previous result as crc to continue over several pieces.
+inline uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0)
+{
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "JsonStream.hpp"
+
+// ============================================================================
+// Event Stream (Server-Sent Events)
+// ============================================================================
+// Pushes each race event to every browser subscribed to /events the moment
+// it happens:
+//
+//   event: crossing
+//   data: {"racer":3,...}
+//
+// Connections live in the async web server; this class formats the event
+// once into a fixed buffer and hands it to all of them. A browser that drops
+// reconnects on its own after RETRY_MS and resyncs from /results.
+class EventStream
+{
+public:
+    static constexpr uint8_t MAX_CLIENTS = 12;
+    static constexpr uint32_t RETRY_MS = 2000; // Browser reconnect delay
+
+private:
+    AsyncEventSource source;
+    uint32_t oversized = 0;
+
+public:
+    EventStream() : source("/events") {}
+
+    void begin(AsyncWebServer &server)
+    {
+        source.onConnect([this](AsyncEventSourceClient *client)
+                         {
+            if (source.count() > MAX_CLIENTS)
+            {
+                client->close();
+                return;
+            }
+            client->send("{}", "hello", 0, RETRY_MS); });
+        server.addHandler(&source);
+    }
+
+    // Push one event; fill writes the data object. Call from the loop.
+    template <typename Fn>
+    void send(const char *event, Fn fill)
+    {
+        if (!source.count())
+            return;
+
+        JsonText<256> text;
+        fill(text.json());
+        if (text.c_str())
+            source.send(text.c_str(), event);
+        else
+            oversized++;
+    }
+
+    size_t clientCount() const { return source.count(); }
+    uint32_t oversizedEvents() const { return oversized; }
+};
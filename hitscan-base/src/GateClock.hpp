@@ -0,0 +1,189 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// ============================================================================
+// Gate Clock
+// ============================================================================
+// Maps this gate's esp_timer µs onto the master gate's from NTP-style
+// exchanges:
+//
+//   t1  request leaves here        (local)
+//   t2  request reaches the master (master)
+//   t3  reply leaves the master    (master)
+//   t4  reply arrives here         (local)
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2   master - local, at (t1 + t4) / 2
+//   delay  = (t4 - t1) - (t3 - t2)         time on the air both ways
+//
+// The offset is exact if both directions took as long, and wrong by up to
+// half the delay beyond the link's own minimum if not. WiFi retries and a
+// busy loop add milliseconds to one direction, so:
+//
+//   - the minimum is tracked over the whole run: the fastest delay seen,
+//     rising DELAY_AGING_US per exchange so a slower route is learned
+//   - only exchanges within DELAY_SLACK_US of it are kept
+//   - a line is fitted through the last FIT_SAMPLES kept, each weighted
+//     by 1 / (excess delay + DELAY_WEIGHT_US)^2, so the nearly symmetric
+//     exchanges decide it
+//
+// The slope is the drift between the two crystals, tens of ppm, which the
+// mapping follows between exchanges and through a gap in them. A slope
+// from a few seconds of noisy offsets is worse than none, so the clock is
+// only synced() once the kept exchanges span MIN_DRIFT_SPAN_US and the
+// scatter about the line puts the offset within MAX_UNCERTAINTY_US
+// (standard error). Keeping only the fast exchanges, the fit reaches back
+// further the noisier the link is.
+//
+// Hardware independent: all times are passed in.
+class GateClock
+{
+public:
+    static constexpr uint8_t FIT_SAMPLES = 32;              // Kept exchanges in the fit
+    static constexpr uint32_t DELAY_AGING_US = 20;          // Minimum delay rise per exchange
+    static constexpr uint32_t DELAY_SLACK_US = 300;         // Over the minimum, still kept
+    static constexpr uint32_t DELAY_WEIGHT_US = 100;        // Weight 1 / (excess + this)^2
+    static constexpr uint8_t MIN_SAMPLES = 8;               // Kept, before synced()
+    static constexpr uint64_t MIN_DRIFT_SPAN_US = 10000000; // Fit drift over at least this
+    static constexpr uint32_t MAX_UNCERTAINTY_US = 100;     // Offset standard error, before synced()
+    static constexpr int32_t MAX_DRIFT_PPB = 200000;        // 200 ppm; more is a bad fit
+    static constexpr uint32_t STEP_US = 20000;              // A fast exchange this far off: master restarted
+
+private:
+    struct Sample
+    {
+        uint64_t local; // Midpoint of the exchange
+        int64_t offset;
+        uint32_t delay;
+    };
+
+    uint32_t minDelay = UINT32_MAX;
+
+    Sample samples[FIT_SAMPLES];
+    uint8_t count = 0;
+    uint8_t next = 0;
+
+    // offset(local) = baseOffset + drift * (local - baseLocal)
+    uint64_t baseLocal = 0;
+    int64_t baseOffset = 0;
+    int32_t drift = 0; // ppb
+    uint32_t uncertaintyUs = UINT32_MAX; // Of the offset, from the last fit with drift
+    uint32_t lastDelayUs = 0;
+    uint32_t exchangeCount = 0;
+    uint32_t stepCount = 0;
+
+    // Exchanges near the minimum delay count the most
+    double weight(const Sample &sample) const
+    {
+        double excess = sample.delay > minDelay ? sample.delay - minDelay : 0;
+        return 1.0 / ((excess + DELAY_WEIGHT_US) * (excess + DELAY_WEIGHT_US));
+    }
+
+    void fit()
+    {
+        // The newest sample anchors the line; the others are relative to it
+        // so the sums stay small
+        const Sample &anchor = samples[(next + FIT_SAMPLES - 1) % FIT_SAMPLES];
+        const Sample &oldest = samples[count < FIT_SAMPLES ? 0 : next];
+        baseLocal = anchor.local;
+        baseOffset = anchor.offset;
+        if (count < 3 || anchor.local - oldest.local < MIN_DRIFT_SPAN_US)
+            return; // Keep the drift fitted before
+
+        // Fits only run on an exchange (a few per second), so double is fine
+        double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            double w = weight(samples[i]);
+            double x = -(double)(anchor.local - samples[i].local);
+            double y = (double)(samples[i].offset - anchor.offset);
+            sw += w;
+            sx += w * x;
+            sy += w * y;
+            sxx += w * x * x;
+            sxy += w * x * y;
+        }
+        double denominator = sw * sxx - sx * sx;
+        if (denominator <= 0)
+            return;
+        double slope = (sw * sxy - sx * sy) / denominator;
+        double intercept = (sy - slope * sx) / sw;
+        if (slope * 1e9 > MAX_DRIFT_PPB || slope * 1e9 < -MAX_DRIFT_PPB)
+            return;
+        drift = (int32_t)(slope * 1e9);
+        baseOffset = anchor.offset + (int64_t)intercept;
+
+        // Standard error of the offset now, from the scatter about the line
+        double residuals = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            double x = -(double)(anchor.local - samples[i].local);
+            double r = (double)(samples[i].offset - anchor.offset) - intercept - slope * x;
+            residuals += weight(samples[i]) * r * r;
+        }
+        uncertaintyUs = (uint32_t)sqrt(residuals / (count - 2) * sxx / denominator);
+    }
+
+public:
+    void reset()
+    {
+        minDelay = UINT32_MAX;
+        count = 0;
+        next = 0;
+        baseLocal = 0;
+        baseOffset = 0;
+        drift = 0;
+        uncertaintyUs = UINT32_MAX;
+    }
+
+    // One completed exchange
+    void add(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+    {
+        int64_t offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+        int64_t delay = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+        Sample sample = {t1 + (t4 - t1) / 2, offset, delay > 0 ? (uint32_t)delay : 0};
+        lastDelayUs = sample.delay;
+        exchangeCount++;
+
+        if (minDelay < UINT32_MAX - DELAY_AGING_US)
+            minDelay += DELAY_AGING_US;
+        if (sample.delay < minDelay)
+            minDelay = sample.delay;
+        if (sample.delay > minDelay + DELAY_SLACK_US)
+            return;
+
+        if (synced())
+        {
+            int64_t error = offset - offsetAt(sample.local);
+            if (error > STEP_US || error < -(int64_t)STEP_US)
+            {
+                reset();
+                stepCount++;
+                minDelay = sample.delay;
+            }
+        }
+
+        samples[next] = sample;
+        next = (next + 1) % FIT_SAMPLES;
+        if (count < FIT_SAMPLES)
+            count++;
+        fit();
+    }
+
+    bool synced() const { return count >= MIN_SAMPLES && uncertaintyUs <= MAX_UNCERTAINTY_US; }
+
+    // master - local at a local time
+    int64_t offsetAt(uint64_t local) const
+    {
+        return baseOffset + (int64_t)(local - baseLocal) * drift / 1000000000;
+    }
+
+    uint64_t toMaster(uint64_t local) const { return local + offsetAt(local); }
+
+    int64_t offsetUs() const { return baseOffset; }
+    int32_t driftPpb() const { return drift; }
+    uint32_t lastDelay() const { return lastDelayUs; }
+    uint32_t exchanges() const { return exchangeCount; }
+    uint32_t steps() const { return stepCount; } // Restarts of the master seen
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "IRPacketDecoder.hpp"
+
+// ============================================================================
+// IR Calibrator
+// ============================================================================
+// Learns decoder timing windows for one installation. Hold a transmitter at
+// the gate and feed every receiver pulse:
+//
+//   COLLECTING - burst and gap lengths go into 10 µs histograms until
+//                COLLECT_BURSTS bursts are in. The burst median gives the
+//                receiver's stretch; each burst and gap class then gets a
+//                window around the cluster it forms (0.5th-99.5th
+//                percentile plus a margin), bounded halfway to the next
+//                class. Classes with too few samples (a long gap never
+//                shows up from racer 0) keep the nominal window moved by
+//                the stretch.
+//   VERIFYING  - the next VERIFY_PULSES pulses go through two decoders,
+//                one with the windows in use and one with the learned
+//                windows, so the result says how many packets each
+//                recovered from the same signal.
+//
+// Hardware independent; the detection task feeds it on the ESP32,
+// tools/calibration_replay on the host.
+class IRCalibrator
+{
+public:
+    static constexpr uint16_t BIN_US = 10;
+    static constexpr uint16_t BINS = 160; // Longer pulses (packet spacing) are not kept
+    static constexpr uint32_t COLLECT_BURSTS = 2000;
+    static constexpr uint32_t VERIFY_PULSES = 8000;
+    static constexpr uint32_t MIN_SAMPLES = 50; // For a class to get its own window
+    static constexpr uint16_t MARGIN_US = 30;    // Beyond the observed spread
+    static constexpr int16_t MAX_STRETCH_US = 140;
+
+    enum class Phase : uint8_t
+    {
+        IDLE,
+        COLLECTING,
+        VERIFYING,
+        DONE,
+        FAILED // No transmitter seen
+    };
+
+    struct Result
+    {
+        IRTiming::Windows windows;   // Learned (the ones in use until then)
+        int16_t stretchUs = 0;       // Receiver burst stretch (median burst - nominal)
+        uint32_t bursts = 0;         // Histogrammed
+        uint32_t gaps = 0;
+        uint8_t learnedClasses = 0;  // Windows set from samples rather than shifted
+        uint32_t packetsBefore = 0;  // VERIFYING: decoded with the windows in use
+        uint32_t packetsAfter = 0;   //            and with the learned ones
+    };
+
+private:
+    using Decoder = BasicIRPacketDecoder<IRTiming::Runtime>;
+
+    // Nominal lengths as sent (PacketScheduler), for locating the classes
+    static constexpr uint16_t NOMINAL_BURST_US = 270;
+    static constexpr uint16_t NOMINAL_MARKER_US = 540;
+    static constexpr uint16_t NOMINAL_SHORT_US = 300;
+    static constexpr uint16_t NOMINAL_LONG_US = 600;
+    static constexpr uint16_t NOMINAL_SYNC_US = 900;
+
+    struct Cluster
+    {
+        uint32_t count;
+        uint16_t low;    // 0.5th percentile (µs)
+        uint16_t median;
+        uint16_t high;   // 99.5th percentile
+    };
+
+    Phase phase = Phase::IDLE;
+    uint16_t burstBins[BINS];
+    uint16_t gapBins[BINS];
+    Result outcome;
+    IRTiming::Windows inUse = IRTiming::nominal();
+    uint32_t verified = 0;
+    Decoder before;
+    Decoder after;
+
+    static void add(uint16_t *bins, uint32_t duration)
+    {
+        uint32_t bin = duration / BIN_US;
+        if (bin < BINS && bins[bin] < UINT16_MAX)
+            bins[bin]++;
+    }
+
+    static uint32_t count(const uint16_t *bins, uint16_t fromUs, uint16_t toUs)
+    {
+        uint32_t total = 0;
+        for (uint16_t bin = fromUs / BIN_US; bin < toUs / BIN_US && bin < BINS; bin++)
+            total += bins[bin];
+        return total;
+    }
+
+    // Duration below which fraction (Q10) of the samples in [fromBin, toBin) lie
+    static uint16_t percentile(const uint16_t *bins, uint16_t fromBin, uint16_t toBin, uint32_t total,
+                               uint32_t q10)
+    {
+        uint32_t target = (total * q10) >> 10;
+        uint32_t seen = 0;
+        for (uint16_t bin = fromBin; bin < toBin; bin++)
+        {
+            seen += bins[bin];
+            if (seen > target)
+                return bin * BIN_US + BIN_US / 2;
+        }
+        return toBin * BIN_US;
+    }
+
+    // The cluster around the fullest bin in [fromUs, peakToUs), grown
+    // within [fromUs, toUs) while the bins hold at least 2% of the peak, so
+    // a thin floor of other pulses (packet spacing, glitches) is left out.
+    // Growth also stops where the counts climb again out of a valley: the
+    // next class, when jitter fills the space between them.
+    static Cluster cluster(const uint16_t *bins, uint16_t fromUs, uint16_t toUs, uint16_t peakToUs = 0)
+    {
+        uint16_t from = fromUs / BIN_US;
+        uint16_t to = toUs / BIN_US < BINS ? toUs / BIN_US : BINS;
+        uint16_t peakTo = peakToUs && peakToUs / BIN_US < to ? peakToUs / BIN_US : to;
+        if (from >= to)
+            return {0, 0, 0, 0};
+
+        uint16_t peak = from;
+        for (uint16_t bin = from; bin < peakTo; bin++)
+        {
+            if (bins[bin] > bins[peak])
+                peak = bin;
+        }
+        uint32_t floor = bins[peak] / 50;
+        uint16_t lo = peak, hi = peak + 1;
+        uint32_t valley = bins[peak];
+        while (lo > from && bins[lo - 1] > floor && bins[lo - 1] <= valley * 2 + 2)
+        {
+            lo--;
+            valley = bins[lo] < valley ? bins[lo] : valley;
+        }
+        valley = bins[peak];
+        while (hi < to && bins[hi] > floor && bins[hi] <= valley * 2 + 2)
+        {
+            valley = bins[hi] < valley ? bins[hi] : valley;
+            hi++;
+        }
+
+        uint32_t total = 0;
+        for (uint16_t bin = lo; bin < hi; bin++)
+            total += bins[bin];
+        if (total == 0)
+            return {0, 0, 0, 0};
+        return {total, percentile(bins, lo, hi, total, 5), percentile(bins, lo, hi, total, 512),
+                percentile(bins, lo, hi, total, 1019)};
+    }
+
+    // Window around a cluster, kept inside [fromUs, toUs)
+    static IRWindow around(const Cluster &c, uint16_t fromUs, uint16_t toUs)
+    {
+        uint16_t margin = MARGIN_US + (c.high - c.low) / 4;
+        uint16_t min = c.low > fromUs + margin ? c.low - margin : fromUs;
+        uint16_t max = c.high + margin < toUs ? c.high + margin : toUs - 1;
+        return {min, max};
+    }
+
+    // Two neighbouring windows that overlap meet at boundary instead
+    static void split(IRWindow &lower, IRWindow &upper, uint16_t boundary)
+    {
+        if (lower.max < upper.min)
+            return;
+        if (lower.max >= boundary)
+            lower.max = boundary - 1;
+        if (upper.min < boundary)
+            upper.min = boundary;
+    }
+
+    // Learn a window from samples if there are enough of them
+    bool learn(const uint16_t *bins, uint16_t fromUs, uint16_t toUs, IRWindow &window)
+    {
+        Cluster c = cluster(bins, fromUs, toUs);
+        if (c.count < MIN_SAMPLES)
+            return false;
+        window = around(c, fromUs, toUs);
+        outcome.learnedClasses++;
+        return true;
+    }
+
+    bool derive()
+    {
+        // Stretch from the data bursts (standard and compact share one
+        // length): the fullest bin below the nominal marker/burst midpoint,
+        // with its cluster free to reach past it
+        Cluster burst = cluster(burstBins, 100, BINS * BIN_US, (NOMINAL_BURST_US + NOMINAL_MARKER_US) / 2);
+        if (burst.count < MIN_SAMPLES)
+            return false;
+        int32_t stretch = (int32_t)burst.median - NOMINAL_BURST_US;
+        stretch = stretch > MAX_STRETCH_US ? MAX_STRETCH_US : stretch < -MAX_STRETCH_US ? -MAX_STRETCH_US : stretch;
+        outcome.stretchUs = stretch;
+
+        IRTiming::Windows w = IRTiming::shifted(stretch);
+        uint16_t markerFloor = (NOMINAL_BURST_US + NOMINAL_MARKER_US) / 2 + stretch;
+        learn(burstBins, 100, markerFloor, w.bitBurst);
+        learn(burstBins, markerFloor, NOMINAL_MARKER_US * 3 / 2 + stretch, w.markerBurst);
+        split(w.bitBurst, w.markerBurst, markerFloor);
+        w.syncBurst = w.bitBurst;
+
+        // Gaps: the standard classes, bounded halfway between them. A
+        // compact blaster's 450/750 µs symbols would land between classes,
+        // so only a standard blaster trains them.
+        uint32_t markers = count(burstBins, markerFloor, BINS * BIN_US);
+        if (markers * 4 < outcome.bursts)
+        {
+            uint16_t shortLong = (NOMINAL_SHORT_US + NOMINAL_LONG_US) / 2 - stretch;
+            uint16_t longSync = (NOMINAL_LONG_US + NOMINAL_SYNC_US) / 2 - stretch;
+            learn(gapBins, NOMINAL_SHORT_US / 2 - stretch, shortLong, w.shortGap);
+            learn(gapBins, shortLong, longSync, w.longGap);
+            learn(gapBins, longSync, NOMINAL_SYNC_US * 3 / 2 - stretch, w.syncGap);
+            split(w.shortGap, w.longGap, shortLong);
+        }
+
+        if (!IRTiming::valid(w))
+            return false;
+        outcome.windows = w;
+        before.setWindows(inUse);
+        after.setWindows(w);
+        return true;
+    }
+
+public:
+    // Start over; current are the windows the decoder uses now
+    void begin(const IRTiming::Windows &current)
+    {
+        memset(burstBins, 0, sizeof(burstBins));
+        memset(gapBins, 0, sizeof(gapBins));
+        outcome = Result();
+        outcome.windows = current;
+        inUse = current;
+        verified = 0;
+        before.reset();
+        after.reset();
+        phase = Phase::COLLECTING;
+    }
+
+    void cancel() { phase = Phase::IDLE; }
+
+    // One receiver pulse, as for IRPacketDecoder::feed()
+    void feed(uint8_t level, uint32_t duration, uint64_t start)
+    {
+        if (phase == Phase::COLLECTING)
+        {
+            if (level == 0)
+            {
+                add(burstBins, duration);
+                outcome.bursts++;
+            }
+            else
+            {
+                add(gapBins, duration);
+                outcome.gaps++;
+            }
+            if (outcome.bursts >= COLLECT_BURSTS)
+                phase = derive() ? Phase::VERIFYING : Phase::FAILED;
+        }
+        else if (phase == Phase::VERIFYING)
+        {
+            Decoder::Packet packet;
+            outcome.packetsBefore += before.feed(level, duration, start, packet);
+            outcome.packetsAfter += after.feed(level, duration, start, packet);
+            if (++verified >= VERIFY_PULSES)
+                phase = Phase::DONE;
+        }
+    }
+
+    Phase state() const { return phase; }
+    bool finished() const { return phase == Phase::DONE || phase == Phase::FAILED; }
+    const Result &result() const { return outcome; }
+
+    // Worth keeping: learned from a transmitter and decodes at least as
+    // well as what is in use
+    bool improves() const
+    {
+        return phase == Phase::DONE && outcome.packetsAfter > 0 && outcome.packetsAfter >= outcome.packetsBefore;
+    }
+};
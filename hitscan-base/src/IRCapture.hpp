@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <soc/gpio_struct.h>
+#include "SpscRing.hpp"
+
+// ============================================================================
+// IR Edge Capture
+// ============================================================================
+// Timestamps every TSOP output edge from a GPIO interrupt (64-bit esp_timer
+// time for the edge, CPU cycle counter for the pulse length), and turns each pair of edges into a (level, duration) pulse in a
+// preallocated ring. The decoder reads pulses from the ring instead of
+// spinning on digitalRead(), so decoding no longer needs a dedicated core and
+// its timing does not depend on when the reader gets scheduled.
+//
+// The ring is single-producer, single-consumer: the edge ISR pushes, and
+// read() and flush() belong to the one task that decodes. Anything else
+// may only look at ring() sizes and counters.
+
+struct IRPulse
+{
+    uint8_t level;     // Receiver output during the pulse (LOW = carrier seen)
+    uint32_t duration; // Microseconds
+    uint64_t start;    // esp_timer µs at the edge that began the pulse
+};
+
+class IRCapture
+{
+public:
+    // ~8 pulses per packet, so this buffers ~30 packets (~70ms of signal)
+    static constexpr size_t RING_SIZE = 256;
+    using PulseRing = SpscRing<IRPulse, RING_SIZE>;
+
+private:
+    const uint8_t irPin;
+    PulseRing pulses;
+    uint32_t lastEdgeCycles = 0;
+    uint64_t lastEdgeUs = 0;
+    uint32_t cyclesPerUs = 240;
+    static constexpr uint64_t LONG_PULSE_US = 1000000;
+
+    // Raw register read - digitalRead() is not guaranteed to live in IRAM
+    static inline uint8_t IRAM_ATTR readPin(uint8_t pin)
+    {
+        if (pin < 32)
+            return (GPIO.in >> pin) & 1;
+        return (GPIO.in1.data >> (pin - 32)) & 1;
+    }
+
+    static void IRAM_ATTR onEdge(void *arg)
+    {
+        IRCapture *self = static_cast<IRCapture *>(arg);
+        uint32_t now = ESP.getCycleCount();
+        uint64_t nowUs = esp_timer_get_time();
+
+        // Cycle counts are exact but wrap every ~18s; long idle stretches fall
+        // back to the coarser esp_timer difference
+        uint64_t elapsedUs = nowUs - self->lastEdgeUs;
+        uint32_t duration = elapsedUs < LONG_PULSE_US
+                                ? (now - self->lastEdgeCycles) / self->cyclesPerUs
+                                : (elapsedUs > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsedUs);
+
+        // The pin has just changed, so the pulse that ended had the opposite level
+        IRPulse pulse = {
+            static_cast<uint8_t>(!readPin(self->irPin)),
+            duration,
+            self->lastEdgeUs};
+
+        self->lastEdgeCycles = now;
+        self->lastEdgeUs = nowUs;
+        self->pulses.push(pulse);
+    }
+
+public:
+    IRCapture(uint8_t pin) : irPin(pin) {}
+
+    void begin()
+    {
+        pinMode(irPin, INPUT);
+        cyclesPerUs = getCpuFrequencyMhz();
+        lastEdgeCycles = ESP.getCycleCount();
+        lastEdgeUs = esp_timer_get_time();
+        attachInterruptArg(digitalPinToInterrupt(irPin), onEdge, this, CHANGE);
+    }
+
+    void end()
+    {
+        detachInterrupt(digitalPinToInterrupt(irPin));
+    }
+
+    // Next completed pulse, if any. Never blocks.
+    bool read(IRPulse &pulse)
+    {
+        return pulses.pop(pulse);
+    }
+
+    // Drop anything captured so far (e.g. noise while no race is running)
+    void flush()
+    {
+        pulses.clear();
+    }
+
+    // Direct ring access so recorded edge buffers can be replayed through
+    // the same path the ISR feeds
+    PulseRing &ring() { return pulses; }
+
+    uint32_t overflowCount() const { return pulses.droppedCount(); }
+    uint32_t highWaterMark() const { return pulses.highWaterMark(); }
+};
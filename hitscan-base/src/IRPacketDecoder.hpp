@@ -0,0 +1,300 @@
+#pragma once
+
+#include <stdint.h>
+#include "IRTiming.hpp"
+
+// ============================================================================
+// IR Packet Decoder
+// ============================================================================
+// Push-based state machine for the racer ID packet:
+//
+//   SYNC  = burst + long gap
+//   BIT n = burst + short gap (0) or long gap (1), MSB first, 3 bits
+//   CHECK = (v2 only) one more bit, even parity over the 3 ID bits
+//
+// v1 boards send no check bit, so a v1 packet is recognised by the next
+// sync arriving where the check bit would be. Those are only accepted while
+// acceptV1 is set; packets whose check bit disagrees are counted and dropped.
+//
+// The compact encoding (v3) carries the same ID + parity in about half the
+// airtime. Its packet opens with a long marker burst, which no standard
+// packet contains, so both encodings are decoded side by side:
+//
+//   MARKER = long burst + gap A   (gap A encodes ID bits 2,1)
+//   DATA   = burst + gap B        (gap B encodes ID bit 0, parity)
+//
+// Each compact gap is one of four lengths, compactBase + n * compactStep.
+// The levels are Gray coded (00, 01, 11, 10), so a gap read one level long
+// or short flips a single bit and fails parity instead of turning into
+// another racer's ID.
+//
+// Feed every receiver pulse as it is captured. Nothing here blocks or touches
+// hardware, so the same decoder runs on the ESP32 and on a host against
+// recorded or synthetic pulse trains. A glitch only costs the packet it lands
+// in: any valid sync restarts the machine straight away, even mid-packet.
+//
+// Every packet started (a sync or marker seen) ends decoded or counted
+// under one failure: a pulse outside the windows (bad bit), a gap longer
+// than a sync gap (timeout, the signal went), a failed check bit, or a new
+// sync before it was complete (resync).
+//
+// The accepted pulse lengths come from an IRTiming profile (see there).
+// IRPacketDecoder is the nominal one.
+template <typename Timing>
+class BasicIRPacketDecoder
+{
+public:
+    struct Packet
+    {
+        uint8_t racerId;
+        uint64_t timestamp; // Start of the sync burst (µs)
+        uint8_t version;    // 1 = bare ID, 2 = parity checked, 3 = compact
+    };
+
+    static constexpr uint8_t ID_BITS = 3;
+
+private:
+    enum class State : uint8_t
+    {
+        SYNC,      // Waiting for a burst + sync gap
+        BIT_BURST, // Waiting for the burst of the next bit
+        BIT_GAP,   // Waiting for the gap that carries the bit value
+        COMPACT_GAP_A,
+        COMPACT_BURST_B,
+        COMPACT_GAP_B
+    };
+
+    Timing timing;
+    State state = State::SYNC;
+    uint8_t bitCount = 0;
+    uint8_t bits = 0;
+    uint64_t packetStart = 0;
+    bool acceptV1 = true;
+
+    // Every burst is a potential sync burst until its gap says otherwise
+    bool lastBurstValid = false;
+    uint64_t lastBurstStart = 0;
+
+    uint32_t attemptCount = 0;
+    uint32_t packetCount = 0;
+    uint32_t v1Count = 0;
+    uint32_t checkFailures = 0;
+    uint32_t resyncCount = 0;
+    uint32_t badBitCount = 0;
+    uint32_t timeoutCount = 0;
+
+    // Compact gap level 0-3, or -1 if out of range
+    int compactLevel(uint32_t gap) const
+    {
+        const IRTiming::Windows &w = timing.windows();
+        if (!w.compactGap.contains(gap))
+            return -1;
+        uint32_t offset = gap + w.compactStep / 2;
+        if (offset < w.compactBase)
+            return 0;
+        uint32_t level = (offset - w.compactBase) / w.compactStep;
+        return level > 3 ? 3 : level;
+    }
+
+    static uint8_t parity(uint8_t value)
+    {
+        value ^= value >> 2;
+        value ^= value >> 1;
+        return value & 1;
+    }
+
+    void restartAt(uint64_t start)
+    {
+        state = State::BIT_BURST;
+        bitCount = 0;
+        bits = 0;
+        packetStart = start;
+        attemptCount++;
+    }
+
+    // A packet in progress ended on a pulse that fits nowhere
+    void abandon(uint32_t gap)
+    {
+        if (state == State::SYNC)
+            return;
+        if (gap > timing.windows().syncGap.max)
+            timeoutCount++;
+        else
+            badBitCount++;
+        state = State::SYNC;
+    }
+
+    void onBurst(uint32_t duration, uint64_t start)
+    {
+        const IRTiming::Windows &w = timing.windows();
+        lastBurstValid = w.syncBurst.contains(duration);
+        lastBurstStart = start;
+
+        if (w.markerBurst.contains(duration))
+        {
+            if (state != State::SYNC)
+                resyncCount++;
+            state = State::COMPACT_GAP_A;
+            packetStart = start;
+            attemptCount++;
+        }
+        else if (state == State::COMPACT_BURST_B && w.bitBurst.contains(duration))
+            state = State::COMPACT_GAP_B;
+        else if (state == State::BIT_BURST && w.bitBurst.contains(duration))
+            state = State::BIT_GAP;
+        else
+            abandon(0);
+    }
+
+    bool onCompactGap(uint8_t level, uint32_t duration, Packet &packet)
+    {
+        uint8_t symbol = level ^ (level >> 1); // Gray code
+        if (state == State::COMPACT_GAP_A)
+        {
+            bits = symbol;
+            state = State::COMPACT_BURST_B;
+            return false;
+        }
+
+        state = State::SYNC;
+        uint8_t id = (bits << 1) | (symbol >> 1);
+        if (parity(id) != (symbol & 1))
+        {
+            checkFailures++;
+            // A long gap B can be a sync too: if the marker was a glitch,
+            // a standard packet starts here
+            if (lastBurstValid && timing.windows().syncGap.contains(duration))
+                restartAt(lastBurstStart);
+            return false;
+        }
+
+        packet.racerId = id;
+        packet.timestamp = packetStart;
+        packet.version = 3;
+        packetCount++;
+        return true;
+    }
+
+    bool onGap(uint32_t duration, Packet &packet)
+    {
+        if (state == State::COMPACT_GAP_A || state == State::COMPACT_GAP_B)
+        {
+            int level = compactLevel(duration);
+            if (level >= 0)
+                return onCompactGap(level, duration, packet);
+        }
+
+        const IRTiming::Windows &w = timing.windows();
+        if (state == State::BIT_GAP)
+        {
+            int bit = -1;
+            if (w.shortGap.contains(duration))
+                bit = 0;
+            else if (w.longGap.contains(duration))
+                bit = 1;
+
+            if (bit >= 0)
+            {
+                if (bitCount < ID_BITS)
+                {
+                    bits = (bits << 1) | bit;
+                    bitCount++;
+                    state = State::BIT_BURST;
+                    return false;
+                }
+
+                // Check bit
+                state = State::SYNC;
+                if (parity(bits) != bit)
+                {
+                    checkFailures++;
+                    return false;
+                }
+
+                packet.racerId = bits;
+                packet.timestamp = packetStart;
+                packet.version = 2;
+                packetCount++;
+                return true;
+            }
+        }
+
+        // Not a data bit - if it completes a sync, restart the packet here
+        // rather than waiting for the next one
+        if (lastBurstValid && w.syncGap.contains(duration))
+        {
+            // A sync straight after three ID bits is a v1 packet ending
+            bool v1Complete = state == State::BIT_GAP && bitCount == ID_BITS && acceptV1;
+            if (v1Complete)
+            {
+                packet.racerId = bits;
+                packet.timestamp = packetStart;
+                packet.version = 1;
+                packetCount++;
+                v1Count++;
+            }
+            else if (state != State::SYNC)
+            {
+                resyncCount++;
+            }
+
+            restartAt(lastBurstStart);
+            return v1Complete;
+        }
+
+        abandon(duration);
+        return false;
+    }
+
+public:
+    // Feed one receiver pulse. level is the TSOP output (LOW = carrier),
+    // start is the timestamp of the edge that began the pulse. Returns true
+    // and fills packet when the pulse completes a valid packet.
+    bool feed(uint8_t level, uint32_t duration, uint64_t start, Packet &packet)
+    {
+        if (level == 0)
+        {
+            onBurst(duration, start);
+            return false;
+        }
+
+        bool complete = onGap(duration, packet);
+        lastBurstValid = false;
+        return complete;
+    }
+
+    // Replace the timing windows (Runtime profile only; false otherwise,
+    // or if the windows are not valid()). Takes effect with the next pulse.
+    bool setWindows(const IRTiming::Windows &windows) { return timing.set(windows); }
+    IRTiming::Windows windows() const { return timing.windows(); }
+
+    // Accept packets from v1 boards (no check bit). Off = v2 only.
+    void setAcceptV1(bool accept) { acceptV1 = accept; }
+    bool acceptsV1() const { return acceptV1; }
+
+    // Clears decoder state and the per-session counters
+    void reset()
+    {
+        state = State::SYNC;
+        bitCount = 0;
+        bits = 0;
+        lastBurstValid = false;
+        attemptCount = 0;
+        packetCount = 0;
+        v1Count = 0;
+        checkFailures = 0;
+        resyncCount = 0;
+        badBitCount = 0;
+        timeoutCount = 0;
+    }
+
+    uint32_t attempts() const { return attemptCount; }
+    uint32_t packetsDecoded() const { return packetCount; }
+    uint32_t v1Packets() const { return v1Count; }
+    uint32_t checkRejects() const { return checkFailures; }
+    uint32_t resyncs() const { return resyncCount; }
+    uint32_t badBits() const { return badBitCount; }
+    uint32_t timeouts() const { return timeoutCount; }
+};
+
+using IRPacketDecoder = BasicIRPacketDecoder<IRTiming::Nominal>;
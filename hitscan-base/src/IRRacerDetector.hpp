@@ -1,4 +1,7 @@
 #include <Arduino.h>
+#include "IRCapture.hpp"
+#include "IRPacketDecoder.hpp"
+#include "PassAggregator.hpp"
 
 /*
  * ESP32 Race Timer System
@@ -12,100 +15,91 @@
  * - SD card logging
  */
 
+// Decoder timing profile (see IRTiming). Runtime takes calibrated windows;
+// -DIR_TIMING_PROFILE=Nominal or StrongSignal fixes them at compile time.
+#ifndef IR_TIMING_PROFILE
+#define IR_TIMING_PROFILE Runtime
+#endif
+
 // ============================================================================
 // IR Detector Class
 // ============================================================================
+// Glue between the edge capture ring, the streaming packet decoder and the
+// pass aggregator: pulses in, one crossing per gate pass out.
 class IRRacerDetector
 {
+public:
+    using Decoder = BasicIRPacketDecoder<IRTiming::IR_TIMING_PROFILE>;
+
 private:
-    const uint8_t irPin;
+    IRCapture capture;
+    Decoder decoder;
+    PassAggregator passes;
 
-    // Timing constants (±30% tolerance)
-    static constexpr unsigned long SYNC_BURST_MIN = 190;
-    static constexpr unsigned long SYNC_BURST_MAX = 350;
-    static constexpr unsigned long SYNC_GAP_MIN = 630;
-    static constexpr unsigned long SYNC_GAP_MAX = 1170;
-    static constexpr unsigned long BIT_BURST_MIN = 190;
-    static constexpr unsigned long BIT_BURST_MAX = 350;
-    static constexpr unsigned long SHORT_GAP_MIN = 210;
-    static constexpr unsigned long SHORT_GAP_MAX = 390;
-    static constexpr unsigned long LONG_GAP_MIN = 420;
-    static constexpr unsigned long LONG_GAP_MAX = 780;
-    static constexpr unsigned long TIMEOUT_US = 2000;
+public:
+    using Packet = Decoder::Packet;
+    using Crossing = PassAggregator::Crossing;
 
-    // Fast inline measurement (runs on Core 1, uninterrupted)
-    inline unsigned long measurePulse(bool level, unsigned long timeout)
-    {
-        unsigned long start = micros();
-        while (digitalRead(irPin) == level)
-        {
-            if (micros() - start > timeout)
-                return 0;
-        }
-        return micros() - start;
-    }
+    IRRacerDetector(uint8_t pin) : capture(pin) {}
 
-    bool detectSync()
+    void begin()
     {
-        unsigned long timeout = millis() + 100;
-        while (digitalRead(irPin) == HIGH)
-        {
-            if (millis() > timeout)
-                return false;
-        }
-
-        unsigned long burst = measurePulse(LOW, TIMEOUT_US);
-        if (burst < SYNC_BURST_MIN || burst > SYNC_BURST_MAX)
-            return false;
+        capture.begin();
+    }
 
-        unsigned long gap = measurePulse(HIGH, TIMEOUT_US);
-        if (gap < SYNC_GAP_MIN || gap > SYNC_GAP_MAX)
-            return false;
+    IRCapture &edges() { return capture; }
+    const Decoder &packetDecoder() const { return decoder; }
+    const PassAggregator &passAggregator() const { return passes; }
 
-        return true;
+    void configurePasses(const PassAggregator::Config &config)
+    {
+        passes.configure(config);
     }
 
-    int readBit()
+    // False if the timing profile is fixed at compile time
+    bool setWindows(const IRTiming::Windows &windows)
     {
-        unsigned long burst = measurePulse(LOW, TIMEOUT_US);
-        if (burst < BIT_BURST_MIN || burst > BIT_BURST_MAX)
-            return -1;
-
-        unsigned long gap = measurePulse(HIGH, TIMEOUT_US);
-
-        if (gap >= SHORT_GAP_MIN && gap <= SHORT_GAP_MAX)
-            return 0;
-        if (gap >= LONG_GAP_MIN && gap <= LONG_GAP_MAX)
-            return 1;
-
-        return -1;
+        return decoder.setWindows(windows);
     }
 
-public:
-    IRRacerDetector(uint8_t pin) : irPin(pin) {}
-
-    void begin()
+    // false = only accept parity-checked v2 packets
+    void setAcceptV1(bool accept)
     {
-        pinMode(irPin, INPUT);
+        decoder.setAcceptV1(accept);
     }
 
-    int decode()
+    // Feed captured pulses to the decoder until a packet completes or the
+    // ring runs dry. Never blocks; call again to continue where it left off.
+    bool readPacket(Packet &packet)
     {
-        if (!detectSync())
-            return -1;
-
-        int bit2 = readBit();
-        if (bit2 < 0)
-            return -1;
-
-        int bit1 = readBit();
-        if (bit1 < 0)
-            return -1;
+        IRPulse pulse;
+        while (capture.read(pulse))
+        {
+            if (decoder.feed(pulse.level, pulse.duration, pulse.start, packet))
+                return true;
+        }
+        return false;
+    }
 
-        int bit0 = readBit();
-        if (bit0 < 0)
-            return -1;
+    // Next finished gate pass. Decoded packets are folded into their
+    // racer's open pass; a crossing is only reported once the pass is over,
+    // i.e. PassAggregator::Config::gapUs after its last packet.
+    bool poll(Crossing &crossing)
+    {
+        Packet packet;
+        while (readPacket(packet))
+        {
+            if (passes.add(packet.racerId, packet.timestamp, crossing))
+                return true;
+        }
+        return passes.poll(esp_timer_get_time(), crossing);
+    }
 
-        return (bit2 << 2) | (bit1 << 1) | bit0;
+    // Start from a clean slate (e.g. at race start)
+    void reset()
+    {
+        capture.flush();
+        decoder.reset();
+        passes.reset();
     }
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// IR Timing Windows
+// ============================================================================
+// The pulse lengths IRPacketDecoder accepts for each part of a packet.
+// The nominal windows are ±30% around what the blaster sends. A TSOP
+// receiver lengthens every burst, by more the stronger the signal, and the
+// following gap gets shorter by the same amount, so an installation close
+// to the track sits at one edge of them. IRCalibrator learns windows for
+// the gate it is in; shifted() moves the nominal set by a known stretch.
+//
+// The decoder takes its windows from a profile type. The fixed profiles
+// return constexpr windows, so their range checks compile to constants;
+// Runtime holds windows that can be replaced while running.
+struct IRWindow
+{
+    uint16_t min;
+    uint16_t max;
+
+    constexpr bool contains(uint32_t value) const { return value >= min && value <= max; }
+};
+
+struct IRTiming
+{
+    // Nominal windows (±30% tolerance)
+    static constexpr uint32_t SYNC_BURST_MIN = 190;
+    static constexpr uint32_t SYNC_BURST_MAX = 350;
+    static constexpr uint32_t SYNC_GAP_MIN = 630;
+    static constexpr uint32_t SYNC_GAP_MAX = 1170;
+    static constexpr uint32_t BIT_BURST_MIN = 190;
+    static constexpr uint32_t BIT_BURST_MAX = 350;
+    static constexpr uint32_t SHORT_GAP_MIN = 210;
+    static constexpr uint32_t SHORT_GAP_MAX = 390;
+    static constexpr uint32_t LONG_GAP_MIN = 420;
+    static constexpr uint32_t LONG_GAP_MAX = 780;
+
+    // Compact encoding. Symbol boundaries sit halfway between the nominal
+    // gap lengths (300/450/600/750µs).
+    static constexpr uint32_t MARKER_BURST_MIN = 400;
+    static constexpr uint32_t MARKER_BURST_MAX = 700;
+    static constexpr uint32_t COMPACT_GAP_MIN = 200;
+    static constexpr uint32_t COMPACT_GAP_BASE = 300;
+    static constexpr uint32_t COMPACT_GAP_STEP = 150;
+    static constexpr uint32_t COMPACT_GAP_MAX = 840;
+
+    // Burst stretch of the StrongSignal profile: a TSOP38x a few metres
+    // from the blaster, in the middle of the datasheet's output pulse range
+    static constexpr int16_t STRONG_SIGNAL_STRETCH_US = 100;
+
+    struct Windows
+    {
+        IRWindow syncBurst;
+        IRWindow syncGap;
+        IRWindow bitBurst;
+        IRWindow shortGap;
+        IRWindow longGap;
+        IRWindow markerBurst;
+        IRWindow compactGap;  // Outer limits of all four compact symbols
+        uint16_t compactBase; // Gap of compact symbol 0
+        uint16_t compactStep;
+    };
+
+    static constexpr Windows nominal()
+    {
+        return {{SYNC_BURST_MIN, SYNC_BURST_MAX},
+                {SYNC_GAP_MIN, SYNC_GAP_MAX},
+                {BIT_BURST_MIN, BIT_BURST_MAX},
+                {SHORT_GAP_MIN, SHORT_GAP_MAX},
+                {LONG_GAP_MIN, LONG_GAP_MAX},
+                {MARKER_BURST_MIN, MARKER_BURST_MAX},
+                {COMPACT_GAP_MIN, COMPACT_GAP_MAX},
+                COMPACT_GAP_BASE,
+                COMPACT_GAP_STEP};
+    }
+
+    static constexpr IRWindow shift(IRWindow window, int32_t us)
+    {
+        return {(uint16_t)(window.min + us), (uint16_t)(window.max + us)};
+    }
+
+    // Nominal windows for receiver output whose bursts are stretchUs longer
+    // (and gaps that much shorter) than sent. |stretchUs| < 150.
+    static constexpr Windows shifted(int16_t stretchUs)
+    {
+        return {shift(nominal().syncBurst, stretchUs),
+                shift(nominal().syncGap, -stretchUs),
+                shift(nominal().bitBurst, stretchUs),
+                shift(nominal().shortGap, -stretchUs),
+                shift(nominal().longGap, -stretchUs),
+                shift(nominal().markerBurst, stretchUs),
+                shift(nominal().compactGap, -stretchUs),
+                (uint16_t)(COMPACT_GAP_BASE - stretchUs),
+                COMPACT_GAP_STEP};
+    }
+
+    // Usable by the decoder: every window ordered, and the pairs the
+    // decoder cannot tell apart by state (short/long gap, data/marker
+    // burst) disjoint. Long and sync gap may overlap: a bit gap is tried
+    // first.
+    static bool valid(const Windows &w)
+    {
+        const IRWindow *all[] = {&w.syncBurst, &w.syncGap, &w.bitBurst, &w.shortGap,
+                                 &w.longGap, &w.markerBurst, &w.compactGap};
+        for (const IRWindow *window : all)
+        {
+            if (window->min == 0 || window->min > window->max)
+                return false;
+        }
+        return w.shortGap.max < w.longGap.min && w.bitBurst.max < w.markerBurst.min &&
+               w.syncBurst.max < w.markerBurst.min && w.compactStep > 0 && w.compactBase >= w.compactGap.min;
+    }
+
+    // ------------------------------------------------------------------------
+    // Profiles
+    // ------------------------------------------------------------------------
+    // set() returns whether the profile took the windows; the fixed ones
+    // never do.
+    struct Nominal
+    {
+        static constexpr Windows windows() { return nominal(); }
+        static bool set(const Windows &) { return false; }
+    };
+
+    struct StrongSignal
+    {
+        static constexpr Windows windows() { return shifted(STRONG_SIGNAL_STRETCH_US); }
+        static bool set(const Windows &) { return false; }
+    };
+
+    class Runtime
+    {
+        Windows current = nominal();
+
+    public:
+        const Windows &windows() const { return current; }
+
+        bool set(const Windows &windows)
+        {
+            if (!valid(windows))
+                return false;
+            current = windows;
+            return true;
+        }
+    };
+};
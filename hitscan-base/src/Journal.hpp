@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "Crc32.hpp"
+#include "RaceState.hpp"
+
+// ============================================================================
+// Session Journal
+// ============================================================================
+// Append-only record of everything that changes race state, so a session
+// survives a brownout or watchdog reset. Each entry is 16 bytes with its
+// own CRC-32; replaying the entries through RaceState rebuilds results,
+// laps, fastest lap and personal bests exactly, because they are derived
+// from the same crossings in the same order.
+//
+// A new race rewrites the journal from a START entry (plus the personal
+// best laps and runs carried over), so replay never covers more than one race and its
+// time is bounded by MAX_BYTES. Replay stops at the first entry that fails
+// its check: a torn tail from a write cut short, or an erased/zeroed area.
+// Hardware independent; JournalStore keeps it on the SD card.
+class Journal
+{
+public:
+    static constexpr size_t MAX_BYTES = 256 * 1024; // 16384 entries
+    static constexpr uint64_t TICK_US = 5000000;    // Race clock checkpoint when idle
+
+    enum class Type : uint8_t
+    {
+        START = 1, // value = mode, data = race number << 32 | last seq before it
+        BEST,      // Personal best carried into this race, data = lap time
+        CROSSING,  // data = µs since race start
+        TICK,      // Race still running at data µs
+        STOP,      // data = race duration
+        MODE,      // value = mode (between races)
+        BEST_RUN   // Best run carried into this race, data = sum of LapStats::CONSECUTIVE laps
+    };
+
+    struct Entry
+    {
+        Type type;
+        uint8_t racerId;
+        uint8_t reads;
+        uint8_t value;
+        uint32_t crc; // CRC-32 of the other 12 bytes
+        uint64_t data;
+    };
+
+    static_assert(sizeof(Entry) == 16, "Entry layout is the on-card format");
+
+    static uint32_t checksum(const Entry &entry)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&entry);
+        uint32_t crc = crc32(bytes, offsetof(Entry, crc));
+        return crc32(bytes + offsetof(Entry, data), sizeof(entry.data), crc);
+    }
+
+    static bool valid(const Entry &entry)
+    {
+        return entry.type >= Type::START && entry.type <= Type::BEST_RUN && entry.crc == checksum(entry);
+    }
+
+    static Entry seal(Type type, uint8_t racerId, uint8_t reads, uint8_t value, uint64_t data)
+    {
+        Entry entry = {type, racerId, reads, value, 0, data};
+        entry.crc = checksum(entry);
+        return entry;
+    }
+
+    static Entry start(uint32_t raceNumber, uint32_t lastSeq, RaceState::Mode mode)
+    {
+        return seal(Type::START, 0, 0, (uint8_t)mode, (uint64_t)raceNumber << 32 | lastSeq);
+    }
+
+    static Entry best(uint8_t racerId, uint64_t lapTime) { return seal(Type::BEST, racerId, 0, 0, lapTime); }
+    static Entry bestRun(uint8_t racerId, uint64_t runTime) { return seal(Type::BEST_RUN, racerId, 0, 0, runTime); }
+
+    static Entry crossing(uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        return seal(Type::CROSSING, racerId, reads, 0, timestamp);
+    }
+
+    static Entry tick(uint64_t elapsed) { return seal(Type::TICK, 0, 0, 0, elapsed); }
+    static Entry stop(uint64_t elapsed) { return seal(Type::STOP, 0, 0, 0, elapsed); }
+    static Entry mode(RaceState::Mode mode) { return seal(Type::MODE, 0, 0, (uint8_t)mode, 0); }
+
+    // ------------------------------------------------------------------
+    // Replay: feed entries in file order until apply() returns false
+    // ------------------------------------------------------------------
+    class Replay
+    {
+    private:
+        RaceState &race;
+
+    public:
+        bool active = false;    // A race was running when the journal ends
+        uint64_t elapsedUs = 0; // Last known race clock
+        uint32_t entries = 0;
+
+        explicit Replay(RaceState &race) : race(race) {}
+
+        // False for an entry that fails its check; nothing after it counts
+        bool apply(const Entry &entry)
+        {
+            if (!valid(entry))
+                return false;
+
+            switch (entry.type)
+            {
+            case Type::START:
+                race.reset();
+                race.restoreCounters(entry.data >> 32, (uint32_t)entry.data);
+                race.setMode((RaceState::Mode)entry.value);
+                active = true;
+                elapsedUs = 0;
+                break;
+
+            case Type::BEST:
+                race.restorePersonalBest(entry.racerId, entry.data);
+                break;
+
+            case Type::BEST_RUN:
+                race.restorePersonalBestRun(entry.racerId, entry.data);
+                break;
+
+            case Type::CROSSING:
+                race.record(entry.racerId, entry.data, entry.reads);
+                if (entry.data > elapsedUs)
+                    elapsedUs = entry.data;
+                break;
+
+            case Type::TICK:
+                if (entry.data > elapsedUs)
+                    elapsedUs = entry.data;
+                break;
+
+            case Type::STOP:
+                active = false;
+                elapsedUs = entry.data;
+                break;
+
+            case Type::MODE:
+                race.setMode((RaceState::Mode)entry.value);
+                break;
+            }
+            entries++;
+            return true;
+        }
+    };
+};
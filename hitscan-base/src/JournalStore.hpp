@@ -0,0 +1,227 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_timer.h>
+#include "Journal.hpp"
+#include "SpscRing.hpp"
+
+// ============================================================================
+// Journal Store (SD card)
+// ============================================================================
+// Keeps the session Journal in a file. begin() replays it into RaceState
+// and cuts off a torn tail; after that the loop queues entries (a 16-byte
+// copy into a lock-free ring) and a low-priority task appends and flushes
+// them, so a crossing is on the card within milliseconds without the loop
+// or detection ever waiting for it.
+//
+// The SD card rather than SPIFFS: writing internal flash stalls the cache
+// on both cores, which would delay the IR capture interrupt.
+class JournalStore
+{
+public:
+    struct Resume
+    {
+        bool active = false;    // Race was running: continue it
+        uint64_t elapsedUs = 0; // Race clock at the last entry
+        uint32_t entries = 0;
+        uint32_t discardedBytes = 0; // Torn or corrupt tail cut off
+        uint32_t replayMs = 0;
+    };
+
+private:
+    static constexpr size_t ENTRY_SIZE = sizeof(Journal::Entry);
+    static constexpr size_t READ_ENTRIES = 32; // 512-byte reads during replay
+
+    fs::FS *fs = nullptr;
+    const char *path = nullptr;
+    char tempPath[40];
+    File file;
+
+    SpscRing<Journal::Entry, 64> pending; // Loop produces, writer task consumes
+    TaskHandle_t writerTaskHandle = NULL;
+    bool ready = false;
+
+    size_t bytes = 0;        // Writer task owned
+    uint32_t overCap = 0;    // Entries past MAX_BYTES (writer task)
+    uint64_t lastEntryUs = 0; // Race clock of the last queued entry (loop)
+
+    static void writerTask(void *parameter)
+    {
+        JournalStore *store = (JournalStore *)parameter;
+
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            Journal::Entry entry;
+            bool wrote = false;
+            while (store->pending.pop(entry))
+            {
+                if (entry.type == Journal::Type::START)
+                {
+                    // New race: the journal starts over
+                    store->file.close();
+                    store->file = store->fs->open(store->path, FILE_WRITE);
+                    store->bytes = 0;
+                }
+                if (store->bytes + ENTRY_SIZE > Journal::MAX_BYTES)
+                {
+                    store->overCap++;
+                    continue;
+                }
+                store->file.write(reinterpret_cast<const uint8_t *>(&entry), ENTRY_SIZE);
+                store->bytes += ENTRY_SIZE;
+                wrote = true;
+            }
+            if (wrote)
+                store->file.flush();
+        }
+    }
+
+    void queue(const Journal::Entry &entry)
+    {
+        if (!ready)
+            return;
+        pending.push(entry); // A full ring counts the drop
+        xTaskNotifyGive(writerTaskHandle);
+    }
+
+    // Keep the first length bytes: copy them to a temp file and swap it in
+    bool truncate(size_t length)
+    {
+        File in = fs->open(path, FILE_READ);
+        File out = fs->open(tempPath, FILE_WRITE);
+        if (!in || !out)
+            return false;
+
+        uint8_t buffer[512];
+        size_t left = length;
+        while (left)
+        {
+            size_t chunk = in.read(buffer, left < sizeof(buffer) ? left : sizeof(buffer));
+            if (chunk == 0 || out.write(buffer, chunk) != chunk)
+                return false;
+            left -= chunk;
+        }
+        in.close();
+        out.close();
+
+        fs->remove(path);
+        return fs->rename(tempPath, path);
+    }
+
+public:
+    // Replay the journal at path into race, then start the writer task
+    Resume begin(fs::FS &journalFs, const char *journalPath, RaceState &race)
+    {
+        fs = &journalFs;
+        path = journalPath;
+        snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+        // Power lost between remove and rename of a previous truncate
+        if (!fs->exists(path) && fs->exists(tempPath))
+            fs->rename(tempPath, path);
+
+        Resume resume;
+        uint32_t started = millis();
+        size_t validBytes = 0;
+        size_t fileBytes = 0;
+
+        File in = fs->open(path, FILE_READ);
+        if (in)
+        {
+            fileBytes = in.size();
+            Journal::Replay replay(race);
+            Journal::Entry entries[READ_ENTRIES];
+            bool intact = true;
+
+            while (intact && validBytes < Journal::MAX_BYTES)
+            {
+                size_t got = in.read(reinterpret_cast<uint8_t *>(entries), sizeof(entries)) / ENTRY_SIZE;
+                if (got == 0)
+                    break;
+                for (size_t i = 0; i < got && intact; i++)
+                {
+                    intact = replay.apply(entries[i]);
+                    if (intact)
+                        validBytes += ENTRY_SIZE;
+                }
+            }
+            in.close();
+
+            resume.active = replay.active;
+            resume.elapsedUs = replay.elapsedUs;
+            resume.entries = replay.entries;
+        }
+
+        if (validBytes < fileBytes)
+        {
+            resume.discardedBytes = fileBytes - validBytes;
+            if (!truncate(validBytes))
+                Serial.println("Journal: truncate failed");
+        }
+        resume.replayMs = millis() - started;
+
+        file = fs->open(path, FILE_APPEND);
+        if (!file)
+        {
+            Serial.printf("Journal: cannot open %s\n", path);
+            return resume;
+        }
+        bytes = validBytes;
+        lastEntryUs = resume.elapsedUs;
+
+        xTaskCreatePinnedToCore(
+            writerTask,        // Task function
+            "Journal",         // Name
+            4096,              // Stack size (bytes)
+            this,              // Parameters
+            1,                 // Priority (low)
+            &writerTaskHandle, // Task handle
+            0                  // Core 0, away from detection
+        );
+        ready = true;
+
+        Serial.printf("Journal: %u entries replayed in %u ms, %u bytes discarded\n",
+                      resume.entries, resume.replayMs, resume.discardedBytes);
+        return resume;
+    }
+
+    // New race: restarts the journal, carrying the personal bests over
+    void started(const RaceState &race)
+    {
+        queue(Journal::start(race.raceNumber(), race.lastSeq(), race.getMode()));
+        for (uint8_t r = 0; r < RaceState::MAX_RACERS; r++)
+        {
+            if (race.personalBest(r) != RaceState::NO_TIME)
+                queue(Journal::best(r, race.personalBest(r)));
+            if (race.personalBestRun(r) != RaceState::NO_TIME)
+                queue(Journal::bestRun(r, race.personalBestRun(r)));
+        }
+        lastEntryUs = 0;
+    }
+
+    void crossing(uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        queue(Journal::crossing(racerId, timestamp, reads));
+        lastEntryUs = timestamp;
+    }
+
+    void stopped(uint64_t elapsed) { queue(Journal::stop(elapsed)); }
+    void modeChanged(RaceState::Mode mode) { queue(Journal::mode(mode)); }
+
+    // Call regularly from the loop while a race runs: checkpoints the race
+    // clock if nothing was journaled for TICK_US, so a resume after a
+    // quiet spell does not restart the clock too far back
+    void update(uint64_t elapsed)
+    {
+        if (elapsed - lastEntryUs < Journal::TICK_US)
+            return;
+        queue(Journal::tick(elapsed));
+        lastEntryUs = elapsed;
+    }
+
+    bool enabled() const { return ready; }
+    uint32_t dropped() const { return pending.droppedCount() + overCap; }
+};
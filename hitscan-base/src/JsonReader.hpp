@@ -0,0 +1,235 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// JSON Reader
+// ============================================================================
+// Pull parser over a request body for the few small objects the API
+// accepts. The caller walks the document it expects; any mismatch clears
+// ok() and every later call fails, so a handler checks once at the end.
+// Values it doesn't want are skipped with skipValue(). Nothing here
+// allocates.
+//
+//   JsonReader json(body, length);
+//   char key[16];
+//   json.beginObject();
+//   while (json.nextKey(key, sizeof(key)))
+//       if (!strcmp(key, "id")) json.number(id); else json.skipValue();
+//   if (json.end()) ...
+class JsonReader
+{
+private:
+    static constexpr uint8_t MAX_DEPTH = 8; // For skipValue()
+
+    const char *p;
+    const char *limit;
+    bool valid = true;
+    bool first = true; // Before the first item of the current array/object
+
+    void skipSpace()
+    {
+        while (p < limit && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool fail()
+    {
+        valid = false;
+        return false;
+    }
+
+    bool take(char c)
+    {
+        skipSpace();
+        if (!valid || p == limit || *p != c)
+            return false;
+        p++;
+        return true;
+    }
+
+    bool expect(char c) { return take(c) || fail(); }
+
+    // Comma handling shared by arrays and objects: false at the closer
+    bool nextItem(char closer)
+    {
+        if (take(closer))
+        {
+            first = false; // Back in the parent, after this item
+            return false;
+        }
+        if (!first && !expect(','))
+            return false;
+        first = false;
+        return valid;
+    }
+
+public:
+    JsonReader(const char *text, size_t length) : p(text), limit(text + length) {}
+
+    bool ok() const { return valid; }
+
+    bool beginObject()
+    {
+        first = true;
+        return expect('{');
+    }
+
+    bool beginArray()
+    {
+        first = true;
+        return expect('[');
+    }
+
+    // Next element of an array; false at ']'
+    bool nextElement() { return nextItem(']'); }
+
+    // Next key of an object; false at '}'
+    bool nextKey(char *key, size_t size)
+    {
+        if (!nextItem('}'))
+            return false;
+        return string(key, size) && expect(':');
+    }
+
+    // A string into out, NUL terminated. Fails if it doesn't fit. \u
+    // escapes outside ASCII become '?'.
+    bool string(char *out, size_t size)
+    {
+        if (!expect('"'))
+            return false;
+        size_t n = 0;
+        while (p < limit && *p != '"')
+        {
+            char c = *p++;
+            if (c == '\\')
+            {
+                if (p == limit)
+                    return fail();
+                c = *p++;
+                switch (c)
+                {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u':
+                {
+                    if (limit - p < 4)
+                        return fail();
+                    char hex[5] = {p[0], p[1], p[2], p[3], 0};
+                    long code = strtol(hex, nullptr, 16);
+                    c = code > 0 && code < 0x80 ? (char)code : '?';
+                    p += 4;
+                    break;
+                }
+                default: break; // \" \\ \/
+                }
+            }
+            if (n + 1 >= size)
+                return fail();
+            out[n++] = c;
+        }
+        if (p == limit)
+            return fail();
+        p++;
+        out[n] = '\0';
+        return true;
+    }
+
+    bool number(long &value)
+    {
+        skipSpace();
+        if (!valid || p == limit)
+            return fail();
+        char buffer[24];
+        size_t n = 0;
+        while (p < limit && n + 1 < sizeof(buffer) && (*p == '-' || *p == '+' || *p == '.' || *p == 'e' ||
+                                                    *p == 'E' || (*p >= '0' && *p <= '9')))
+            buffer[n++] = *p++;
+        buffer[n] = '\0';
+        char *parsed;
+        value = strtol(buffer, &parsed, 10);
+        return (n && *parsed == '\0') || fail(); // Integers only
+    }
+
+    // Consume null; false (without failing) if the value is something else
+    bool null()
+    {
+        skipSpace();
+        if (!valid || limit - p < 4 || strncmp(p, "null", 4))
+            return false;
+        p += 4;
+        return true;
+    }
+
+    // Skip one value of any type
+    bool skipValue()
+    {
+        skipSpace();
+        if (!valid || p == limit)
+            return fail();
+        if (*p == '"')
+        {
+            for (p++; p < limit && *p != '"'; p++)
+            {
+                if (*p == '\\')
+                    p++;
+            }
+            if (p >= limit)
+                return fail();
+            p++;
+            return true;
+        }
+        if (*p == '{' || *p == '[')
+        {
+            // Brackets only need counting; strings inside are skipped whole
+            char stack[MAX_DEPTH];
+            uint8_t depth = 0;
+            while (p < limit)
+            {
+                if (*p == '"')
+                {
+                    if (!skipValue())
+                        return false;
+                    continue;
+                }
+                if (*p == '{' || *p == '[')
+                {
+                    if (depth == MAX_DEPTH)
+                        return fail();
+                    stack[depth++] = *p == '{' ? '}' : ']';
+                }
+                else if (*p == '}' || *p == ']')
+                {
+                    if (*p != stack[--depth])
+                        return fail();
+                    if (depth == 0)
+                    {
+                        p++;
+                        return true;
+                    }
+                }
+                p++;
+            }
+            return fail();
+        }
+        // Number or literal: up to the next delimiter
+        const char *start = p;
+        while (p < limit && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' &&
+               *p != '\t')
+            p++;
+        return p > start || fail();
+    }
+
+    // The document is complete: nothing failed and only whitespace is left
+    bool end()
+    {
+        skipSpace();
+        return valid && p == limit;
+    }
+};
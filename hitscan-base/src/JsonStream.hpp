@@ -0,0 +1,235 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// JSON Stream Writer
+// ============================================================================
+// Serialises JSON into a fixed caller-owned buffer and hands it to a sink
+// whenever it fills (e.g. one HTTP chunk), so a response of any length is
+// sent without building it in one big String. Commas are placed from a
+// small nesting stack; strings are escaped. Nothing here allocates.
+//
+//   JsonStream json(buffer, sizeof(buffer), sink, context);
+//   json.beginArray();
+//   json.beginObject().field("racer", 3).field("name", name).endObject();
+//   json.endArray();
+//   json.flush();
+class JsonStream
+{
+public:
+    using Sink = void (*)(void *context, const char *data, size_t length);
+
+private:
+    static constexpr uint8_t MAX_DEPTH = 16;
+
+    char *buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t total = 0;
+    Sink sink;
+    void *context;
+
+    uint8_t depth = 0;
+    uint16_t hasItems = 0; // Bit per depth: an item was already written
+    bool afterKey = false;
+
+    void put(char c)
+    {
+        if (used == capacity)
+            flush();
+        buffer[used++] = c;
+        total++;
+    }
+
+    // Comma before the next array item or object key
+    void separate()
+    {
+        if (afterKey)
+        {
+            afterKey = false;
+            return;
+        }
+        uint16_t bit = 1u << depth;
+        if (hasItems & bit)
+            put(',');
+        hasItems |= bit;
+    }
+
+    JsonStream &open(char c)
+    {
+        separate();
+        put(c);
+        if (depth < MAX_DEPTH - 1)
+            depth++;
+        hasItems &= ~(1u << depth);
+        return *this;
+    }
+
+    void quoted(const char *text)
+    {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+        put('"');
+        for (; *text; text++)
+        {
+            uint8_t c = *text;
+            if (c == '"' || c == '\\')
+            {
+                put('\\');
+                put(c);
+            }
+            else if (c < 0x20)
+            {
+                put('\\');
+                put('u');
+                put('0');
+                put('0');
+                put(HEX_DIGITS[c >> 4]);
+                put(HEX_DIGITS[c & 15]);
+            }
+            else
+                put(c);
+        }
+        put('"');
+    }
+
+    void putDigits(uint64_t value)
+    {
+        char digits[20];
+        uint8_t count = 0;
+        do
+        {
+            digits[count++] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        while (count)
+            put(digits[--count]);
+    }
+
+    JsonStream &close(char c)
+    {
+        if (depth > 0)
+            depth--;
+        put(c);
+        return *this;
+    }
+
+public:
+    JsonStream(char *buffer, size_t capacity, Sink sink, void *context)
+        : buffer(buffer), capacity(capacity), sink(sink), context(context) {}
+
+    JsonStream(const JsonStream &) = delete;
+    JsonStream &operator=(const JsonStream &) = delete;
+
+    JsonStream &beginObject() { return open('{'); }
+    JsonStream &endObject() { return close('}'); }
+    JsonStream &beginArray() { return open('['); }
+    JsonStream &endArray() { return close(']'); }
+
+    JsonStream &key(const char *name)
+    {
+        separate();
+        quoted(name);
+        put(':');
+        afterKey = true;
+        return *this;
+    }
+
+    JsonStream &number(uint64_t value)
+    {
+        separate();
+        putDigits(value);
+        return *this;
+    }
+
+    JsonStream &integer(int64_t value)
+    {
+        separate();
+        if (value < 0)
+            put('-');
+        putDigits(value < 0 ? 0 - (uint64_t)value : (uint64_t)value);
+        return *this;
+    }
+
+    JsonStream &boolean(bool value)
+    {
+        separate();
+        raw(value ? "true" : "false");
+        return *this;
+    }
+
+    JsonStream &field(const char *name, uint64_t value) { return key(name).number(value); }
+    JsonStream &field(const char *name, const char *value) { return key(name).text(value); }
+    JsonStream &fieldBool(const char *name, bool value) { return key(name).boolean(value); }
+    JsonStream &fieldSigned(const char *name, int64_t value) { return key(name).integer(value); }
+
+    // Escaped string value
+    JsonStream &text(const char *value)
+    {
+        separate();
+        quoted(value);
+        return *this;
+    }
+
+    // Unescaped bytes, for pre-formatted JSON
+    JsonStream &raw(const char *text)
+    {
+        while (*text)
+            put(*text++);
+        return *this;
+    }
+
+    // Hand buffered bytes to the sink
+    void flush()
+    {
+        if (used)
+            sink(context, buffer, used);
+        used = 0;
+    }
+
+    size_t bytesWritten() const { return total; }
+};
+
+// ============================================================================
+// JSON Text
+// ============================================================================
+// A small JSON value that has to come out in one piece (an event, one item of
+// a chunked response), formatted into a fixed buffer. Running out of room
+// marks it overflowed instead of flushing a partial value.
+//
+//   JsonText<256> text;
+//   text.json().beginObject().field("race", 3).endObject();
+//   if (text.c_str()) send(text.c_str());
+template <size_t N>
+class JsonText
+{
+private:
+    char buffer[N + 1];
+    bool overflowed = false;
+    JsonStream stream;
+
+    static void overflow(void *context, const char *, size_t)
+    {
+        static_cast<JsonText *>(context)->overflowed = true;
+    }
+
+public:
+    JsonText() : stream(buffer, N, overflow, this) {}
+
+    JsonText(const JsonText &) = delete;
+    JsonText &operator=(const JsonText &) = delete;
+
+    JsonStream &json() { return stream; }
+
+    // Null-terminated text, or nullptr if it did not fit
+    const char *c_str()
+    {
+        if (overflowed)
+            return nullptr;
+        buffer[stream.bytesWritten()] = '\0';
+        return buffer;
+    }
+
+    size_t length() const { return stream.bytesWritten(); }
+};
@@ -1,24 +1,40 @@
+#pragma once
 
-#include <Adafruit_NeoPixel.h>
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "LedEngine.hpp"
+#include "Metrics.hpp"
 
 // ============================================================================
-// LED Ring Controller Class
+// LED Ring Controller Class (WS2812)
 // ============================================================================
+// update() renders a LedEngine frame every FRAME_MS and sends it only if it
+// changed. Frames go out through the RMT peripheral: the bits are encoded
+// into RMT items and the transfer runs in the background with interrupts
+// on, instead of a bit-banged show() that blocks them for the whole strip.
+// A frame that is ready while the previous one is still going out waits
+// for the next update().
 class LEDRing
 {
 private:
-    Adafruit_NeoPixel strip;
-    unsigned long lastUpdate = 0;
-    unsigned long pulseStart = 0;
-    int pulsingRacer = -1;
+    static constexpr rmt_channel_t RMT_CHANNEL = RMT_CHANNEL_0;
+    static constexpr uint32_t FRAME_MS = 20; // 50 fps
+    static constexpr uint8_t BRIGHTNESS = 50;
+
+    // WS2812 bit timings in 25 ns RMT ticks (80 MHz APB / 2)
+    static constexpr uint8_t RMT_CLK_DIV = 2;
+    static constexpr uint16_t T0H = 16, T0L = 34; // 0.40 / 0.85 us
+    static constexpr uint16_t T1H = 32, T1L = 18; // 0.80 / 0.45 us
+
+    uint8_t pin;
+    LedEngine engine;
+    rmt_item32_t *items = nullptr; // 24 per LED, GRB order, MSB first
+    uint32_t lastFrameMs = 0;
+    bool pending = false; // Changed frame not sent yet
+    LatencyHistogram sendTime; // Encoding a frame and starting the RMT
 
     // Racer colors (RGB)
-    struct Color
-    {
-        uint8_t r, g, b;
-    };
-
-    const Color racerColors[8] = {
+    const LedEngine::Pixel racerColors[8] = {
         {255, 0, 0},   // 0: Red
         {0, 255, 0},   // 1: Green
         {0, 0, 255},   // 2: Blue
@@ -29,94 +45,114 @@ private:
         {128, 0, 255}  // 7: Purple
     };
 
+    void encode(uint8_t value, rmt_item32_t *out)
+    {
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            bool one = value & (0x80 >> bit);
+            out[bit].level0 = 1;
+            out[bit].duration0 = one ? T1H : T0H;
+            out[bit].level1 = 0;
+            out[bit].duration1 = one ? T1L : T0L;
+        }
+    }
+
+    // Start sending the current frame. False if the last one is still
+    // going out.
+    bool send()
+    {
+        if (rmt_wait_tx_done(RMT_CHANNEL, 0) != ESP_OK)
+            return false;
+
+        const LedEngine::Pixel *pixels = engine.pixels();
+        for (uint16_t i = 0; i < engine.size(); i++)
+        {
+            encode(pixels[i].g, &items[i * 24]);
+            encode(pixels[i].r, &items[i * 24 + 8]);
+            encode(pixels[i].b, &items[i * 24 + 16]);
+        }
+        rmt_write_items(RMT_CHANNEL, items, engine.size() * 24, false);
+        engine.markShown();
+        return true;
+    }
+
 public:
     enum class Status
     {
         IDLE,
         DETECTING,
-        RACER_PULSE, // New: pulse effect for racer
+        RACER_PULSE, // Pulses are layered over the status, see pulseRacer()
         ERROR
     };
 
     LEDRing(uint8_t pin, uint16_t numLeds = 16)
-        : strip(numLeds, pin, NEO_GRB + NEO_KHZ800) {}
+        : pin(pin), engine(numLeds) {}
 
     void begin()
     {
-        strip.begin();
-        strip.show();
-        strip.setBrightness(50);
+        rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, RMT_CHANNEL);
+        config.clk_div = RMT_CLK_DIV;
+        config.mem_block_num = 2; // Fewer refill interrupts per frame
+        if (rmt_config(&config) != ESP_OK || rmt_driver_install(RMT_CHANNEL, 0, 0) != ESP_OK)
+        {
+            Serial.println("LED ring: RMT init failed");
+            return;
+        }
+
+        items = new rmt_item32_t[engine.size() * 24];
+        engine.setBrightness(BRIGHTNESS);
+        pending = true; // Blank the ring
     }
 
     // Non-blocking update - call this in loop()
     void update()
     {
-        unsigned long now = millis();
-
-        // Update pulse effect
-        if (pulsingRacer >= 0)
+        uint32_t now = millis();
+        if (!items || now - lastFrameMs < FRAME_MS)
+            return;
+        lastFrameMs = now;
+
+        if (engine.render(now))
+            pending = true;
+        uint32_t start = micros();
+        if (pending && send())
         {
-            unsigned long elapsed = now - pulseStart;
-
-            if (elapsed < 500)
-            { // 500ms pulse
-                // Breathing effect: fade in/out
-                float phase = (elapsed % 250) / 250.0; // 0-1-0 over 250ms
-                float intensity = phase < 0.5 ? phase * 2.0 : (1.0 - phase) * 2.0;
-
-                Color c = racerColors[pulsingRacer];
-                uint8_t r = c.r * intensity;
-                uint8_t g = c.g * intensity;
-                uint8_t b = c.b * intensity;
-
-                // Spinning effect
-                int offset = (elapsed / 20) % strip.numPixels();
-                for (int i = 0; i < strip.numPixels(); i++)
-                {
-                    int pos = (i + offset) % strip.numPixels();
-                    strip.setPixelColor(pos, strip.Color(r, g, b));
-                }
-                strip.show();
-            }
-            else
-            {
-                // Pulse finished, return to detecting
-                pulsingRacer = -1;
-                setStatus(Status::DETECTING);
-            }
+            sendTime.record(micros() - start);
+            pending = false;
         }
     }
 
     void setStatus(Status status)
     {
-        strip.clear();
-
         switch (status)
         {
         case Status::IDLE:
-            setColor(0, 50, 100); // Dim blue
+            engine.setBase({0, 50, 100}); // Dim blue
             break;
         case Status::DETECTING:
-            setColor(0, 100, 0); // Dim green
+            engine.setBase({0, 100, 0}); // Dim green
             break;
         case Status::ERROR:
+            engine.setBase({100, 0, 0}); // Dim red once the flashes are over
             flash(255, 0, 0, 3);
             break;
         default:
             break;
         }
-
-        strip.show();
     }
 
-    // Trigger racer pulse effect (non-blocking)
+    // Trigger racer pulse effect (non-blocking); pulses of different
+    // racers play together
     void pulseRacer(uint8_t racerId)
     {
         if (racerId < 8)
-        {
-            pulsingRacer = racerId;
-            pulseStart = millis();
-        }
+            engine.pulse(racerId, racerColors[racerId], millis());
+    }
+
+    // Q8, 255 = full
+    void setBrightness(uint8_t brightness)
+    {
+        engine.setBrightness(brightness);
     }
 
     // Get racer color for web display
@@ -124,28 +160,15 @@ public:
     {
         if (racerId >= 8)
             return 0;
-        Color c = racerColors[racerId];
+        LedEngine::Pixel c = racerColors[racerId];
         return (c.r << 16) | (c.g << 8) | c.b;
     }
 
-    void setColor(uint8_t r, uint8_t g, uint8_t b)
-    {
-        for (int i = 0; i < strip.numPixels(); i++)
-        {
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-    }
+    const LatencyHistogram &frameTime() const { return sendTime; }
 
+    // Blink the whole ring count times over whatever it shows (non-blocking)
     void flash(uint8_t r, uint8_t g, uint8_t b, int count = 3)
     {
-        for (int i = 0; i < count; i++)
-        {
-            setColor(r, g, b);
-            strip.show();
-            delay(100); // Only used during startup, OK to block
-            strip.clear();
-            strip.show();
-            delay(100);
-        }
+        engine.flash({r, g, b}, count, millis());
     }
 };
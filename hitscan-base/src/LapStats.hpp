@@ -0,0 +1,228 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// ============================================================================
+// Lap Stats
+// ============================================================================
+// One racer's lap statistics, updated as each lap is recorded and never by
+// looking back over the laps, so a lap costs the same after five hours of
+// practice as on lap one:
+//
+//   - lap count, total time, best and last lap
+//   - best CONSECUTIVE laps in a row (sum over a sliding window)
+//   - mean and variance (Welford's running update)
+//   - median (P-squared estimate: five markers moved towards the 0, 25,
+//     50, 75 and 100% points of the laps seen; exact up to five laps)
+//
+// The session figures restart with each race; the all-time best lap and
+// best run survive it. A lap that does not count (shorter than the
+// minimum lap, so likely a double read) breaks the run of consecutive laps.
+//
+// Times are µs. Hardware independent.
+class LapStats
+{
+public:
+    static constexpr uint8_t CONSECUTIVE = 3;
+    static constexpr uint64_t NO_TIME = UINT64_MAX;
+
+private:
+    static constexpr uint8_t MARKERS = 5;
+
+    uint32_t count;
+    uint64_t totalUs;
+    uint64_t lastUs;
+    uint64_t bestUs;
+
+    // Laps in the current run, oldest first
+    uint64_t run[CONSECUTIVE];
+    uint8_t runLength;
+    uint64_t runSum;
+    uint64_t bestRunUs;
+
+    // Welford: mean and sum of squared deviations. Doubles: this runs once
+    // per lap, and µs squared outgrows a float's mantissa.
+    double meanUs;
+    double m2;
+
+    // P-squared markers: heights and (1-based) positions
+    double height[MARKERS];
+    int32_t position[MARKERS];
+
+    uint64_t allTimeBestUs = NO_TIME;
+    uint64_t allTimeBestRunUs = NO_TIME;
+
+    // Marker i's height moved one position in direction d, on a parabola
+    // through its neighbours
+    double parabolic(uint8_t i, int d) const
+    {
+        double below = position[i] - position[i - 1];
+        double above = position[i + 1] - position[i];
+        return height[i] + d / (double)(position[i + 1] - position[i - 1]) *
+                               ((position[i] - position[i - 1] + d) * (height[i + 1] - height[i]) / above +
+                                (position[i + 1] - position[i] - d) * (height[i] - height[i - 1]) / below);
+    }
+
+    double linear(uint8_t i, int d) const
+    {
+        return height[i] + d * (height[i + d] - height[i]) / (position[i + d] - position[i]);
+    }
+
+    void addMedian(double x)
+    {
+        // Up to five laps: keep them sorted in the markers
+        if (count <= MARKERS)
+        {
+            uint8_t at = count - 1;
+            while (at > 0 && height[at - 1] > x)
+            {
+                height[at] = height[at - 1];
+                at--;
+            }
+            height[at] = x;
+            position[count - 1] = count;
+            return;
+        }
+
+        // Cell the lap falls in; the end markers stretch to take it
+        uint8_t k;
+        if (x < height[0])
+        {
+            height[0] = x;
+            k = 0;
+        }
+        else if (x >= height[MARKERS - 1])
+        {
+            height[MARKERS - 1] = x;
+            k = MARKERS - 2;
+        }
+        else
+        {
+            k = 0;
+            while (x >= height[k + 1])
+                k++;
+        }
+        for (uint8_t i = k + 1; i < MARKERS; i++)
+            position[i]++;
+
+        // Where the inner markers should be after count laps: 1 + (count - 1) * p
+        static const double QUANTILE[MARKERS] = {0, 0.25, 0.5, 0.75, 1};
+        for (uint8_t i = 1; i < MARKERS - 1; i++)
+        {
+            double offset = 1 + (count - 1) * QUANTILE[i] - position[i];
+            if ((offset >= 1 && position[i + 1] - position[i] > 1) ||
+                (offset <= -1 && position[i - 1] - position[i] < -1))
+            {
+                int d = offset > 0 ? 1 : -1;
+                double moved = parabolic(i, d);
+                height[i] = height[i - 1] < moved && moved < height[i + 1] ? moved : linear(i, d);
+                position[i] += d;
+            }
+        }
+    }
+
+public:
+    LapStats() { reset(); }
+
+    // New session: the all-time bests are kept
+    void clear()
+    {
+        count = 0;
+        totalUs = 0;
+        lastUs = NO_TIME;
+        bestUs = NO_TIME;
+        runLength = 0;
+        runSum = 0;
+        bestRunUs = NO_TIME;
+        meanUs = 0;
+        m2 = 0;
+    }
+
+    void reset()
+    {
+        clear();
+        allTimeBestUs = NO_TIME;
+        allTimeBestRunUs = NO_TIME;
+    }
+
+    // A lap that counts
+    void add(uint64_t lapTime)
+    {
+        count++;
+        totalUs += lapTime;
+        lastUs = lapTime;
+        if (lapTime < bestUs)
+            bestUs = lapTime;
+        if (lapTime < allTimeBestUs)
+            allTimeBestUs = lapTime;
+
+        if (runLength == CONSECUTIVE)
+        {
+            runSum -= run[0];
+            for (uint8_t i = 1; i < CONSECUTIVE; i++)
+                run[i - 1] = run[i];
+            runLength--;
+        }
+        run[runLength++] = lapTime;
+        runSum += lapTime;
+        if (runLength == CONSECUTIVE)
+        {
+            if (runSum < bestRunUs)
+                bestRunUs = runSum;
+            if (runSum < allTimeBestRunUs)
+                allTimeBestRunUs = runSum;
+        }
+
+        double x = (double)lapTime;
+        double delta = x - meanUs;
+        meanUs += delta / count;
+        m2 += delta * (x - meanUs);
+
+        addMedian(x);
+    }
+
+    // A lap that does not count: the next run starts after it
+    void interrupt()
+    {
+        runLength = 0;
+        runSum = 0;
+    }
+
+    // Journal replay: all-time bests from before the session
+    void restoreBest(uint64_t lapTime)
+    {
+        if (lapTime < allTimeBestUs)
+            allTimeBestUs = lapTime;
+    }
+
+    void restoreBestRun(uint64_t runTime)
+    {
+        if (runTime < allTimeBestRunUs)
+            allTimeBestRunUs = runTime;
+    }
+
+    uint32_t laps() const { return count; }
+    uint64_t total() const { return totalUs; }
+    uint64_t last() const { return lastUs; }
+    uint64_t best() const { return bestUs; }
+    uint64_t bestRun() const { return bestRunUs; } // Sum of CONSECUTIVE laps
+    uint64_t allTimeBest() const { return allTimeBestUs; }
+    uint64_t allTimeBestRun() const { return allTimeBestRunUs; }
+
+    uint64_t mean() const { return count ? (uint64_t)(meanUs + 0.5) : NO_TIME; }
+
+    // Sample standard deviation: lap-to-lap consistency
+    uint64_t deviation() const { return count > 1 ? (uint64_t)(sqrt(m2 / (count - 1)) + 0.5) : NO_TIME; }
+
+    uint64_t median() const
+    {
+        if (count == 0)
+            return NO_TIME;
+        if (count >= MARKERS)
+            return (uint64_t)(height[MARKERS / 2] + 0.5);
+        // Fewer laps than markers: they are the sorted laps
+        return count % 2 ? (uint64_t)height[count / 2]
+                         : (uint64_t)((height[count / 2 - 1] + height[count / 2]) / 2 + 0.5);
+    }
+};
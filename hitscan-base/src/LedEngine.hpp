@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// LED Engine
+// ============================================================================
+// Renders the ring into a framebuffer, one frame per call, from layers
+// composited bottom to top:
+//
+//   base   - the status colour
+//   pulses - one per racer, 500 ms of breathing in the racer's colour.
+//            Concurrent pulses share the ring, each on its own arc, and the
+//            arcs spin; a single pulse fills it.
+//   flash  - count on/off blinks over everything
+//
+// All intensity math is Q8 (0-255 = 0.0-1.0) integer. render() reports
+// whether the frame differs from the one last shown, so the output only
+// has to send changed frames. Hardware independent: LEDRing sends the
+// frames, tools/led_bench renders them on the host.
+class LedEngine
+{
+public:
+    static constexpr uint16_t MAX_LEDS = 64;
+    static constexpr uint8_t MAX_PULSES = 8;
+    static constexpr uint32_t PULSE_MS = 500;
+    static constexpr uint32_t BREATH_MS = 250; // One fade in and out
+    static constexpr uint32_t SPIN_MS = 20;    // Per pixel of rotation
+    static constexpr uint32_t FLASH_MS = 100;  // On, then off, per blink
+
+    struct Pixel
+    {
+        uint8_t r, g, b;
+    };
+
+private:
+    struct Pulse
+    {
+        Pixel color;
+        uint32_t startMs;
+        bool active;
+    };
+
+    uint16_t count;
+    uint8_t brightness = 255; // Q8 scale applied last
+    Pixel frame[MAX_LEDS] = {};
+    Pixel shown[MAX_LEDS] = {};
+    bool shownValid = false;
+
+    Pixel base = {};
+    Pulse pulses[MAX_PULSES] = {};
+    Pixel flashColor = {};
+    uint32_t flashStartMs = 0;
+    uint8_t flashCount = 0;
+
+    // a + (b - a) * t, t in Q8: exactly a at 0 and b at 255
+    static uint8_t lerp(uint8_t a, uint8_t b, uint8_t t)
+    {
+        uint16_t w = t + (t >> 7);
+        return (a * (256 - w) + b * w) >> 8;
+    }
+
+    static Pixel lerp(Pixel a, Pixel b, uint8_t t) { return {lerp(a.r, b.r, t), lerp(a.g, b.g, t), lerp(a.b, b.b, t)}; }
+
+    static uint8_t scale(uint8_t value, uint8_t q8) { return (value * (q8 + 1)) >> 8; }
+
+    // 0 -> 255 -> 0 over BREATH_MS
+    static uint8_t breath(uint32_t elapsedMs)
+    {
+        uint32_t phase = elapsedMs % BREATH_MS;
+        uint32_t half = BREATH_MS / 2;
+        uint32_t rise = phase < half ? phase : BREATH_MS - phase;
+        return rise * 255 / half;
+    }
+
+public:
+    explicit LedEngine(uint16_t numLeds) : count(numLeds < MAX_LEDS ? numLeds : MAX_LEDS) {}
+
+    void setBrightness(uint8_t q8) { brightness = q8; }
+    void setBase(Pixel color) { base = color; }
+
+    void pulse(uint8_t slot, Pixel color, uint32_t nowMs)
+    {
+        if (slot < MAX_PULSES)
+            pulses[slot] = {color, nowMs, true};
+    }
+
+    void flash(Pixel color, uint8_t blinks, uint32_t nowMs)
+    {
+        flashColor = color;
+        flashCount = blinks;
+        flashStartMs = nowMs;
+    }
+
+    // Render the frame for nowMs. True if it differs from the last frame
+    // marked shown.
+    bool render(uint32_t nowMs)
+    {
+        for (uint16_t i = 0; i < count; i++)
+            frame[i] = base;
+
+        // Pulses: expire, then share the ring between the active ones
+        uint8_t active = 0;
+        for (Pulse &p : pulses)
+        {
+            if (p.active && nowMs - p.startMs >= PULSE_MS)
+                p.active = false;
+            active += p.active;
+        }
+        if (active && count)
+        {
+            uint16_t offset = (nowMs / SPIN_MS) % count;
+            uint8_t arc = 0;
+            for (const Pulse &p : pulses)
+            {
+                if (!p.active)
+                    continue;
+                uint8_t t = breath(nowMs - p.startMs);
+                uint16_t from = arc * count / active;
+                uint16_t to = (arc + 1) * count / active;
+                for (uint16_t i = from; i < to; i++)
+                {
+                    Pixel &px = frame[(i + offset) % count];
+                    px = lerp(px, p.color, t);
+                }
+                arc++;
+            }
+        }
+
+        // Flash: on for the first half of each period, off for the second
+        if (flashCount)
+        {
+            uint32_t elapsed = nowMs - flashStartMs;
+            if (elapsed >= flashCount * FLASH_MS * 2)
+            {
+                flashCount = 0;
+            }
+            else
+            {
+                Pixel px = (elapsed / FLASH_MS) % 2 ? Pixel{0, 0, 0} : flashColor;
+                for (uint16_t i = 0; i < count; i++)
+                    frame[i] = px;
+            }
+        }
+
+        for (uint16_t i = 0; i < count; i++)
+            frame[i] = {scale(frame[i].r, brightness), scale(frame[i].g, brightness), scale(frame[i].b, brightness)};
+
+        return !shownValid || memcmp(frame, shown, count * sizeof(Pixel)) != 0;
+    }
+
+    // The output took the current frame
+    void markShown()
+    {
+        memcpy(shown, frame, count * sizeof(Pixel));
+        shownValid = true;
+    }
+
+    const Pixel *pixels() const { return frame; }
+    uint16_t size() const { return count; }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// Log Levels
+// ============================================================================
+// Compile-time levels for Serial logging. A message above the level is
+// dead code the compiler drops, format arguments and all.
+//
+// Serial.printf blocks once the UART FIFO is full, for about 87 µs per
+// byte at 115200 baud, so a print in the detection task stalls decoding
+// for as long as the line takes to go out. That task logs errors only
+// unless built with e.g. -DDETECTION_LOG_LEVEL=LOG_LEVEL_DEBUG; what it
+// used to print is counted on /metrics instead.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef DETECTION_LOG_LEVEL
+#define DETECTION_LOG_LEVEL LOG_LEVEL_ERROR
+#endif
+
+#define LOG_AT(limit, level, ...)          \
+    do                                     \
+    {                                      \
+        if ((level) <= (limit))            \
+            Serial.printf(__VA_ARGS__);    \
+    } while (0)
+
+// DETECTION_LOG(WARN, "format", ...) from the detection task
+#define DETECTION_LOG(level, ...) LOG_AT(DETECTION_LOG_LEVEL, LOG_LEVEL_##level, __VA_ARGS__)
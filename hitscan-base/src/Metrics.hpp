@@ -0,0 +1,261 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "JsonStream.hpp"
+
+// ============================================================================
+// Latency Histogram
+// ============================================================================
+// Durations in µs counted into fixed 1-2-5 buckets from 5 µs to 100 ms, plus
+// an overflow bucket, with the running sum and the longest seen. Cheap
+// enough for the hot paths: a short scan and a few relaxed stores, no locks.
+//
+// One task records (the one running the code being timed); any task may
+// read. A reader can catch a sample counted in its bucket but not yet in the
+// sum, which doesn't matter for monitoring. The counts are 32-bit and wrap
+// like any counter (Prometheus takes that for a reset); the sum is kept in
+// ms so it lasts as long as the uptime.
+class LatencyHistogram
+{
+public:
+    static constexpr size_t BOUNDS = 14;
+    static constexpr size_t BUCKETS = BOUNDS + 1; // Last one: above every bound
+
+    // Upper bound of bucket i (µs, inclusive)
+    static uint32_t bound(size_t i)
+    {
+        static const uint32_t BOUNDS_US[BOUNDS] = {5, 10, 20, 50, 100, 200, 500,
+                                                   1000, 2000, 5000, 10000, 20000, 50000, 100000};
+        return BOUNDS_US[i];
+    }
+
+private:
+    std::atomic<uint32_t> counts[BUCKETS];
+    std::atomic<uint32_t> sumMs{0};
+    std::atomic<uint32_t> peakUs{0};
+    uint32_t remainderUs = 0; // Sum below 1 ms not yet in sumMs (writer only)
+
+    // Single writer, so load + store is enough
+    static void add(std::atomic<uint32_t> &value, uint32_t n)
+    {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram()
+    {
+        for (std::atomic<uint32_t> &count : counts)
+            count.store(0, std::memory_order_relaxed);
+    }
+
+    void record(uint32_t us)
+    {
+        size_t i = 0;
+        while (i < BOUNDS && us > bound(i))
+            i++;
+        add(counts[i], 1);
+
+        remainderUs += us;
+        if (remainderUs >= 1000)
+        {
+            add(sumMs, remainderUs / 1000);
+            remainderUs %= 1000;
+        }
+        if (us > peakUs.load(std::memory_order_relaxed))
+            peakUs.store(us, std::memory_order_relaxed);
+    }
+
+    uint32_t bucket(size_t i) const { return counts[i].load(std::memory_order_relaxed); }
+    uint32_t sum() const { return sumMs.load(std::memory_order_relaxed); } // ms
+    uint32_t peak() const { return peakUs.load(std::memory_order_relaxed); }
+};
+
+// ============================================================================
+// Metrics Writers
+// ============================================================================
+// Both take the same calls, so one function lists the metrics and either
+// writer formats them:
+//
+//   counter(name, help, value [, labelKey, labelValue])
+//   gauge(name, help, value [, labelKey, labelValue])
+//   histogram(name, help, latencyHistogram)
+//
+// Names are bare ("decode_attempts"); the writer adds the prefix and unit
+// suffixes of its format. Samples of one labelled family are written one
+// after another.
+
+// Prometheus text exposition format (0.0.4), streamed through a buffer and
+// sink like JsonStream
+class PrometheusWriter
+{
+public:
+    using Sink = JsonStream::Sink;
+
+private:
+    static constexpr const char *PREFIX = "hitscan_";
+
+    char *buffer;
+    size_t capacity;
+    size_t used = 0;
+    Sink sink;
+    void *context;
+    const char *family = nullptr; // Name of the last # TYPE written
+
+    void put(const char *text, size_t length)
+    {
+        while (length)
+        {
+            if (used == capacity)
+                flush();
+            size_t n = capacity - used < length ? capacity - used : length;
+            memcpy(buffer + used, text, n);
+            used += n;
+            text += n;
+            length -= n;
+        }
+    }
+
+    __attribute__((format(printf, 2, 3))) void line(const char *format, ...)
+    {
+        char text[192];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (length > 0)
+            put(text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1);
+    }
+
+    void header(const char *name, const char *suffix, const char *help, const char *type)
+    {
+        if (family && !strcmp(family, name))
+            return;
+        family = name;
+        line("# HELP %s%s%s %s\n", PREFIX, name, suffix, help);
+        line("# TYPE %s%s%s %s\n", PREFIX, name, suffix, type);
+    }
+
+    void sample(const char *name, const char *suffix, uint32_t value, const char *labelKey,
+                const char *labelValue)
+    {
+        if (labelKey)
+            line("%s%s%s{%s=\"%s\"} %u\n", PREFIX, name, suffix, labelKey, labelValue, value);
+        else
+            line("%s%s%s %u\n", PREFIX, name, suffix, value);
+    }
+
+public:
+    PrometheusWriter(char *buffer, size_t capacity, Sink sink, void *context)
+        : buffer(buffer), capacity(capacity), sink(sink), context(context) {}
+
+    PrometheusWriter(const PrometheusWriter &) = delete;
+    PrometheusWriter &operator=(const PrometheusWriter &) = delete;
+
+    void counter(const char *name, const char *help, uint32_t value, const char *labelKey = nullptr,
+                 const char *labelValue = nullptr)
+    {
+        header(name, "_total", help, "counter");
+        sample(name, "_total", value, labelKey, labelValue);
+    }
+
+    void gauge(const char *name, const char *help, uint32_t value, const char *labelKey = nullptr,
+               const char *labelValue = nullptr)
+    {
+        header(name, "", help, "gauge");
+        sample(name, "", value, labelKey, labelValue);
+    }
+
+    // Buckets in seconds, plus <name>_seconds_max as a gauge
+    void histogram(const char *name, const char *help, const LatencyHistogram &histogram)
+    {
+        header(name, "_seconds", help, "histogram");
+        uint32_t count = 0;
+        for (size_t i = 0; i < LatencyHistogram::BOUNDS; i++)
+        {
+            uint32_t us = LatencyHistogram::bound(i);
+            count += histogram.bucket(i);
+            line("%s%s_seconds_bucket{le=\"%u.%06u\"} %u\n", PREFIX, name, us / 1000000, us % 1000000, count);
+        }
+        count += histogram.bucket(LatencyHistogram::BOUNDS);
+        line("%s%s_seconds_bucket{le=\"+Inf\"} %u\n", PREFIX, name, count);
+        line("%s%s_seconds_sum %u.%03u\n", PREFIX, name, histogram.sum() / 1000, histogram.sum() % 1000);
+        line("%s%s_seconds_count %u\n", PREFIX, name, count);
+
+        uint32_t peak = histogram.peak();
+        line("# TYPE %s%s_seconds_max gauge\n", PREFIX, name);
+        line("%s%s_seconds_max %u.%06u\n", PREFIX, name, peak / 1000000, peak % 1000000);
+        family = nullptr;
+    }
+
+    void flush()
+    {
+        if (used)
+            sink(context, buffer, used);
+        used = 0;
+    }
+};
+
+// Compact JSON into a JsonStream: one object, labelled samples keyed
+// <name>_<labelValue>, histograms as {count, sumMs, maxUs, buckets} with the
+// bucket bounds listed once under boundsUs
+class JsonMetricsWriter
+{
+private:
+    JsonStream &json;
+
+    void key(const char *name, const char *labelValue)
+    {
+        if (!labelValue)
+        {
+            json.key(name);
+            return;
+        }
+        char text[48];
+        snprintf(text, sizeof(text), "%s_%s", name, labelValue);
+        json.key(text);
+    }
+
+public:
+    explicit JsonMetricsWriter(JsonStream &json) : json(json) {}
+
+    void begin()
+    {
+        json.beginObject().key("boundsUs").beginArray();
+        for (size_t i = 0; i < LatencyHistogram::BOUNDS; i++)
+            json.number(LatencyHistogram::bound(i));
+        json.endArray();
+    }
+
+    void end() { json.endObject(); }
+
+    void counter(const char *name, const char *, uint32_t value, const char * = nullptr,
+                 const char *labelValue = nullptr)
+    {
+        key(name, labelValue);
+        json.number(value);
+    }
+
+    void gauge(const char *name, const char *help, uint32_t value, const char *labelKey = nullptr,
+               const char *labelValue = nullptr)
+    {
+        counter(name, help, value, labelKey, labelValue);
+    }
+
+    void histogram(const char *name, const char *, const LatencyHistogram &histogram)
+    {
+        uint32_t count = 0;
+        for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++)
+            count += histogram.bucket(i);
+
+        json.key(name).beginObject().field("count", count).field("sumMs", histogram.sum()).field("maxUs", histogram.peak());
+        json.key("buckets").beginArray();
+        for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++)
+            json.number(histogram.bucket(i));
+        json.endArray().endObject();
+    }
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// Pass Aggregator
+// ============================================================================
+// Fuses every packet decoded for a racer during one pass through the gate
+// into a single crossing. The crossing time is the median of the packet
+// times, so it no longer depends on which side of the cone the first packet
+// happened to land, and the number of packets is kept as a confidence value.
+//
+// A pass ends once no packet for that racer has been seen for gapUs (or it
+// has lasted maxPassUs). Passes with fewer than minReads packets are dropped
+// as noise. Hardware independent; the caller supplies the current time.
+class PassAggregator
+{
+public:
+    static constexpr uint8_t MAX_RACERS = 8;
+    static constexpr uint8_t MAX_READS = 16; // Packet times kept per pass for the median
+
+    struct Config
+    {
+        uint32_t gapUs = 100000;     // Silence that ends a pass
+        uint32_t maxPassUs = 500000; // Hard cap so a parked quad still reports
+        uint8_t minReads = 1;        // 2+ rejects lone decodes (costs passes at 200km/h)
+    };
+
+    struct Crossing
+    {
+        uint8_t racerId;
+        uint64_t timestamp; // Estimated centre of the pass (µs)
+        uint8_t reads;      // Packets fused into this crossing
+    };
+
+private:
+    struct Pass
+    {
+        uint64_t first;
+        uint64_t last;
+        uint16_t count; // May exceed MAX_READS; extra reads only extend first/last
+        uint64_t reads[MAX_READS];
+    };
+
+    Config config;
+    Pass passes[MAX_RACERS] = {};
+    uint32_t rejectedPasses = 0;
+
+    // Median of the stored reads (they arrive in time order). Falls back to
+    // the midpoint when the pass was too long to keep every read.
+    static uint64_t estimate(const Pass &pass)
+    {
+        if (pass.count > MAX_READS)
+            return pass.first + (pass.last - pass.first) / 2;
+
+        uint16_t mid = pass.count / 2;
+        if (pass.count & 1)
+            return pass.reads[mid];
+        return pass.reads[mid - 1] + (pass.reads[mid] - pass.reads[mid - 1]) / 2;
+    }
+
+    bool close(uint8_t racerId, Crossing &crossing)
+    {
+        Pass &pass = passes[racerId];
+        uint16_t count = pass.count;
+        if (count < config.minReads)
+        {
+            pass.count = 0;
+            rejectedPasses++;
+            return false;
+        }
+
+        crossing.racerId = racerId;
+        crossing.timestamp = estimate(pass);
+        crossing.reads = count > 255 ? 255 : count;
+        pass.count = 0;
+        return true;
+    }
+
+    bool expired(const Pass &pass, uint64_t now) const
+    {
+        return pass.count > 0 &&
+               (now - pass.last >= config.gapUs || pass.last - pass.first >= config.maxPassUs);
+    }
+
+public:
+    void configure(const Config &newConfig)
+    {
+        config = newConfig;
+        if (config.minReads == 0)
+            config.minReads = 1;
+    }
+
+    const Config &getConfig() const { return config; }
+
+    // Record a decoded packet. Returns true and fills crossing if it closes
+    // the racer's previous pass.
+    bool add(uint8_t racerId, uint64_t timestamp, Crossing &crossing)
+    {
+        if (racerId >= MAX_RACERS)
+            return false;
+
+        Pass &pass = passes[racerId];
+        bool closed = false;
+        if (expired(pass, timestamp))
+            closed = close(racerId, crossing);
+
+        if (pass.count == 0)
+            pass.first = timestamp;
+        if (pass.count < MAX_READS)
+            pass.reads[pass.count] = timestamp;
+        if (pass.count < UINT16_MAX)
+            pass.count++;
+        pass.last = timestamp;
+
+        return closed;
+    }
+
+    // Emit the earliest finished pass, if any. Call regularly with the
+    // current time; returns false when nothing is ready.
+    bool poll(uint64_t now, Crossing &crossing)
+    {
+        while (true)
+        {
+            int earliest = -1;
+            for (uint8_t i = 0; i < MAX_RACERS; i++)
+            {
+                if (expired(passes[i], now) &&
+                    (earliest < 0 || passes[i].first < passes[earliest].first))
+                    earliest = i;
+            }
+
+            if (earliest < 0)
+                return false;
+            if (close(earliest, crossing))
+                return true;
+        }
+    }
+
+    void reset()
+    {
+        for (Pass &pass : passes)
+            pass.count = 0;
+        rejectedPasses = 0;
+    }
+
+    uint32_t rejected() const { return rejectedPasses; }
+};
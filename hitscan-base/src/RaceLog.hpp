@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "SpscRing.hpp"
+
+// ============================================================================
+// Race Log
+// ============================================================================
+// Compact binary race log, batched into whole 512-byte blocks (one SD
+// sector) so the card only ever sees full-sector writes.
+//
+// Two blocks alternate. The loop appends 16-byte records to the one it
+// owns; when it is full (or the flush interval has passed since its first
+// record) the block is padded, handed to the writer through a lock-free
+// ring, and the loop carries on in the other block. The writer drains the
+// ring and gives each block back once it is on the card. Appending is a
+// copy into RAM: it never waits for the card. If the writer still holds
+// both blocks the record is dropped and counted instead.
+//
+// On-card format: a sequence of Records, little-endian, the first one a
+// HEADER. PAD records fill the tail of blocks flushed early.
+// Hardware independent; tools/racelog2csv converts a log to CSV.
+class RaceLog
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 512;
+    static constexpr uint32_t MAGIC = 0x474C5348; // "HSLG"
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint32_t FLUSH_INTERVAL_MS = 2000;
+
+    enum class Type : uint8_t
+    {
+        PAD,    // Unused tail of a block
+        HEADER, // First record of a file: racerId = VERSION, raceNumber = MAGIC
+        START,  // position = mode (0 race, 1 lap timer)
+        STOP,   // timestamp = race duration
+        RESULT, // Race mode finish
+        LAP     // Lap mode crossing; lap time is the gap to the racer's previous one
+    };
+
+    struct Record
+    {
+        Type type;
+        uint8_t racerId;
+        uint8_t reads;
+        uint8_t position; // RESULT: finishing position, START: mode
+        uint32_t raceNumber;
+        uint64_t timestamp; // µs since race start
+    };
+
+    static_assert(sizeof(Record) == 16, "Record layout is the on-card format");
+    static constexpr size_t RECORDS_PER_BLOCK = BLOCK_SIZE / sizeof(Record);
+
+private:
+    struct Block
+    {
+        Record records[RECORDS_PER_BLOCK];
+    };
+
+    Block blocks[2];
+    std::atomic<bool> owned[2] = {{true}, {true}}; // Loop may fill it
+    SpscRing<uint8_t, 2> ready;                     // Blocks waiting for the writer
+
+    uint8_t filling = 0;
+    uint8_t used = 0; // Records in the block being filled
+    uint32_t firstRecordMs = 0;
+    uint32_t flushIntervalMs = FLUSH_INTERVAL_MS;
+
+    uint32_t dropped = 0;
+    std::atomic<uint32_t> written{0};
+
+    void submit()
+    {
+        Block &block = blocks[filling];
+        for (uint8_t i = used; i < RECORDS_PER_BLOCK; i++)
+            block.records[i] = {Type::PAD, 0, 0, 0, 0, 0};
+
+        owned[filling].store(false, std::memory_order_release);
+        ready.push(filling); // Cannot fail: at most two blocks in flight
+        filling ^= 1;
+        used = 0;
+    }
+
+public:
+    void setFlushInterval(uint32_t ms) { flushIntervalMs = ms; }
+
+    // ------------------------------------------------------------------
+    // Loop side
+    // ------------------------------------------------------------------
+
+    // Returns true when a block was handed over (wake the writer)
+    bool append(const Record &record, uint32_t nowMs)
+    {
+        if (!owned[filling].load(std::memory_order_acquire))
+        {
+            dropped++;
+            return false;
+        }
+        if (used == 0)
+            firstRecordMs = nowMs;
+
+        blocks[filling].records[used++] = record;
+        if (used < RECORDS_PER_BLOCK)
+            return false;
+        submit();
+        return true;
+    }
+
+    // Hand over a partial block once it has waited flushIntervalMs
+    bool update(uint32_t nowMs)
+    {
+        if (used == 0 || nowMs - firstRecordMs < flushIntervalMs)
+            return false;
+        submit();
+        return true;
+    }
+
+    // Hand over whatever is buffered now (e.g. end of race)
+    bool flush()
+    {
+        if (used == 0)
+            return false;
+        submit();
+        return true;
+    }
+
+    // ------------------------------------------------------------------
+    // Writer side
+    // ------------------------------------------------------------------
+
+    // Pass every handed-over block to write(data, BLOCK_SIZE), oldest
+    // first, and give it back to the loop. Returns blocks written.
+    template <typename Fn>
+    size_t drain(Fn write)
+    {
+        size_t count = 0;
+        uint8_t index;
+        while (ready.pop(index))
+        {
+            write(reinterpret_cast<const uint8_t *>(&blocks[index]), BLOCK_SIZE);
+            owned[index].store(true, std::memory_order_release);
+            count++;
+        }
+        written.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    uint32_t recordsDropped() const { return dropped; }
+    uint32_t blocksWritten() const { return written.load(std::memory_order_relaxed); }
+    uint8_t pending() const { return used; }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_timer.h>
+#include "RaceLog.hpp"
+#include "RaceState.hpp"
+
+// ============================================================================
+// Race Logger (SD card)
+// ============================================================================
+// Writes the RaceLog to a file from its own low-priority task, so the loop
+// only ever copies 16 bytes into RAM per event. The task sleeps until the
+// loop hands it a block, writes the 512 bytes in one call and flushes, so
+// a power cut loses at most the block being filled (FLUSH_INTERVAL_MS).
+class RaceLogger
+{
+private:
+    RaceLog log;
+    File file;
+    TaskHandle_t writerTaskHandle = NULL;
+    bool ready = false;
+
+    uint32_t writeErrors = 0;
+    uint32_t slowestWriteUs = 0;
+
+    static void writerTask(void *parameter)
+    {
+        RaceLogger *logger = (RaceLogger *)parameter;
+
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            logger->log.drain([logger](const uint8_t *data, size_t length)
+                              {
+                uint64_t start = esp_timer_get_time();
+                if (logger->file.write(data, length) != length)
+                    logger->writeErrors++;
+                logger->file.flush();
+                uint32_t took = esp_timer_get_time() - start;
+                if (took > logger->slowestWriteUs)
+                    logger->slowestWriteUs = took; });
+        }
+    }
+
+    void append(const RaceLog::Record &record)
+    {
+        if (ready && log.append(record, millis()))
+            xTaskNotifyGive(writerTaskHandle);
+    }
+
+public:
+    // Open (or continue) the log file and start the writer task
+    bool begin(fs::FS &fs, const char *path, uint32_t flushIntervalMs = RaceLog::FLUSH_INTERVAL_MS)
+    {
+        file = fs.open(path, FILE_APPEND);
+        if (!file)
+        {
+            Serial.printf("Race log: cannot open %s\n", path);
+            return false;
+        }
+
+        // Re-align after a torn tail so every block stays one sector
+        size_t size = file.size();
+        if (size % RaceLog::BLOCK_SIZE)
+        {
+            static const uint8_t padding[RaceLog::BLOCK_SIZE] = {};
+            file.write(padding, RaceLog::BLOCK_SIZE - size % RaceLog::BLOCK_SIZE);
+        }
+
+        log.setFlushInterval(flushIntervalMs);
+        ready = true;
+        if (size == 0)
+            append({RaceLog::Type::HEADER, RaceLog::VERSION, 0, 0, RaceLog::MAGIC, 0});
+
+        xTaskCreatePinnedToCore(
+            writerTask,        // Task function
+            "SD_Logger",       // Name
+            4096,              // Stack size (bytes)
+            this,              // Parameters
+            1,                 // Priority (low)
+            &writerTaskHandle, // Task handle
+            0                  // Core 0, away from detection
+        );
+
+        Serial.printf("Race log: %s (%u bytes)\n", path, (unsigned)size);
+        return true;
+    }
+
+    void logStart(uint32_t raceNumber, RaceState::Mode mode)
+    {
+        append({RaceLog::Type::START, 0, 0, (uint8_t)mode, raceNumber, 0});
+    }
+
+    void logStop(uint32_t raceNumber, uint64_t duration)
+    {
+        append({RaceLog::Type::STOP, 0, 0, 0, raceNumber, duration});
+        flush();
+    }
+
+    void logResult(uint32_t raceNumber, const RaceState::Result &result)
+    {
+        append({RaceLog::Type::RESULT, result.racerId, result.reads, result.position,
+                raceNumber, result.timestamp});
+    }
+
+    // Every lap crossing, including ones the lap store had no room for
+    void logLap(uint32_t raceNumber, uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        append({RaceLog::Type::LAP, racerId, reads, 0, raceNumber, timestamp});
+    }
+
+    // Call regularly from the loop: hands over a block past its flush interval
+    void update()
+    {
+        if (ready && log.update(millis()))
+            xTaskNotifyGive(writerTaskHandle);
+    }
+
+    void flush()
+    {
+        if (ready && log.flush())
+            xTaskNotifyGive(writerTaskHandle);
+    }
+
+    bool enabled() const { return ready; }
+    uint32_t recordsDropped() const { return log.recordsDropped(); }
+    uint32_t blocksWritten() const { return log.blocksWritten(); }
+    uint32_t errors() const { return writeErrors; }
+    uint32_t slowestWrite() const { return slowestWriteUs; }
+};
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include "LapStats.hpp"
+
+// ============================================================================
+// Race State
+// ============================================================================
+// Results, laps and best times for the current race. All storage is
+// allocated once in begin(); recording a crossing never touches the heap and
+// costs the same on lap 5 as on lap 500:
+//
+//   - race mode keeps at most one result per racer, with a finished bitset
+//   - lap mode keeps a ring of the most recent laps per racer, plus each
+//     racer's last crossing time, so the lap time needs no search
+//
+// When a racer's ring is full the configured policy either overwrites the
+// oldest lap or rejects the new one; both are counted and reported in the
+// returned Update. Hardware independent (times are µs since race start).
+//
+// Each racer's LapStats (averages, median, best run of laps, all-time
+// bests) are updated with the lap, so they cover every lap of the session
+// even after the ring has dropped the oldest ones.
+//
+// Every stored result and lap gets a sequence number that keeps increasing
+// across races, so a client that has seen up to seq N can ask for just the
+// newer entries. raceNumber() changes on every reset() to tell clients their
+// copy is stale.
+class RaceState
+{
+public:
+    static constexpr uint8_t MAX_RACERS = 8;
+    static constexpr uint64_t NO_TIME = UINT64_MAX;
+
+    enum class Mode : uint8_t
+    {
+        RACE,     // Race mode - track positions
+        LAP_TIMER // Lap timer - just record all crossings
+    };
+
+    enum class FullPolicy : uint8_t
+    {
+        OVERWRITE_OLDEST, // Keep the most recent laps (practice sessions)
+        REJECT            // Keep the first laps, count the rest as dropped
+    };
+
+    struct Config
+    {
+        uint16_t lapsPerRacer = 128;
+        FullPolicy whenFull = FullPolicy::OVERWRITE_OLDEST;
+        uint64_t minLapUs = 1000000; // Shorter laps don't count for bests (likely errors)
+    };
+
+    struct Result
+    {
+        uint8_t racerId;
+        uint64_t timestamp;
+        uint8_t position;
+        uint8_t reads;
+        uint32_t seq;
+    };
+
+    // Widest fields first: 24 bytes instead of 32 per stored lap
+    struct Lap
+    {
+        uint64_t lapTime;
+        uint64_t timestamp;
+        uint32_t seq;    // Order across all racers
+        uint16_t number; // 1-based, per racer
+        uint8_t racerId;
+        uint8_t reads;
+    };
+
+    enum class Outcome : uint8_t
+    {
+        FINISHED,         // Race mode: result recorded
+        LAP,              // Lap mode: lap recorded
+        LAP_OVERWROTE,    // Lap recorded, the racer's oldest lap was dropped
+        LAP_REJECTED,     // Ring full under REJECT: lap not stored
+        ALREADY_FINISHED, // Race mode: racer already has a result
+        INVALID_RACER,
+        NOT_READY // begin() failed or was not called
+    };
+
+    struct Update
+    {
+        Outcome outcome;
+        uint8_t position; // Race mode
+        uint64_t lapTime; // Lap mode
+        bool fastestLap;  // New overall fastest lap this race
+        bool personalBest;
+    };
+
+private:
+    struct LapRing
+    {
+        Lap *laps;
+        uint16_t head;  // Next slot to write
+        uint16_t count; // Laps held
+        uint16_t total; // Laps recorded this race, including dropped ones
+        uint64_t lastCrossing;
+    };
+
+    Config config;
+    Mode mode = Mode::RACE;
+
+    Lap *lapStorage = nullptr;
+    LapRing rings[MAX_RACERS] = {};
+    uint32_t nextSeq = 1; // 0 = "nothing seen yet" for clients
+    uint32_t raceCount = 0;
+
+    Result results[MAX_RACERS];
+    uint8_t resultCount = 0;
+    uint8_t finishedMask = 0;
+
+    uint64_t fastest = NO_TIME;
+    uint8_t fastestRacer = 0;
+    LapStats stats[MAX_RACERS]; // Personal bests are the all-time best laps
+
+    uint32_t overwritten = 0;
+    uint32_t rejected = 0;
+
+    Update recordFinish(uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        Update update = {Outcome::ALREADY_FINISHED, 0, 0, false, false};
+        if (finishedMask & (1 << racerId))
+            return update;
+
+        finishedMask |= 1 << racerId;
+        Result &result = results[resultCount++];
+        result = {racerId, timestamp, resultCount, reads, nextSeq++};
+
+        update.outcome = Outcome::FINISHED;
+        update.position = result.position;
+        return update;
+    }
+
+    Update recordLap(uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        LapRing &ring = rings[racerId];
+        uint64_t lapTime = ring.lastCrossing == NO_TIME ? timestamp : timestamp - ring.lastCrossing;
+        ring.lastCrossing = timestamp;
+        if (ring.total < UINT16_MAX)
+            ring.total++;
+
+        Update update = {Outcome::LAP, 0, lapTime, false, false};
+
+        if (lapTime > config.minLapUs)
+        {
+            if (lapTime < fastest)
+            {
+                fastest = lapTime;
+                fastestRacer = racerId;
+                update.fastestLap = true;
+            }
+            update.personalBest = lapTime < stats[racerId].allTimeBest();
+            stats[racerId].add(lapTime);
+        }
+        else
+        {
+            stats[racerId].interrupt();
+        }
+
+        if (ring.count == config.lapsPerRacer)
+        {
+            if (config.whenFull == FullPolicy::REJECT)
+            {
+                rejected++;
+                update.outcome = Outcome::LAP_REJECTED;
+                return update;
+            }
+            overwritten++;
+            update.outcome = Outcome::LAP_OVERWROTE;
+        }
+        else
+        {
+            ring.count++;
+        }
+
+        ring.laps[ring.head] = {lapTime, timestamp, nextSeq++, ring.total, racerId, reads};
+        if (++ring.head == config.lapsPerRacer)
+            ring.head = 0;
+        return update;
+    }
+
+public:
+    RaceState() = default;
+
+    ~RaceState() { delete[] lapStorage; }
+
+    RaceState(const RaceState &) = delete;
+    RaceState &operator=(const RaceState &) = delete;
+
+    // Allocates lap storage (lapsPerRacer * MAX_RACERS laps). Returns false
+    // if it does not fit; record() then reports NOT_READY.
+    bool begin(const Config &newConfig)
+    {
+        delete[] lapStorage;
+        config = newConfig;
+        if (config.lapsPerRacer == 0)
+            config.lapsPerRacer = 1;
+
+        lapStorage = new (std::nothrow) Lap[(size_t)config.lapsPerRacer * MAX_RACERS];
+        for (uint8_t i = 0; i < MAX_RACERS; i++)
+            rings[i].laps = lapStorage ? lapStorage + (size_t)i * config.lapsPerRacer : nullptr;
+
+        reset();
+        return lapStorage != nullptr;
+    }
+
+    bool begin() { return begin(Config()); }
+
+    // New race: clears results, laps, the fastest lap and the session
+    // stats. Personal (all-time) bests are kept across races.
+    void reset()
+    {
+        for (LapRing &ring : rings)
+        {
+            ring.head = 0;
+            ring.count = 0;
+            ring.total = 0;
+            ring.lastCrossing = NO_TIME;
+        }
+        for (LapStats &racer : stats)
+            racer.clear();
+        raceCount++;
+        resultCount = 0;
+        finishedMask = 0;
+        fastest = NO_TIME;
+        fastestRacer = 0;
+        overwritten = 0;
+        rejected = 0;
+    }
+
+    // Journal replay: continue the race and seq numbering of the session
+    // being restored, and carry its personal bests
+    void restoreCounters(uint32_t raceNumber, uint32_t lastSeq)
+    {
+        raceCount = raceNumber;
+        nextSeq = lastSeq + 1;
+    }
+
+    void restorePersonalBest(uint8_t racerId, uint64_t lapTime)
+    {
+        if (racerId < MAX_RACERS)
+            stats[racerId].restoreBest(lapTime);
+    }
+
+    void restorePersonalBestRun(uint8_t racerId, uint64_t runTime)
+    {
+        if (racerId < MAX_RACERS)
+            stats[racerId].restoreBestRun(runTime);
+    }
+
+    void setMode(Mode newMode) { mode = newMode; }
+    void setMinLap(uint64_t minLapUs) { config.minLapUs = minLapUs; }
+    Mode getMode() const { return mode; }
+
+    // Apply one crossing, timestamp in µs since race start
+    Update record(uint8_t racerId, uint64_t timestamp, uint8_t reads)
+    {
+        if (!lapStorage)
+            return {Outcome::NOT_READY, 0, 0, false, false};
+        if (racerId >= MAX_RACERS)
+            return {Outcome::INVALID_RACER, 0, 0, false, false};
+
+        if (mode == Mode::RACE)
+            return recordFinish(racerId, timestamp, reads);
+        return recordLap(racerId, timestamp, reads);
+    }
+
+    // Race mode results, in finishing order
+    uint8_t finishers() const { return resultCount; }
+    const Result &result(uint8_t index) const { return results[index]; }
+    bool finished(uint8_t racerId) const { return racerId < MAX_RACERS && (finishedMask & (1 << racerId)); }
+
+    // Lap mode, per racer. index 0 is the oldest lap still held.
+    uint16_t lapCount(uint8_t racerId) const { return rings[racerId].count; }
+    uint16_t lapsRecorded(uint8_t racerId) const { return rings[racerId].total; }
+    uint64_t lastCrossing(uint8_t racerId) const { return rings[racerId].lastCrossing; }
+
+    const Lap &lap(uint8_t racerId, uint16_t index) const
+    {
+        const LapRing &ring = rings[racerId];
+        uint32_t slot = ring.head + config.lapsPerRacer - ring.count + index;
+        return ring.laps[slot % config.lapsPerRacer];
+    }
+
+    // Held laps newer than afterSeq, in crossing order. Each ring is
+    // seq-ordered, so only its new tail is visited and the tails are merged:
+    // the cost follows the number of new laps, not the session length.
+    template <typename Fn>
+    void forEachLapSince(uint32_t afterSeq, Fn fn) const
+    {
+        uint16_t next[MAX_RACERS];
+        for (uint8_t r = 0; r < MAX_RACERS; r++)
+        {
+            next[r] = rings[r].count;
+            while (next[r] > 0 && lap(r, next[r] - 1).seq > afterSeq)
+                next[r]--;
+        }
+
+        while (true)
+        {
+            const Lap *earliest = nullptr;
+            uint8_t from = 0;
+            for (uint8_t r = 0; r < MAX_RACERS; r++)
+            {
+                if (next[r] >= rings[r].count)
+                    continue;
+                const Lap &candidate = lap(r, next[r]);
+                if (!earliest || candidate.seq < earliest->seq)
+                {
+                    earliest = &candidate;
+                    from = r;
+                }
+            }
+            if (!earliest)
+                return;
+            next[from]++;
+            fn(*earliest);
+        }
+    }
+
+    template <typename Fn>
+    void forEachLap(Fn fn) const { forEachLapSince(0, fn); }
+
+    // Sequence number of the newest stored result or lap (0 = none yet)
+    uint32_t lastSeq() const { return nextSeq - 1; }
+    uint32_t raceNumber() const { return raceCount; }
+
+    uint64_t fastestLap() const { return fastest; }
+    uint8_t fastestLapRacer() const { return fastestRacer; }
+    uint64_t personalBest(uint8_t racerId) const { return stats[racerId].allTimeBest(); }
+    uint64_t personalBestRun(uint8_t racerId) const { return stats[racerId].allTimeBestRun(); }
+    const LapStats &lapStats(uint8_t racerId) const { return stats[racerId]; }
+
+    uint16_t lapCapacity() const { return config.lapsPerRacer; }
+    const Config &getConfig() const { return config; }
+    uint32_t lapsOverwritten() const { return overwritten; }
+    uint32_t lapsRejected() const { return rejected; }
+};
@@ -1,14 +1,33 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <SD.h>
 #include <SPIFFS.h>
-#include <EEPROM.h>
 #include <ESPmDNS.h>
+#include <esp_timer.h>
+#include <atomic>
+#include <memory>
+#include "EventStream.hpp"
+#include "IRCalibrator.hpp"
 #include "IRRacerDetector.hpp"
+#include "JournalStore.hpp"
+#include "JsonReader.hpp"
+#include "JsonStream.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "RaceLogger.hpp"
+#include "RaceState.hpp"
+#include "SectorBoard.hpp"
+#include "Settings.hpp"
+#include "SettingsStore.hpp"
+#include "SpscRing.hpp"
+#include "TimingNetwork.hpp"
+#include "UdpTransport.hpp"
+#include "WebAssets.hpp"
 #include "LEDRing.hpp"
 #include "AudioPlayer.hpp"
+#include "Announcer.hpp"
 
 // ============================================================================
 // Race Timer System Class
@@ -19,286 +38,1312 @@ private:
     IRRacerDetector detector;
     LEDRing leds;
     AudioPlayer audio;
-    WebServer server;
+    Announcer announcer; // Reads lap times out over audio
+    AsyncWebServer server; // Runs in its own task (AsyncTCP)
 
     // FreeRTOS task handle for Core 1 detection
     TaskHandle_t detectionTaskHandle = NULL;
 
-    // Thread-safe queue for detection events
-    QueueHandle_t detectionQueue;
-
+    // All times are esp_timer microseconds. Crossing times are taken from
+    // the packet edge, not from when the packet happened to be processed;
+    // update() makes them relative to raceStartTime.
     struct DetectionEvent
     {
         uint8_t racerId;
-        unsigned long timestamp;
+        uint64_t timestamp;
+        uint8_t reads; // Packets fused into this crossing (confidence)
     };
 
-    enum class Mode
+    // Detection pipeline: the Core 1 task is the only user of the detector
+    // and the only producer; update() on the loop core is the only consumer.
+    static constexpr size_t DETECTION_RING_SIZE = 64;
+    static constexpr size_t DETECTION_BATCH = 8; // Events applied per update()
+    SpscRing<DetectionEvent, DETECTION_RING_SIZE> detections;
+
+    // Set by startRace(), acted on by the detection task so the detector is
+    // never touched from two cores
+    std::atomic<bool> detectorResetPending{false};
+
+    // Detector tuning from the settings; the loop produces, the detection
+    // task applies it between polls
+    struct DetectorConfig
+    {
+        PassAggregator::Config passes;
+        bool acceptV1;
+        IRTiming::Windows windows;
+    };
+    SpscRing<DetectorConfig, 4> detectorConfigs;
+
+    // Calibration: the detection task feeds idle pulses to the calibrator
+    // (its only user) between the start and cancel flags, and hands the
+    // result to the loop, which keeps the windows if they decode better.
+    static constexpr uint32_t CALIBRATION_TIMEOUT_MS = 30000;
+    static constexpr uint32_t NETWORK_STATUS_MS = 250; // networkStatus refresh without traffic
+    IRCalibrator calibrator;
+    std::atomic<bool> calibrationStart{false};
+    std::atomic<bool> calibrationCancel{false};
+
+    struct CalibrationReport
     {
-        RACE,     // Race mode - track positions
-        LAP_TIMER // Lap timer - just record all crossings
+        IRCalibrator::Result result;
+        bool learned;  // Windows derived (a transmitter was seen)
+        bool improves; // and they decode at least as well as before
     };
+    SpscRing<CalibrationReport, 2> calibrationReports;
 
-    struct RaceResult
+    // What GET /calibrate shows (loop writes, under stateMutex)
+    struct CalibrationStatus
     {
-        uint8_t racerId;
-        unsigned long timestamp;
-        uint8_t position;
+        enum State : uint8_t
+        {
+            IDLE,
+            RUNNING,
+            APPLIED,  // Learned windows now in use
+            REJECTED, // Learned, but no better than the windows in use
+            FAILED    // No transmitter at the gate, or cancelled
+        };
+
+        State state = IDLE;
+        uint32_t startedMs = 0;
+        IRCalibrator::Result result;
     };
+    CalibrationStatus calibration;
+
+    using Mode = RaceState::Mode;
 
-    struct LapTime
+    // Threading: update() on the loop task is the only writer of race
+    // state (race, settings). It takes stateMutex to modify; the web task
+    // takes it to read, so every response is a consistent snapshot. Changes
+    // requested over HTTP go to the loop through the command ring.
+    SemaphoreHandle_t stateMutex = NULL;
+
+    class StateLock
     {
-        uint8_t racerId;
-        unsigned long lapTime;
-        unsigned long timestamp;
+        SemaphoreHandle_t mutex;
+
+    public:
+        explicit StateLock(SemaphoreHandle_t mutex) : mutex(mutex) { xSemaphoreTake(mutex, portMAX_DELAY); }
+        ~StateLock() { xSemaphoreGive(mutex); }
+    };
+
+    static constexpr size_t MAX_NAME_LENGTH = Settings::MAX_NAME_LENGTH;
+    static constexpr size_t MAX_BODY_LENGTH = 1024; // All eight names, escaped
+
+    struct Command
+    {
+        enum Type : uint8_t
+        {
+            START,
+            STOP,
+            SET_MODE,  // value = Mode
+            SET_NAMES, // value = bit per racer in names
+            SET_TUNING, // tuning, gateId, gateCount
+            CALIBRATE   // value = CalibrateAction
+        };
+
+        Type type;
+        uint8_t value;
+        char names[RaceState::MAX_RACERS][MAX_NAME_LENGTH + 1];
+        Settings::Tuning tuning;
+        uint8_t gateId;
+        uint8_t gateCount;
     };
 
-    std::vector<RaceResult> results;
-    std::vector<LapTime> laps;
-    String racerNames[8] = {"Racer 0", "Racer 1", "Racer 2", "Racer 3",
-                            "Racer 4", "Racer 5", "Racer 6", "Racer 7"};
+    enum CalibrateAction : uint8_t
+    {
+        CALIBRATION_START,
+        CALIBRATION_FORGET // Back to the nominal windows
+    };
 
-    unsigned long fastestLap = 0xFFFFFFFF; // Track overall fastest
-    uint8_t fastestLapRacer = 0;
-    unsigned long personalBest[8] = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
-                                     0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+    // Web task produces, update() consumes
+    static constexpr size_t COMMAND_RING_SIZE = 8;
+    SpscRing<Command, COMMAND_RING_SIZE> commands;
 
-    Mode currentMode = Mode::RACE;
-    bool raceActive = false;
-    unsigned long raceStartTime = 0;
-    unsigned long lastDetectionTime[8] = {0}; // Non-blocking debounce per racer
-    static constexpr unsigned long DEBOUNCE_MS = 200;
+    static constexpr size_t RESULT_ITEM_SIZE = 320; // One entry, escaped name included
+
+    // Progress of one chunked /results response
+    struct ResultsCursor
+    {
+        enum Stage : uint8_t
+        {
+            OPEN,
+            ITEMS,
+            DONE
+        };
+
+        uint32_t since = 0; // Last seq sent
+        uint32_t until = 0; // X-Seq: newest seq this response may include
+        uint32_t raceNumber = 0;
+        Stage stage = OPEN;
+        bool first = true;
+
+        // Tail of an entry that did not fit its chunk, sent first in the next
+        char pending[RESULT_ITEM_SIZE + 1];
+        uint16_t pendingLength = 0;
+        uint16_t pendingSent = 0;
+    };
+
+    RaceState race;
+    Settings settings;            // Names, mode and tuning (loop owned)
+    SettingsStore settingsStore; // Kept in NVS
+
+    std::atomic<bool> raceActive{false};
+    uint64_t raceStartTime = 0;
+
+    char jsonBuffer[1024]; // Reused by small JSON responses (web task only)
+    EventStream events;    // Live push to browsers on /events
+    WebAssets assets;      // Gzipped web app with ETags
+    RaceLogger logger;     // Binary race log on SD (/races.bin)
+    JournalStore journal;  // Session journal on SD, replayed on boot
+
+    // Timing network (loop only). The master (gate 0) runs the race and
+    // puts split crossings into sectors; a split (gate 1-3) follows the
+    // master's race state and sends its crossings there instead of timing
+    // laps itself. A lone gate leaves the network disabled.
+    using Network = TimingNetwork<UdpTransport>;
+    UdpTransport transport;
+    Network network;
+    SectorBoard sectors;          // Master: sector times, race relative (loop writes, under stateMutex)
+    Network::Status networkStatus; // For /network and /metrics (loop writes, under stateMutex)
+    uint32_t networkStatusMs = 0;  // Last networkStatus refresh
+    std::atomic<bool> splitGate{false};
+
+    // Loop jitter: longest gap between update() calls, reset by /decoder
+    std::atomic<uint32_t> loopMaxGapUs{0};
+    uint64_t lastUpdateUs = 0;
+
+    // Hot-path timing for /metrics, each recorded by one task
+    LatencyHistogram decodeTime; // Detection task: one drain of the pulse ring
+    LatencyHistogram loopTime;   // Loop: one update()
+    LatencyHistogram loopGap;    // Loop: start to start of update()
+    LatencyHistogram httpTime;   // Web task: one route handler
 
     // Core 1 detection task (runs independently)
     static void detectionTask(void *parameter)
     {
         RaceTimerSystem *timer = (RaceTimerSystem *)parameter;
 
-        Serial.println("Detection task started on Core 1");
+        DETECTION_LOG(INFO, "Detection task started on Core 1\n");
 
         while (true)
         {
-            if (timer->raceActive)
-            {
-                // CRITICAL: This runs uninterrupted on Core 1
-                int racerId = timer->detector.decode();
+            if (timer->detectorResetPending.exchange(false))
+                timer->detector.reset();
 
-                if (racerId >= 0 && racerId <= 7)
-                {
-                    unsigned long now = millis();
-
-                    // Check debounce
-                    if (now - timer->lastDetectionTime[racerId] >= DEBOUNCE_MS)
-                    {
-                        timer->lastDetectionTime[racerId] = now;
+            DetectorConfig config;
+            while (timer->detectorConfigs.pop(config))
+            {
+                timer->detector.configurePasses(config.passes);
+                timer->detector.setAcceptV1(config.acceptV1);
+                if (!timer->detector.setWindows(config.windows))
+                    DETECTION_LOG(WARN, "[Core 1] Decoder timing is fixed (IR_TIMING_PROFILE), windows not applied\n");
+            }
 
-                        // Send detection event to Core 0 via queue
-                        DetectionEvent event = {
-                            static_cast<uint8_t>(racerId),
-                            now - timer->raceStartTime};
+            if (timer->calibrationStart.exchange(false))
+            {
+                timer->detector.edges().flush();
+                timer->calibrator.begin(timer->detector.packetDecoder().windows());
+            }
+            if (timer->calibrationCancel.exchange(false))
+                timer->calibrator.cancel();
 
-                        xQueueSend(timer->detectionQueue, &event, 0);
+            if (timer->raceActive)
+            {
+                // Drain everything captured since the last pass. Only passes
+                // that had pulses to decode are timed.
+                bool decoding = !timer->detector.edges().ring().empty();
+                uint64_t start = esp_timer_get_time();
+                IRRacerDetector::Crossing crossing;
+                while (timer->detector.poll(crossing))
+                {
+                    DetectionEvent event = {
+                        crossing.racerId,
+                        crossing.timestamp,
+                        crossing.reads};
 
-                        Serial.printf("[Core 1] Detected Racer %d at %lu ms\n",
-                                      racerId, event.timestamp);
-                    }
+                    if (!timer->detections.push(event)) // Counted on /metrics
+                        DETECTION_LOG(WARN, "[Core 1] Detection ring full, Racer %d dropped\n", crossing.racerId);
+                }
+                if (decoding)
+                    timer->decodeTime.record(esp_timer_get_time() - start);
+            }
+            else if (timer->calibrator.state() != IRCalibrator::Phase::IDLE)
+            {
+                IRPulse pulse;
+                while (!timer->calibrator.finished() && timer->detector.edges().read(pulse))
+                    timer->calibrator.feed(pulse.level, pulse.duration, pulse.start);
+                if (timer->calibrator.finished())
+                {
+                    timer->calibrationReports.push({timer->calibrator.result(),
+                                                    timer->calibrator.state() == IRCalibrator::Phase::DONE,
+                                                    timer->calibrator.improves()});
+                    timer->calibrator.cancel();
                 }
             }
+            else
+            {
+                // Idle noise would only fill the pulse ring
+                timer->detector.edges().flush();
+            }
 
             // Tiny yield to prevent watchdog timeout
             vTaskDelay(1); // 1ms
         }
     }
 
-    void setupWebServer()
+    // A route whose handler time goes into httpTime
+    template <typename Fn>
+    void route(const char *uri, WebRequestMethodComposite method, Fn handler)
+    {
+        server.on(uri, method, timed(handler));
+    }
+
+    template <typename Fn>
+    void route(const char *uri, WebRequestMethodComposite method, Fn handler, ArUploadHandlerFunction upload,
+               ArBodyHandlerFunction body)
+    {
+        server.on(uri, method, timed(handler), upload, body);
+    }
+
+    template <typename Fn>
+    ArRequestHandlerFunction timed(Fn handler)
     {
-        // Serve files from SPIFFS
-        server.serveStatic("/", SPIFFS, "/index.html");
-        server.serveStatic("/style.css", SPIFFS, "/style.css");
-        server.serveStatic("/app.js", SPIFFS, "/app.js");
-        server.serveStatic("/assets", SPIFFS, "/assets/");
+        return [this, handler](AsyncWebServerRequest *request)
+        {
+            uint32_t start = micros();
+            handler(request);
+            httpTime.record(micros() - start);
+        };
+    }
 
+    void setupWebServer()
+    {
         // API: Get current mode
-        server.on("/mode", HTTP_GET, [this]()
-                  {
-            String mode = (currentMode == Mode::RACE) ? "race" : "lap";
-            server.send(200, "text/plain", mode); });
+        route("/mode", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            StateLock lock(stateMutex);
+            request->send(200, "text/plain", race.getMode() == Mode::RACE ? "race" : "lap"); });
 
         // API: Set mode
-        server.on("/mode", HTTP_POST, [this]()
-                  {
-            if(server.hasArg("plain")) {
-                String body = server.arg("plain");
-                if(body == "race") {
-                    currentMode = Mode::RACE;
-                    server.send(200, "text/plain", "Mode set to RACE");
-                } else if(body == "lap") {
-                    currentMode = Mode::LAP_TIMER;
-                    server.send(200, "text/plain", "Mode set to LAP TIMER");
-                } else {
-                    server.send(400, "text/plain", "Invalid mode");
-                }
-            } });
+        route(
+            "/mode", HTTP_POST, [this](AsyncWebServerRequest *request)
+            {
+            String body = bodyOf(request);
+            if(body == "race") {
+                queueCommand(request, {Command::SET_MODE, (uint8_t)Mode::RACE}, "Mode set to RACE");
+            } else if(body == "lap") {
+                queueCommand(request, {Command::SET_MODE, (uint8_t)Mode::LAP_TIMER}, "Mode set to LAP TIMER");
+            } else {
+                request->send(400, "text/plain", "Invalid mode");
+            } },
+            nullptr, collectBody);
 
         // API: Get racer names
-        server.on("/racers", HTTP_GET, [this]()
-                  {
-            String json = "[";
-            for(int i = 0; i < 8; i++) {
-                if(i > 0) json += ",";
-                json += "{\"id\":" + String(i) +
-                       ",\"name\":\"" + racerNames[i] + "\"" +
-                       ",\"color\":\"#" + String(leds.getRacerColor(i), HEX) + "\"" +
-                       ",\"pb\":" + String(personalBest[i] == 0xFFFFFFFF ? 0 : personalBest[i]) + "}";
+        route("/racers", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                json.beginArray();
+                for(uint8_t i = 0; i < 8; i++) {
+                    char color[8];
+                    snprintf(color, sizeof(color), "#%06x", (unsigned)(leds.getRacerColor(i) & 0xFFFFFF));
+                    uint64_t pb = race.personalBest(i);
+                    json.beginObject()
+                        .field("id", i)
+                        .field("name", settings.name(i))
+                        .field("color", color)
+                        .field("pb", pb == RaceState::NO_TIME ? 0 : pb)
+                        .endObject();
+                }
+                json.endArray();
+            }); });
+
+        // API: Set one racer name, {"id":n,"name":"..."}
+        route(
+            "/racers", HTTP_POST, [this](AsyncWebServerRequest *request)
+            {
+            Command command = {Command::SET_NAMES};
+            JsonReader json(bodyText(request), bodyLength(request));
+            if(readRacer(json, command) && json.end()) {
+                queueCommand(request, command, "Racer name updated");
+            } else {
+                request->send(400, "text/plain", "Invalid data");
+            } },
+            nullptr, collectBody);
+
+        // API: Set several racer names in one request, an array of
+        // {"id":n,"name":"..."} (other fields, as /racers returns them, are
+        // ignored)
+        route(
+            "/racers", HTTP_PUT, [this](AsyncWebServerRequest *request)
+            {
+            Command command = {Command::SET_NAMES};
+            JsonReader json(bodyText(request), bodyLength(request));
+            bool valid = json.beginArray();
+            while(valid && json.nextElement())
+                valid = readRacer(json, command);
+            if(valid && json.end() && command.value) {
+                queueCommand(request, command, "Racer names updated");
+            } else {
+                request->send(400, "text/plain", "Invalid data");
+            } },
+            nullptr, collectBody);
+
+        // API: Stored settings
+        route("/settings", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                const Settings::Tuning &tuning = settings.tuning();
+                json.beginObject()
+                    .field("version", Settings::VERSION)
+                    .field("mode", settings.mode() == Mode::RACE ? "race" : "lap")
+                    .field("acceptV1", tuning.acceptV1)
+                    .field("minReads", tuning.minReads)
+                    .field("passGapMs", tuning.passGapMs)
+                    .field("maxPassMs", tuning.maxPassMs)
+                    .field("minLapMs", tuning.minLapMs)
+                    .field("brightness", tuning.brightness)
+                    .field("volume", tuning.volume)
+                    .field("gateId", settings.gateId())
+                    .field("gateCount", settings.gateCount())
+                    .fieldBool("calibrated", settings.calibrated())
+                    .fieldBool("unsaved", settings.pending())
+                    .endObject();
+            }); });
+
+        // API: Change tuning. Takes any subset of the numeric fields of
+        // GET /settings; out-of-range values are clamped. Changing gateId or
+        // gateCount stops a running race and restarts the timing network.
+        route(
+            "/settings", HTTP_PUT, [this](AsyncWebServerRequest *request)
+            {
+            Command command = {Command::SET_TUNING};
+            {
+                StateLock lock(stateMutex);
+                command.tuning = settings.tuning();
+                command.gateId = settings.gateId();
+                command.gateCount = settings.gateCount();
             }
-            json += "]";
-            server.send(200, "application/json", json); });
-
-        // API: Set racer name
-        server.on("/racers", HTTP_POST, [this]()
-                  {
-            if(server.hasArg("plain")) {
-                String body = server.arg("plain");
-                int idStart = body.indexOf("\"id\":") + 5;
-                int idEnd = body.indexOf(",", idStart);
-                int id = body.substring(idStart, idEnd).toInt();
-
-                int nameStart = body.indexOf("\"name\":\"") + 8;
-                int nameEnd = body.indexOf("\"", nameStart);
-                String name = body.substring(nameStart, nameEnd);
-
-                if(id >= 0 && id < 8 && name.length() > 0) {
-                    racerNames[id] = name;
-                    saveRacerNamesToEEPROM();
-                    server.send(200, "text/plain", "Racer name updated");
+            if(readTuning(bodyText(request), bodyLength(request), command)) {
+                queueCommand(request, command, "Settings updated");
+            } else {
+                request->send(400, "text/plain", "Invalid data");
+            } },
+            nullptr, collectBody);
+
+        // API: Calibrate the decoder timing. Hold a transmitter at the gate,
+        // POST, then poll GET until state is no longer "running" (a few
+        // seconds). DELETE goes back to the nominal windows.
+        route("/calibrate", HTTP_POST, [this](AsyncWebServerRequest *request)
+              {
+            if(raceActive) {
+                request->send(409, "text/plain", "Race running");
+                return;
+            }
+            queueCommand(request, {Command::CALIBRATE, CALIBRATION_START}, "Calibrating, hold a transmitter at the gate"); });
+
+        route("/calibrate", HTTP_DELETE, [this](AsyncWebServerRequest *request)
+              { queueCommand(request, {Command::CALIBRATE, CALIBRATION_FORGET}, "Nominal timing restored"); });
+
+        route("/calibrate", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                static const char *const STATES[] = {"idle", "running", "applied", "rejected", "failed"};
+                const IRCalibrator::Result &result = calibration.result;
+                json.beginObject()
+                    .field("state", STATES[calibration.state])
+                    .fieldSigned("stretchUs", result.stretchUs)
+                    .field("bursts", result.bursts)
+                    .field("gaps", result.gaps)
+                    .field("learnedClasses", result.learnedClasses)
+                    .field("packetsBefore", result.packetsBefore)
+                    .field("packetsAfter", result.packetsAfter)
+                    .fieldBool("calibrated", settings.calibrated());
+                json.key("windows");
+                writeWindows(json, settings.windows());
+                json.endObject();
+            }); });
+
+        // API: Get fastest lap info
+        route("/fastest", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                uint64_t fastest = race.fastestLap();
+                json.beginObject()
+                    .field("overall", fastest == RaceState::NO_TIME ? 0 : fastest)
+                    .field("racer", race.fastestLapRacer())
+                    .field("name", settings.name(race.fastestLapRacer()))
+                    .endObject();
+            }); });
+
+        // API: Lap statistics per racer that has laps (or an all-time
+        // best), from running totals: no lap list is read. Times are µs,
+        // 0 = not enough laps yet; best3 is the best CONSECUTIVE laps in a
+        // row, sd the lap time standard deviation (consistency).
+        route("/stats", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                json.beginObject()
+                    .field("race", race.raceNumber())
+                    .field("run", LapStats::CONSECUTIVE)
+                    .key("racers")
+                    .beginArray();
+                for(uint8_t i = 0; i < RaceState::MAX_RACERS; i++) {
+                    const LapStats &stats = race.lapStats(i);
+                    if(!stats.laps() && stats.allTimeBest() == LapStats::NO_TIME)
+                        continue;
+                    json.beginObject()
+                        .field("id", i)
+                        .field("laps", stats.laps())
+                        .field("total", stats.total())
+                        .field("last", orZero(stats.last()))
+                        .field("best", orZero(stats.best()))
+                        .field("best3", orZero(stats.bestRun()))
+                        .field("mean", orZero(stats.mean()))
+                        .field("median", orZero(stats.median()))
+                        .field("sd", orZero(stats.deviation()))
+                        .field("allTimeBest", orZero(stats.allTimeBest()))
+                        .field("allTimeBest3", orZero(stats.allTimeBestRun()))
+                        .endObject();
+                }
+                json.endArray().endObject();
+            }); });
+
+        // API: Decoder and loop health. loopMaxGapUs is the longest gap
+        // between update() calls since the previous /decoder request.
+        route("/decoder", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                const IRRacerDetector::Decoder &decoder = detector.packetDecoder();
+                json.beginObject()
+                    .field("attempts", decoder.attempts())
+                    .field("packets", decoder.packetsDecoded())
+                    .field("v1", decoder.v1Packets())
+                    .field("rejected", decoder.checkRejects())
+                    .field("resyncs", decoder.resyncs())
+                    .field("badBits", decoder.badBits())
+                    .field("timeouts", decoder.timeouts())
+                    .field("noisePasses", detector.passAggregator().rejected())
+                    .field("overflows", detector.edges().overflowCount())
+                    .field("pulseHighWater", detector.edges().highWaterMark())
+                    .field("eventsDropped", detections.droppedCount())
+                    .field("eventsHighWater", detections.highWaterMark())
+                    .field("commandsDropped", commands.droppedCount())
+                    .field("loopMaxGapUs", loopMaxGapUs.exchange(0))
+                    .field("viewers", events.clientCount())
+                    .endObject();
+            }); });
+
+        // API: Counters and latency histograms, Prometheus text format
+        route("/metrics", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+            PrometheusWriter metrics(jsonBuffer, sizeof(jsonBuffer), streamChunk, response);
+            Network::Status net;
+            {
+                StateLock lock(stateMutex);
+                net = networkStatus;
+            }
+            writeMetrics(metrics, net);
+            metrics.flush();
+            request->send(response); });
+
+        // API: The same as compact JSON
+        route("/metrics.json", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                JsonMetricsWriter metrics(json);
+                metrics.begin();
+                writeMetrics(metrics, networkStatus); // sendJson holds the state lock
+                metrics.end();
+            }); });
+
+        // Start race (the master gate only; splits follow it)
+        route("/start", HTTP_ANY, [this](AsyncWebServerRequest *request)
+              {
+            if(splitGate) {
+                request->send(409, "text/plain", "Split gate, start the race on gate 0");
+                return;
+            }
+            queueCommand(request, {Command::START}, "Race started"); });
+
+        // Stop race
+        route("/stop", HTTP_ANY, [this](AsyncWebServerRequest *request)
+              {
+            if(splitGate) {
+                request->send(409, "text/plain", "Split gate, stop the race on gate 0");
+                return;
+            }
+            queueCommand(request, {Command::STOP}, "Race stopped"); });
+
+        // API: Sector times from the split gates (master). Times are µs,
+        // 0 = none yet; optimal is the sum of the best sectors.
+        route("/sectors", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                json.beginObject()
+                    .field("gates", sectors.gateCount())
+                    .key("racers")
+                    .beginArray();
+                for(uint8_t i = 0; i < SectorBoard::MAX_RACERS; i++) {
+                    json.beginObject()
+                        .field("id", i)
+                        .field("name", settings.name(i));
+                    json.key("last").beginArray();
+                    for(uint8_t s = 0; s < sectors.sectorCount(); s++)
+                        json.number(orZero(sectors.lastSector(i, s)));
+                    json.endArray().key("best").beginArray();
+                    for(uint8_t s = 0; s < sectors.sectorCount(); s++)
+                        json.number(orZero(sectors.bestSector(i, s)));
+                    json.endArray()
+                        .field("optimal", orZero(sectors.optimalLap(i)))
+                        .endObject();
+                }
+                json.endArray().endObject();
+            }); });
+
+        // API: Timing network state. A split shows its clock against the
+        // master's; the master shows each split as last heard from.
+        route("/network", HTTP_GET, [this](AsyncWebServerRequest *request)
+              {
+            sendJson(request, [this](JsonStream &json) {
+                const Network::Status &status = networkStatus;
+                json.beginObject()
+                    .field("gate", status.gate)
+                    .field("gates", settings.gateCount())
+                    .fieldBool("enabled", status.enabled)
+                    .fieldBool("racing", status.racing)
+                    .field("raceNumber", status.raceNumber)
+                    .field("badMessages", status.badMessages);
+                if(status.gate != 0) {
+                    json.fieldBool("masterFound", status.masterFound)
+                        .fieldBool("synced", status.synced)
+                        .fieldSigned("offsetUs", status.offsetUs)
+                        .fieldSigned("driftPpb", status.driftPpb)
+                        .field("delayUs", status.delayUs)
+                        .field("exchanges", status.exchanges)
+                        .field("masterRestarts", status.masterRestarts)
+                        .field("crossingsSent", status.crossingsSent)
+                        .field("crossingsAcked", status.crossingsAcked)
+                        .field("resends", status.resends)
+                        .field("outboxDrops", status.outboxDrops);
                 } else {
-                    server.send(400, "text/plain", "Invalid data");
+                    uint64_t now = esp_timer_get_time();
+                    json.key("splits").beginArray();
+                    for(uint8_t gate = 1; gate < Network::MAX_GATES; gate++) {
+                        const Network::GateStatus &split = status.gates[gate];
+                        if(!split.seen)
+                            continue;
+                        json.beginObject()
+                            .field("gate", gate)
+                            .fieldBool("synced", split.synced)
+                            .field("lastSeenMs", (now - split.lastSeenUs) / 1000)
+                            .field("delayUs", split.delayUs)
+                            .fieldSigned("driftPpb", split.driftPpb)
+                            .field("crossings", split.crossings)
+                            .field("duplicates", split.duplicates)
+                            .endObject();
+                    }
+                    json.endArray();
                 }
-            } });
+                json.endObject();
+            }); });
+
+        // Get results. ?since=<seq> returns only entries newer than seq.
+        // X-Seq is the newest seq included; X-Race changes when a new race
+        // starts, telling the client to drop what it has and reload.
+        route("/results", HTTP_ANY, [this](AsyncWebServerRequest *request)
+              {
+            auto cursor = std::make_shared<ResultsCursor>();
+            cursor->since = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), nullptr, 10) : 0;
+            {
+                StateLock lock(stateMutex);
+                cursor->until = race.lastSeq();
+                cursor->raceNumber = race.raceNumber();
+            }
 
-        // API: Get fastest lap info
-        server.on("/fastest", HTTP_GET, [this]()
-                  {
-            String json = "{";
-            json += "\"overall\":" + String(fastestLap == 0xFFFFFFFF ? 0 : fastestLap) + ",";
-            json += "\"racer\":" + String(fastestLapRacer) + ",";
-            json += "\"name\":\"" + racerNames[fastestLapRacer] + "\"";
-            json += "}";
-            server.send(200, "application/json", json); });
-
-        // Start race
-        server.on("/start", [this]()
-                  {
+            AsyncWebServerResponse *response = request->beginChunkedResponse(
+                "application/json", [this, cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                { return fillResults(*cursor, (char *)buffer, maxLen); });
+            response->addHeader("X-Seq", String(cursor->until));
+            response->addHeader("X-Race", String(cursor->raceNumber));
+            request->send(response); });
+
+        // Live events (Server-Sent Events)
+        events.begin(server);
+
+        // Web app as built by tools/build_web.py. Anything not in its
+        // manifest (or a raw data/ upload) falls through to serveStatic.
+        if (!assets.begin(server))
+            Serial.println("No web asset manifest, serving raw files");
+        server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+        server.onNotFound([](AsyncWebServerRequest *request)
+                          { request->send(404, "text/plain", "Not found"); });
+
+        server.begin();
+    }
+
+    // Hand a state change to the loop. Fails (503) only if the loop has
+    // fallen COMMAND_RING_SIZE commands behind.
+    void queueCommand(AsyncWebServerRequest *request, const Command &command, const char *reply)
+    {
+        if (commands.push(command))
+            request->send(200, "text/plain", reply);
+        else
+            request->send(503, "text/plain", "Busy");
+    }
+
+    void applyCommand(const Command &command)
+    {
+        switch (command.type)
+        {
+        case Command::START:
             startRace();
-            server.send(200, "text/plain", "Race started"); });
+            break;
 
-        // Stop race
-        server.on("/stop", [this]()
-                  {
+        case Command::STOP:
             stopRace();
-            server.send(200, "text/plain", "Race stopped"); });
-
-        // Get results
-        server.on("/results", [this]()
-                  {
-            String json = "[";
-
-            if(currentMode == Mode::RACE) {
-                // Race mode - show positions
-                for(size_t i = 0; i < results.size(); i++) {
-                    if(i > 0) json += ",";
-                    json += "{\"racer\":" + String(results[i].racerId) +
-                           ",\"name\":\"" + racerNames[results[i].racerId] + "\"" +
-                           ",\"time\":" + String(results[i].timestamp) +
-                           ",\"position\":" + String(results[i].position) + "}";
+            break;
+
+        case Command::SET_MODE:
+        {
+            StateLock lock(stateMutex);
+            race.setMode((Mode)command.value);
+            settings.setMode((Mode)command.value, millis());
+        }
+            journal.modeChanged((Mode)command.value);
+            sendModeEvent();
+            break;
+
+        case Command::SET_NAMES:
+        {
+            // Stored by update() once the edits settle
+            StateLock lock(stateMutex);
+            for (uint8_t i = 0; i < RaceState::MAX_RACERS; i++)
+            {
+                if (command.value & (1 << i))
+                    settings.setName(i, command.names[i], millis());
+            }
+        }
+            break;
+
+        case Command::SET_TUNING:
+        {
+            bool gateChanged = command.gateId != settings.gateId() || command.gateCount != settings.gateCount();
+            {
+                StateLock lock(stateMutex);
+                settings.setTuning(command.tuning, millis());
+                settings.setGate(command.gateId, command.gateCount, millis());
+            }
+            applyTuning();
+            if (gateChanged)
+            {
+                if (splitGate)
+                {
+                    raceActive = false; // The master's race, not ours
+                    leds.setStatus(LEDRing::Status::IDLE);
                 }
-            } else {
-                // Lap timer mode - show all laps
-                for(size_t i = 0; i < laps.size(); i++) {
-                    if(i > 0) json += ",";
-                    json += "{\"racer\":" + String(laps[i].racerId) +
-                           ",\"name\":\"" + racerNames[laps[i].racerId] + "\"" +
-                           ",\"lapTime\":" + String(laps[i].lapTime) +
-                           ",\"timestamp\":" + String(laps[i].timestamp) + "}";
+                else if (raceActive)
+                {
+                    stopRace();
+                }
+                startNetwork();
+            }
+        }
+            break;
+
+        case Command::CALIBRATE:
+            if (command.value == CALIBRATION_FORGET)
+            {
+                {
+                    StateLock lock(stateMutex);
+                    settings.setWindows(IRTiming::nominal(), false, millis());
+                }
+                applyTuning();
+            }
+            else if (!raceActive)
+            {
+                CalibrationReport stale; // Finished just as an earlier run was cancelled
+                while (calibrationReports.pop(stale))
+                {
+                }
+                {
+                    StateLock lock(stateMutex);
+                    calibration.state = CalibrationStatus::RUNNING;
+                    calibration.startedMs = millis();
+                    calibration.result = IRCalibrator::Result();
                 }
+                calibrationStart = true;
+                Serial.println("Calibrating: hold a transmitter at the gate");
             }
+            break;
+        }
+    }
 
-            json += "]";
-            server.send(200, "application/json", json); });
+    // A finished calibration from the detection task, or a timeout
+    void updateCalibration()
+    {
+        if (calibration.state != CalibrationStatus::RUNNING)
+            return;
 
-        server.begin();
+        CalibrationReport report;
+        if (!calibrationReports.pop(report))
+        {
+            if (millis() - calibration.startedMs < CALIBRATION_TIMEOUT_MS)
+                return;
+            calibrationCancel = true;
+            StateLock lock(stateMutex);
+            calibration.state = CalibrationStatus::FAILED;
+            Serial.println("Calibration: no transmitter seen");
+            leds.flash(255, 0, 0);
+            return;
+        }
+
+        const IRCalibrator::Result &result = report.result;
+        {
+            StateLock lock(stateMutex);
+            calibration.result = result;
+            if (!report.learned)
+                calibration.state = CalibrationStatus::FAILED;
+            else if (!report.improves)
+                calibration.state = CalibrationStatus::REJECTED;
+            else
+            {
+                calibration.state = CalibrationStatus::APPLIED;
+                settings.setWindows(result.windows, true, millis());
+            }
+        }
+        Serial.printf("Calibration: stretch %d us, %u classes learned, %u -> %u packets decoded, %s\n",
+                      result.stretchUs, result.learnedClasses, result.packetsBefore, result.packetsAfter,
+                      calibration.state == CalibrationStatus::APPLIED    ? "applied"
+                      : calibration.state == CalibrationStatus::REJECTED ? "kept the windows in use"
+                                                                         : "failed");
+        if (calibration.state == CalibrationStatus::APPLIED)
+        {
+            applyTuning();
+            leds.flash(0, 255, 0);
+        }
+        else
+        {
+            leds.flash(255, 0, 0);
+        }
     }
 
-    void logToSD(const RaceResult &result)
+    static void writeWindow(JsonStream &json, const char *name, const IRWindow &window)
     {
-        // Non-blocking SD logging using background write
-        // TODO: Implement proper async SD writes
-        // For now, quick write with minimal blocking
-        Serial.printf("LOG: Racer %d, Time %lu, Position %d\n",
-                      result.racerId, result.timestamp, result.position);
+        json.key(name).beginArray().number(window.min).number(window.max).endArray();
+    }
 
-        // Quick SD write (keep file operations minimal)
-        // File file = SD.open("/races.csv", FILE_APPEND);
-        // if(file) {
-        //     file.printf("%d,%lu,%d\n", result.racerId, result.timestamp, result.position);
-        //     file.close();
-        // }
+    static void writeWindows(JsonStream &json, const IRTiming::Windows &w)
+    {
+        json.beginObject();
+        writeWindow(json, "syncBurst", w.syncBurst);
+        writeWindow(json, "syncGap", w.syncGap);
+        writeWindow(json, "bitBurst", w.bitBurst);
+        writeWindow(json, "shortGap", w.shortGap);
+        writeWindow(json, "longGap", w.longGap);
+        writeWindow(json, "markerBurst", w.markerBurst);
+        writeWindow(json, "compactGap", w.compactGap);
+        json.field("compactBase", w.compactBase).field("compactStep", w.compactStep).endObject();
     }
 
-    void saveRacerNamesToEEPROM()
+    // Hand the tuning in the settings to the parts that use it
+    void applyTuning()
     {
-        // Save all racer names to EEPROM
-        EEPROM.begin(512);
-        int addr = 0;
+        const Settings::Tuning &tuning = settings.tuning();
+        {
+            StateLock lock(stateMutex);
+            race.setMinLap(tuning.minLapMs * 1000ULL);
+        }
+
+        PassAggregator::Config passes;
+        passes.gapUs = tuning.passGapMs * 1000UL;
+        passes.maxPassUs = tuning.maxPassMs * 1000UL;
+        passes.minReads = tuning.minReads;
+        detectorConfigs.push({passes, tuning.acceptV1 != 0, settings.windows()});
+
+        leds.setBrightness(tuning.brightness);
+        audio.setVolume(tuning.volume);
+    }
 
-        for (int i = 0; i < 8; i++)
+    // One {"id":n,"name":"..."} into a SET_NAMES command
+    static bool readRacer(JsonReader &json, Command &command)
+    {
+        long id = -1;
+        char name[MAX_NAME_LENGTH + 1] = "";
+        char key[16];
+        json.beginObject();
+        while (json.nextKey(key, sizeof(key)))
         {
-            int len = racerNames[i].length();
-            EEPROM.write(addr++, len); // Store length
-            for (int j = 0; j < len && j < 30; j++)
-            { // Max 30 chars per name
-                EEPROM.write(addr++, racerNames[i][j]);
+            if (!strcmp(key, "id"))
+                json.number(id);
+            else if (!strcmp(key, "name"))
+                json.string(name, sizeof(name)); // Fails if too long
+            else
+                json.skipValue();
+        }
+        if (!json.ok() || id < 0 || id >= RaceState::MAX_RACERS || !name[0])
+            return false;
+        memcpy(command.names[id], name, sizeof(name));
+        command.value |= 1 << id;
+        return true;
+    }
+
+    // Numeric fields of a PUT /settings body over a SET_TUNING command
+    static bool readTuning(const char *body, size_t length, Command &command)
+    {
+        Settings::Tuning &tuning = command.tuning;
+        JsonReader json(body, length);
+        char key[16];
+        json.beginObject();
+        while (json.nextKey(key, sizeof(key)))
+        {
+            long value = 0;
+            uint8_t *byteField = nullptr;
+            uint16_t *wordField = nullptr;
+            if (!strcmp(key, "acceptV1"))
+                byteField = &tuning.acceptV1;
+            else if (!strcmp(key, "minReads"))
+                byteField = &tuning.minReads;
+            else if (!strcmp(key, "brightness"))
+                byteField = &tuning.brightness;
+            else if (!strcmp(key, "volume"))
+                byteField = &tuning.volume;
+            else if (!strcmp(key, "gateId"))
+                byteField = &command.gateId;
+            else if (!strcmp(key, "gateCount"))
+                byteField = &command.gateCount;
+            else if (!strcmp(key, "passGapMs"))
+                wordField = &tuning.passGapMs;
+            else if (!strcmp(key, "maxPassMs"))
+                wordField = &tuning.maxPassMs;
+            else if (!strcmp(key, "minLapMs"))
+                wordField = &tuning.minLapMs;
+
+            if (!byteField && !wordField)
+            {
+                json.skipValue(); // version, mode, unsaved
+                continue;
             }
+            if (!json.number(value) || value < 0 || value > (byteField ? 255 : 65535))
+                return false;
+            if (byteField)
+                *byteField = value;
+            else
+                *wordField = value;
         }
+        return json.end();
+    }
+
+    // Small request bodies (mode, racers, settings) are collected into _tempObject,
+    // which the server frees with the request
+    static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t length,
+                            size_t index, size_t total)
+    {
+        if (total > MAX_BODY_LENGTH)
+            return;
+        if (index == 0)
+            request->_tempObject = calloc(total + 1, 1);
+        if (request->_tempObject)
+            memcpy((char *)request->_tempObject + index, data, length);
+    }
+
+    static String bodyOf(AsyncWebServerRequest *request)
+    {
+        return request->_tempObject ? String((const char *)request->_tempObject) : String();
+    }
+
+    static const char *bodyText(AsyncWebServerRequest *request)
+    {
+        return request->_tempObject ? (const char *)request->_tempObject : "";
+    }
+
+    static size_t bodyLength(AsyncWebServerRequest *request) { return strlen(bodyText(request)); }
+
+    // One /results entry; also the payload of a crossing event
+    void writeResult(JsonStream &json, const RaceState::Result &result)
+    {
+        json.beginObject()
+            .field("racer", result.racerId)
+            .field("name", settings.name(result.racerId))
+            .field("time", result.timestamp)
+            .field("position", result.position)
+            .field("reads", result.reads)
+            .field("seq", result.seq)
+            .endObject();
+    }
 
-        EEPROM.commit();
-        Serial.println("Racer names saved to EEPROM");
+    void writeLap(JsonStream &json, const RaceState::Lap &lap)
+    {
+        json.beginObject()
+            .field("racer", lap.racerId)
+            .field("name", settings.name(lap.racerId))
+            .field("lapTime", lap.lapTime)
+            .field("timestamp", lap.timestamp)
+            .field("reads", lap.reads)
+            .field("seq", lap.seq)
+            .endObject();
     }
 
-    void loadRacerNamesFromEEPROM()
+    // Send as much of the pending entry tail as fits. Returns true once
+    // nothing is left over.
+    static bool flushPending(ResultsCursor &cursor, char *out, size_t maxLen, size_t &used)
     {
-        EEPROM.begin(512);
-        int addr = 0;
+        size_t length = cursor.pendingLength - cursor.pendingSent;
+        if (length > maxLen - used)
+            length = maxLen - used;
+        memcpy(out + used, cursor.pending + cursor.pendingSent, length);
+        used += length;
+        cursor.pendingSent += length;
+        if (cursor.pendingSent < cursor.pendingLength)
+            return false;
+        cursor.pendingLength = 0;
+        cursor.pendingSent = 0;
+        return true;
+    }
 
-        for (int i = 0; i < 8; i++)
+    // Append one formatted entry to a /results chunk. An entry that does
+    // not fit is split: what fits goes out now and the rest is kept in the
+    // cursor, so even a window smaller than one entry makes progress.
+    // Returns false once the chunk is full.
+    static bool appendItem(ResultsCursor &cursor, JsonText<RESULT_ITEM_SIZE> &item, uint32_t seq,
+                           char *out, size_t maxLen, size_t &used)
+    {
+        const char *text = item.c_str();
+        if (!text)
+        {
+            cursor.since = seq; // Cannot happen with bounded names; skip it
+            return true;
+        }
+        bool comma = !cursor.first;
+        cursor.since = seq;
+        cursor.first = false;
+        if (used + comma + item.length() <= maxLen)
         {
-            int len = EEPROM.read(addr++);
-            if (len > 0 && len < 30)
-            { // Valid length
-                String name = "";
-                for (int j = 0; j < len; j++)
+            if (comma)
+                out[used++] = ',';
+            memcpy(out + used, text, item.length());
+            used += item.length();
+            return used < maxLen;
+        }
+
+        if (comma)
+            cursor.pending[0] = ',';
+        memcpy(cursor.pending + comma, text, item.length());
+        cursor.pendingLength = comma + item.length();
+        flushPending(cursor, out, maxLen, used);
+        return false;
+    }
+
+    // Next chunk of a /results response. Entries are re-read under the lock
+    // on every call, resuming after the last seq sent, so a long lap list is
+    // never held in memory at once. Only entries up to X-Seq go out, and a
+    // new race mid-response just closes the array.
+    size_t fillResults(ResultsCursor &cursor, char *out, size_t maxLen)
+    {
+        size_t used = 0;
+        if (cursor.stage == ResultsCursor::DONE || maxLen == 0)
+            return 0;
+        if (cursor.stage == ResultsCursor::OPEN)
+        {
+            out[used++] = '[';
+            cursor.stage = ResultsCursor::ITEMS;
+        }
+
+        // The rest of an entry split across chunks goes out first
+        bool full = (cursor.pendingLength && !flushPending(cursor, out, maxLen, used)) || used == maxLen;
+        if (!full)
+        {
+            StateLock lock(stateMutex);
+            if (race.raceNumber() == cursor.raceNumber)
+            {
+                if (race.getMode() == Mode::RACE)
                 {
-                    name += (char)EEPROM.read(addr++);
+                    // Race mode - show positions
+                    for (uint8_t i = 0; i < race.finishers() && !full; i++)
+                    {
+                        const RaceState::Result &result = race.result(i);
+                        if (result.seq <= cursor.since || result.seq > cursor.until)
+                            continue;
+                        JsonText<RESULT_ITEM_SIZE> item;
+                        writeResult(item.json(), result);
+                        full = !appendItem(cursor, item, result.seq, out, maxLen, used);
+                    }
+                }
+                else
+                {
+                    // Lap timer mode - laps still held
+                    race.forEachLapSince(cursor.since, [&](const RaceState::Lap &lap)
+                                         {
+                        if (full || lap.seq > cursor.until)
+                            return;
+                        JsonText<RESULT_ITEM_SIZE> item;
+                        writeLap(item.json(), lap);
+                        full = !appendItem(cursor, item, lap.seq, out, maxLen, used); });
                 }
-                racerNames[i] = name;
             }
-            else
+        }
+
+        if (!full)
+        {
+            out[used++] = ']';
+            cursor.stage = ResultsCursor::DONE;
+        }
+        return used;
+    }
+
+    void sendModeEvent()
+    {
+        events.send("mode", [this](JsonStream &json) {
+            json.beginObject()
+                .field("mode", race.getMode() == Mode::RACE ? "race" : "lap")
+                .endObject();
+        });
+    }
+
+    void sendRaceEvent(const char *event)
+    {
+        events.send(event, [this](JsonStream &json) {
+            json.beginObject().field("race", race.raceNumber()).endObject();
+        });
+    }
+
+    // Buffer a small JSON response under the state lock. jsonBuffer is
+    // shared: handlers run one at a time on the web task.
+    template <typename Fn>
+    void sendJson(AsyncWebServerRequest *request, Fn write)
+    {
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        {
+            StateLock lock(stateMutex);
+            JsonStream json(jsonBuffer, sizeof(jsonBuffer), streamChunk, response);
+            write(json);
+            json.flush();
+        }
+        request->send(response);
+    }
+
+    static uint64_t orZero(uint64_t time) { return time == RaceState::NO_TIME ? 0 : time; }
+
+    static void streamChunk(void *context, const char *data, size_t length)
+    {
+        static_cast<AsyncResponseStream *>(context)->write(reinterpret_cast<const uint8_t *>(data), length);
+    }
+
+    // Everything /metrics reports, for either writer. Read without the
+    // state lock: each value has a single writer and is taken as it stands.
+    // The network status is the loop's, so the caller passes networkStatus
+    // as copied under the lock.
+    // The decoder counters restart with each race.
+    template <typename Metrics>
+    void writeMetrics(Metrics &m, const Network::Status &net)
+    {
+        const IRRacerDetector::Decoder &decoder = detector.packetDecoder();
+        m.counter("decode_attempts", "Packets started (sync or compact marker seen)", decoder.attempts());
+        m.counter("decode_packets", "Packets decoded", decoder.packetsDecoded());
+        m.counter("decode_failures", "Packets abandoned, by reason", decoder.badBits(), "reason", "bad_bit");
+        m.counter("decode_failures", "", decoder.timeouts(), "reason", "timeout");
+        m.counter("decode_failures", "", decoder.checkRejects(), "reason", "check");
+        m.counter("decode_failures", "", decoder.resyncs(), "reason", "resync");
+        m.counter("noise_passes", "Passes rejected for too few reads", detector.passAggregator().rejected());
+        m.histogram("decode", "Decoding the pulses captured since the previous pass", decodeTime);
+
+        IRCapture &edges = detector.edges();
+        m.gauge("queue_depth", "Items queued now", edges.ring().size(), "queue", "pulses");
+        m.gauge("queue_depth", "", detections.size(), "queue", "detections");
+        m.gauge("queue_depth", "", commands.size(), "queue", "commands");
+        m.gauge("queue_high_water", "Most items ever queued", edges.highWaterMark(), "queue", "pulses");
+        m.gauge("queue_high_water", "", detections.highWaterMark(), "queue", "detections");
+        m.gauge("queue_high_water", "", commands.highWaterMark(), "queue", "commands");
+        m.counter("queue_drops", "Items dropped on a full queue", edges.overflowCount(), "queue", "pulses");
+        m.counter("queue_drops", "", detections.droppedCount(), "queue", "detections");
+        m.counter("queue_drops", "", commands.droppedCount(), "queue", "commands");
+
+        m.gauge("event_clients", "Browsers subscribed to /events", events.clientCount());
+        m.counter("event_oversized", "Events not sent: too large for the event buffer", events.oversizedEvents());
+
+        m.histogram("loop", "One pass of the main loop (update())", loopTime);
+        m.histogram("loop_gap", "Start to start of main loop passes", loopGap);
+        m.histogram("http", "HTTP route handlers", httpTime);
+        m.histogram("led_frame", "Encoding an LED frame and starting its transfer", leds.frameTime());
+
+        static const char *const GATES[] = {"0", "1", "2", "3"};
+        static_assert(sizeof(GATES) / sizeof(GATES[0]) == Network::MAX_GATES, "A label per gate");
+        m.counter("network_bad_messages", "Timing network datagrams that were not ours", net.badMessages);
+        if (net.gate != 0)
+        {
+            m.gauge("network_clock_delay_us", "Round trip of the last clock exchange", net.delayUs);
+            m.counter("network_clock_exchanges", "Clock exchanges with the master", net.exchanges);
+            m.counter("network_crossings_resent", "Crossings sent again for want of an ack", net.resends);
+            m.counter("network_outbox_drops", "Crossings dropped on a full outbox", net.outboxDrops);
+        }
+        else
+        {
+            for (uint8_t gate = 1; gate < Network::MAX_GATES; gate++)
             {
-                addr += 30; // Skip invalid data
+                m.counter("network_split_crossings", gate == 1 ? "Crossings received, by split" : "",
+                          net.gates[gate].crossings, "gate", GATES[gate]);
             }
         }
 
-        Serial.println("Racer names loaded from EEPROM");
+        m.gauge("heap_free_bytes", "Free heap", ESP.getFreeHeap());
+        m.gauge("heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+        m.gauge("heap_max_alloc_bytes", "Largest block that can be allocated", ESP.getMaxAllocHeap());
+        m.gauge("uptime_seconds", "Seconds since boot", millis() / 1000);
+    }
+
+    // (Re)start the timing network as the settings say
+    void startNetwork()
+    {
+        uint8_t gate = settings.gateId();
+        bool enable = gate != 0 || settings.gateCount() > 1;
+        if (enable && !transport.begin(Network::PORT))
+            enable = false;
+        network.begin(gate, enable, esp_random());
+        splitGate = enable && gate != 0;
+        {
+            StateLock lock(stateMutex);
+            sectors.begin(settings.gateCount());
+            networkStatus = network.status();
+        }
+        if (raceActive && !splitGate)
+            network.setRace(true, race.raceNumber()); // Resumed before the network started
+        if (enable)
+            Serial.printf("Timing network: gate %u of %u (%s), UDP port %u\n", gate, settings.gateCount(),
+                          gate == 0 ? "master" : "split", Network::PORT);
+    }
+
+    // A split gate races when the master says so
+    void followMaster()
+    {
+        if (network.racing() == raceActive)
+            return;
+        if (network.racing())
+        {
+            detectorResetPending = true;
+            raceStartTime = esp_timer_get_time();
+            raceActive = true;
+            leds.setStatus(LEDRing::Status::DETECTING);
+            Serial.printf("🏁 RACE %u STARTED on the master\n", network.raceNumber());
+        }
+        else
+        {
+            raceActive = false;
+            leds.setStatus(LEDRing::Status::IDLE);
+            if (network.status().masterFound)
+                Serial.printf("🏁 RACE %u STOPPED on the master\n", network.raceNumber());
+            else
+                Serial.printf("🏁 RACE %u STOPPED: master lost\n", network.raceNumber());
+        }
+    }
+
+    // A crossing of one gate into the sector times (master, race relative)
+    void addSectorCrossing(uint8_t racerId, uint8_t gate, uint64_t timestamp)
+    {
+        uint8_t completed;
+        {
+            StateLock lock(stateMutex);
+            completed = sectors.add(racerId, gate, timestamp);
+        }
+        for (uint8_t sector = 0; completed; sector++, completed >>= 1)
+        {
+            if (!(completed & 1))
+                continue;
+            events.send("sector", [&](JsonStream &json) {
+                json.beginObject()
+                    .field("racer", racerId)
+                    .field("name", settings.name(racerId))
+                    .field("sector", sector)
+                    .field("time", sectors.lastSector(racerId, sector))
+                    .field("best", sectors.bestSector(racerId, sector))
+                    .endObject();
+            });
+        }
+    }
+
+    // Master: crossings the splits sent, on this clock already
+    void applySplitCrossings()
+    {
+        Network::Crossing crossing;
+        while (network.poll(crossing))
+        {
+            if (!raceActive || crossing.time < raceStartTime)
+                continue; // From before the start, or a race since stopped
+            addSectorCrossing(crossing.racerId, crossing.gate, crossing.time - raceStartTime);
+        }
+    }
+
+    // Race logic for one crossing. Returns false if it was ignored.
+    bool applyDetection(const DetectionEvent &event)
+    {
+        if (!raceActive || event.timestamp < raceStartTime)
+            return false; // Captured before the start signal
+
+        uint8_t racerId = event.racerId;
+        if (splitGate)
+        {
+            // The master times it
+            network.report(racerId, event.timestamp, event.reads);
+            leds.pulseRacer(racerId);
+            return true;
+        }
+
+        uint64_t timestamp = event.timestamp - raceStartTime;
+        RaceState::Update update;
+        {
+            StateLock lock(stateMutex);
+            update = race.record(racerId, timestamp, event.reads);
+        }
+
+        switch (update.outcome)
+        {
+        case RaceState::Outcome::FINISHED:
+            Serial.printf("🏁 %s FINISHED! Position: %d, Time: %llu us\n",
+                          settings.name(racerId), update.position, timestamp);
+            logger.logResult(race.raceNumber(), race.result(update.position - 1));
+            announcer.lap(racerId, timestamp);
+            events.send("crossing", [&](JsonStream &json) {
+                writeResult(json, race.result(update.position - 1));
+            });
+            break;
+
+        case RaceState::Outcome::LAP:
+        case RaceState::Outcome::LAP_OVERWROTE:
+        case RaceState::Outcome::LAP_REJECTED:
+            logger.logLap(race.raceNumber(), racerId, timestamp, event.reads);
+            announcer.lap(racerId, update.lapTime);
+            if (update.fastestLap)
+                Serial.printf("⚡ NEW FASTEST LAP! %s - %llu us\n",
+                              settings.name(racerId), update.lapTime);
+            if (update.personalBest)
+                Serial.printf("🏆 %s PERSONAL BEST! %llu us\n",
+                              settings.name(racerId), update.lapTime);
+            Serial.printf("⏱️ %s LAP! Lap: %llu us, Total: %llu us\n",
+                          settings.name(racerId), update.lapTime, timestamp);
+            if (update.outcome == RaceState::Outcome::LAP_REJECTED)
+                Serial.printf("Lap store full (%u per racer), lap not kept\n", race.lapCapacity());
+            else
+                events.send("crossing", [&](JsonStream &json) {
+                    writeLap(json, race.lap(racerId, race.lapCount(racerId) - 1));
+                });
+            break;
+
+        default:
+            return false; // Already finished, or no lap storage
+        }
+
+        journal.crossing(racerId, timestamp, event.reads);
+        if (network.active())
+            addSectorCrossing(racerId, 0, timestamp);
+        leds.pulseRacer(racerId); // Trigger pulse animation
+        return true;
     }
 
 public:
     RaceTimerSystem(uint8_t irPin, uint8_t ledPin,
                     uint8_t i2sBck, uint8_t i2sWs, uint8_t i2sData)
-        : detector(irPin), leds(ledPin), audio(i2sBck, i2sWs, i2sData), server(80)
+        : detector(irPin), leds(ledPin), audio(i2sBck, i2sWs, i2sData), announcer(audio), server(80),
+          network(transport)
     {
-
-        // Create queue for detection events (max 10 events)
-        detectionQueue = xQueueCreate(10, sizeof(DetectionEvent));
     }
 
     void begin(const char *apSSID, const char *apPassword,
@@ -307,6 +1352,9 @@ public:
         Serial.begin(115200);
         Serial.println("Race Timer System Starting...");
 
+        stateMutex = xSemaphoreCreateMutex();
+        leds.begin(); // First, so the errors below show on the ring
+
         // Initialize SPIFFS
         if (!SPIFFS.begin(true))
         {
@@ -327,12 +1375,20 @@ public:
         }
 
         // Initialize components
+        if (!race.begin())
+        {
+            Serial.println("Race state allocation failed!");
+            leds.setStatus(LEDRing::Status::ERROR);
+            return;
+        }
         detector.begin();
-        leds.begin();
         leds.setStatus(LEDRing::Status::IDLE);
+        audio.begin(SD); // WAV files come from the SD card
 
-        // Load racer names from EEPROM
-        loadRacerNamesFromEEPROM();
+        // Names, mode and tuning from NVS
+        settingsStore.begin(settings);
+        race.setMode(settings.mode());
+        applyTuning();
 
         // Initialize SD card
         if (!SD.begin())
@@ -340,6 +1396,16 @@ public:
             Serial.println("SD Card init failed!");
             leds.setStatus(LEDRing::Status::ERROR);
         }
+        else
+        {
+            logger.begin(SD, "/races.bin");
+            JournalStore::Resume resume = journal.begin(SD, "/journal.bin", race);
+            if (settings.gateId() == 0) // A split gate races when the master does
+                resumeSession(resume);
+            announcer.begin(SD);
+        }
+        // The journal is newer if the power went before a mode change was saved
+        settings.setMode(race.getMode(), millis());
 
         // Setup WiFi in AP+STA mode
         WiFi.mode(WIFI_AP_STA);
@@ -378,6 +1444,7 @@ public:
             Serial.println("mDNS responder started: http://racetimer.local");
         }
 
+        startNetwork();
         setupWebServer();
 
         // Start detection task on Core 1 (dedicated timing core)
@@ -406,125 +1473,144 @@ public:
         audio.playTone(1000, 100);
     }
 
+    // After a reset mid-race: carry on with the replayed state. The race
+    // clock continues from the last journaled time; the outage itself is
+    // not counted.
+    void resumeSession(const JournalStore::Resume &resume)
+    {
+        if (resume.discardedBytes)
+            Serial.printf("Journal: torn tail, %u bytes discarded\n", resume.discardedBytes);
+        if (!resume.active)
+            return;
+
+        detectorResetPending = true;
+        raceStartTime = esp_timer_get_time() - resume.elapsedUs;
+        raceActive = true;
+        leds.setStatus(LEDRing::Status::DETECTING);
+        Serial.printf("🏁 RACE %u RESUMED at %llu us (%u entries, %u ms)\n", race.raceNumber(),
+                      resume.elapsedUs, resume.entries, resume.replayMs);
+    }
+
     void startRace()
     {
+        if (calibration.state == CalibrationStatus::RUNNING)
+        {
+            calibrationCancel = true;
+            StateLock lock(stateMutex);
+            calibration.state = CalibrationStatus::FAILED;
+        }
+        detectorResetPending = true; // Discard noise captured while idle
+        raceStartTime = esp_timer_get_time();
         raceActive = true;
-        raceStartTime = millis();
-        results.clear();
-        laps.clear();
-        fastestLap = 0xFFFFFFFF;
-        // Reset debounce timers but keep personal bests
-        for (int i = 0; i < 8; i++)
         {
-            lastDetectionTime[i] = 0;
+            StateLock lock(stateMutex);
+            race.reset(); // Personal bests are kept across races
+            sectors.clear();
         }
+        network.setRace(true, race.raceNumber());
+        sendRaceEvent("start");
+        logger.logStart(race.raceNumber(), race.getMode());
+        journal.started(race);
+        announcer.clear();
         leds.setStatus(LEDRing::Status::DETECTING);
-        audio.playTone(1000, 100); // Shortened tone
+        audio.playTone(1000, 100);
         Serial.println("🏁 RACE STARTED!");
     }
 
     void stopRace()
     {
         raceActive = false;
+        network.setRace(false, race.raceNumber());
+        sendRaceEvent("stop");
+        logger.logStop(race.raceNumber(), esp_timer_get_time() - raceStartTime);
+        journal.stopped(esp_timer_get_time() - raceStartTime);
         leds.setStatus(LEDRing::Status::IDLE);
         audio.playTone(500, 200);
         Serial.println("🏁 RACE STOPPED!");
+        Serial.printf("Decoder: %u packets (%u v1), %u failed check\n",
+                      detector.packetDecoder().packetsDecoded(),
+                      detector.packetDecoder().v1Packets(),
+                      detector.packetDecoder().checkRejects());
+        Serial.printf("Pipeline: %u/%u events dropped/peak, %u/%u pulses dropped/peak\n",
+                      detections.droppedCount(), detections.highWaterMark(),
+                      detector.edges().overflowCount(), detector.edges().highWaterMark());
+        if (race.lapsOverwritten() || race.lapsRejected())
+            Serial.printf("Lap store: %u overwritten, %u rejected (%u laps per racer)\n",
+                          race.lapsOverwritten(), race.lapsRejected(), race.lapCapacity());
+        if (journal.dropped())
+            Serial.printf("Journal: %u entries dropped\n", journal.dropped());
+        if (events.oversizedEvents())
+            Serial.printf("Event stream: %u events too large to send\n", events.oversizedEvents());
+        if (logger.enabled())
+            Serial.printf("Race log: %u blocks written, %u records dropped, %u errors, slowest write %u us\n",
+                          logger.blocksWritten(), logger.recordsDropped(), logger.errors(), logger.slowestWrite());
+        if (audio.droppedCues() || audio.stolenVoices() || audio.underrunSamples())
+            Serial.printf("Audio: %u cues dropped, %u voices stolen, %u stream underrun samples\n",
+                          audio.droppedCues(), audio.stolenVoices(), audio.underrunSamples());
+        if (announcer.enabled())
+            Serial.printf("Announcer: %u read out, %u coalesced, %u expired, %u dropped, clip cache %u/%u hits/misses, slowest assembly %u us\n",
+                          announcer.announcements(), announcer.coalesced(), announcer.expired(), announcer.dropped(),
+                          announcer.cacheHits(), announcer.cacheMisses(), announcer.slowestAssembly());
     }
 
     void update()
     {
+        uint64_t now = esp_timer_get_time();
+        if (lastUpdateUs)
+        {
+            uint32_t gap = now - lastUpdateUs;
+            if (gap > loopMaxGapUs)
+                loopMaxGapUs = gap;
+            loopGap.record(gap);
+        }
+        lastUpdateUs = now;
+
         // PRIORITY 1: Update LED animations (non-blocking)
         leds.update();
 
-        // PRIORITY 2: Handle web requests (non-blocking)
-        server.handleClient();
-
-        // PRIORITY 3: IR Detection (critical timing - always active)
-        if (!raceActive)
-            return;
-
-        int racerId = detector.decode();
-
-        if (racerId >= 0 && racerId <= 7)
+        // PRIORITY 2: Apply requests from the web task (served on its own)
+        Command command;
+        while (commands.pop(command))
+            applyCommand(command);
+        if (network.active())
         {
-            unsigned long now = millis();
-            unsigned long timestamp = now - raceStartTime;
-
-            // Non-blocking debounce check
-            if (now - lastDetectionTime[racerId] < DEBOUNCE_MS)
+            bool arrived = network.update();
+            if (splitGate)
+                followMaster(); // Also stops the race when the master is lost
+            else if (arrived)
+                applySplitCrossings();
+            if (arrived || millis() - networkStatusMs >= NETWORK_STATUS_MS)
             {
-                return; // Too soon, ignore
-            }
-
-            lastDetectionTime[racerId] = now;
-
-            if (currentMode == Mode::RACE)
-            {
-                // Race mode - only count first crossing
-                for (const auto &result : results)
-                {
-                    if (result.racerId == racerId)
-                        return; // Already finished
-                }
-
-                RaceResult result = {
-                    static_cast<uint8_t>(racerId),
-                    timestamp,
-                    static_cast<uint8_t>(results.size() + 1)};
-
-                results.push_back(result);
-
-                Serial.printf("🏁 %s FINISHED! Position: %d, Time: %lu ms\n",
-                              racerNames[racerId].c_str(), result.position, timestamp);
-
-                logToSD(result);
+                networkStatusMs = millis();
+                StateLock lock(stateMutex);
+                networkStatus = network.status();
             }
-            else
-            {
-                // Lap timer mode - record every crossing
-                unsigned long lapTime = timestamp;
-
-                // Calculate lap time (time since last crossing)
-                for (int i = laps.size() - 1; i >= 0; i--)
-                {
-                    if (laps[i].racerId == racerId)
-                    {
-                        lapTime = timestamp - laps[i].timestamp;
-                        break;
-                    }
-                }
-
-                // Track fastest lap
-                if (lapTime < fastestLap && lapTime > 1000)
-                { // Ignore < 1sec (likely errors)
-                    fastestLap = lapTime;
-                    fastestLapRacer = racerId;
-                    Serial.printf("⚡ NEW FASTEST LAP! %s - %lu ms\n",
-                                  racerNames[racerId].c_str(), lapTime);
-                }
-
-                // Track personal best
-                if (lapTime < personalBest[racerId] && lapTime > 1000)
-                {
-                    personalBest[racerId] = lapTime;
-                    Serial.printf("🏆 %s PERSONAL BEST! %lu ms\n",
-                                  racerNames[racerId].c_str(), lapTime);
-                }
-
-                LapTime lap = {
-                    static_cast<uint8_t>(racerId),
-                    lapTime,
-                    timestamp};
-
-                laps.push_back(lap);
+        }
+        logger.update();
+        if (raceActive && !splitGate)
+            journal.update(esp_timer_get_time() - raceStartTime);
+        updateCalibration();
+        settingsStore.update(settings, raceActive);
+
+        // PRIORITY 3: Apply crossings from the detection task, a bounded
+        // batch per call so web and LEDs stay responsive
+        DetectionEvent batch[DETECTION_BATCH];
+        size_t count = 0;
+        while (count < DETECTION_BATCH && detections.pop(batch[count]))
+            count++;
+
+        int lastRacer = -1;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (applyDetection(batch[i]))
+                lastRacer = batch[i].racerId;
+        }
 
-                Serial.printf("⏱️ %s LAP! Lap: %lu ms, Total: %lu ms\n",
-                              racerNames[racerId].c_str(), lapTime, timestamp);
-            }
+        // One tone per batch: crossings in the same batch would start their
+        // tones together anyway
+        if (lastRacer >= 0)
+            audio.playTone(800 + (lastRacer * 100), 100);
 
-            // Visual/audio feedback (non-blocking)
-            leds.pulseRacer(racerId);                   // Trigger pulse animation
-            audio.playTone(800 + (racerId * 100), 100); // Quick tone
-        }
+        loopTime.record(esp_timer_get_time() - now);
     }
 };
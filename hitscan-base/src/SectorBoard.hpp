@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// Sector Board
+// ============================================================================
+// Sector times from the crossings of every gate in a timing network. Gate 0
+// is start/finish and the others are splits in track order, so sector s
+// runs from gate s to gate s + 1 (the last one back to gate 0), and a lap
+// is the sum of its sectors.
+//
+// Split crossings come over the network and can arrive late or out of
+// order (retries), so each racer keeps its last HISTORY crossings sorted by
+// time and a sector is two neighbours from consecutive gates. A crossing
+// that lands between two others completes the sectors on both sides; a
+// missed gate just leaves a gap. The last time of a sector is the one that
+// ended latest, whatever order they arrived in.
+//
+// Times are µs on the master's clock. Hardware independent.
+class SectorBoard
+{
+public:
+    static constexpr uint8_t MAX_GATES = 4;
+    static constexpr uint8_t MAX_RACERS = 8;
+    static constexpr uint8_t HISTORY = 8;
+    static constexpr uint64_t NO_TIME = UINT64_MAX;
+    static constexpr uint64_t MAX_SECTOR_US = 600000000; // 10 minutes
+
+private:
+    struct Crossing
+    {
+        uint64_t time;
+        uint8_t gate;
+    };
+
+    struct Racer
+    {
+        Crossing history[HISTORY]; // Oldest first
+        uint8_t count;
+        uint64_t last[MAX_GATES];
+        uint64_t lastEnd[MAX_GATES]; // When the last one ended
+        uint64_t best[MAX_GATES];
+    };
+
+    uint8_t gates = 1;
+    Racer racers[MAX_RACERS];
+    uint32_t lateCount = 0;
+
+    // Record the sector between two neighbouring crossings, if it is one
+    uint8_t link(Racer &racer, const Crossing &from, const Crossing &to)
+    {
+        uint8_t sector = from.gate;
+        if ((from.gate + 1) % gates != to.gate || to.time - from.time > MAX_SECTOR_US)
+            return 0;
+        uint64_t time = to.time - from.time;
+        if (racer.lastEnd[sector] == NO_TIME || to.time > racer.lastEnd[sector])
+        {
+            racer.last[sector] = time;
+            racer.lastEnd[sector] = to.time;
+        }
+        if (time < racer.best[sector])
+            racer.best[sector] = time;
+        return 1 << sector;
+    }
+
+public:
+    SectorBoard() { reset(); }
+
+    // gates: how many in the network (1 = no splits, no sectors)
+    void begin(uint8_t gateCount)
+    {
+        gates = gateCount < 1 ? 1 : gateCount > MAX_GATES ? MAX_GATES : gateCount;
+        reset();
+    }
+
+    // New race: forget crossings and last times, keep the bests
+    void clear()
+    {
+        for (Racer &racer : racers)
+        {
+            racer.count = 0;
+            for (uint8_t s = 0; s < MAX_GATES; s++)
+            {
+                racer.last[s] = NO_TIME;
+                racer.lastEnd[s] = NO_TIME;
+            }
+        }
+    }
+
+    void reset()
+    {
+        clear();
+        for (Racer &racer : racers)
+        {
+            for (uint64_t &best : racer.best)
+                best = NO_TIME;
+        }
+        lateCount = 0;
+    }
+
+    // A crossing of gate at time. Returns a bit per sector it completed.
+    uint8_t add(uint8_t racerId, uint8_t gate, uint64_t time)
+    {
+        if (racerId >= MAX_RACERS || gate >= gates || gates < 2)
+            return 0;
+        Racer &racer = racers[racerId];
+
+        // Insertion point; older than everything kept only fits while
+        // there is room
+        uint8_t at = racer.count;
+        while (at > 0 && racer.history[at - 1].time > time)
+            at--;
+        if (racer.count == HISTORY)
+        {
+            if (at == 0)
+            {
+                lateCount++;
+                return 0;
+            }
+            memmove(&racer.history[0], &racer.history[1], (at - 1) * sizeof(Crossing));
+            at--;
+        }
+        else
+        {
+            memmove(&racer.history[at + 1], &racer.history[at], (racer.count - at) * sizeof(Crossing));
+            racer.count++;
+        }
+        racer.history[at] = {time, gate};
+
+        uint8_t completed = 0;
+        if (at > 0)
+            completed |= link(racer, racer.history[at - 1], racer.history[at]);
+        if (at + 1 < racer.count)
+            completed |= link(racer, racer.history[at], racer.history[at + 1]);
+        return completed;
+    }
+
+    uint8_t gateCount() const { return gates; }
+    uint8_t sectorCount() const { return gates < 2 ? 0 : gates; }
+
+    uint64_t lastSector(uint8_t racerId, uint8_t sector) const
+    {
+        return racerId < MAX_RACERS && sector < MAX_GATES ? racers[racerId].last[sector] : NO_TIME;
+    }
+
+    uint64_t bestSector(uint8_t racerId, uint8_t sector) const
+    {
+        return racerId < MAX_RACERS && sector < MAX_GATES ? racers[racerId].best[sector] : NO_TIME;
+    }
+
+    // Sum of the racer's best sectors: the lap they could do
+    uint64_t optimalLap(uint8_t racerId) const
+    {
+        if (racerId >= MAX_RACERS || gates < 2)
+            return NO_TIME;
+        uint64_t total = 0;
+        for (uint8_t s = 0; s < gates; s++)
+        {
+            if (racers[racerId].best[s] == NO_TIME)
+                return NO_TIME;
+            total += racers[racerId].best[s];
+        }
+        return total;
+    }
+
+    uint32_t tooLate() const { return lateCount; } // Older than the history kept
+};
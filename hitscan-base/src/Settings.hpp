@@ -0,0 +1,293 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "Crc32.hpp"
+#include "IRTiming.hpp"
+#include "RaceState.hpp"
+#include "SectorBoard.hpp"
+
+// ============================================================================
+// Settings
+// ============================================================================
+// Everything the base station keeps across power cycles, as one blob with
+// a schema version and a CRC-32: racer names, mode, the tunables
+// (decoder, pass and lap debounce, LED and audio levels), the decoder
+// timing windows learned by IRCalibrator and this gate's place in a timing
+// network.
+//
+// Changes only touch RAM. They mark the settings dirty, and the owner
+// writes them out once nothing has changed for COMMIT_DELAY_MS, so a burst
+// of edits costs a single flash write. Hardware independent; SettingsStore
+// keeps the blob in NVS.
+class Settings
+{
+public:
+    static constexpr uint32_t MAGIC = 0x54455348; // "HSET"
+    static constexpr uint16_t VERSION = 3;
+    static constexpr uint8_t MAX_RACERS = RaceState::MAX_RACERS;
+    static constexpr size_t MAX_NAME_LENGTH = 30;
+    static constexpr uint32_t COMMIT_DELAY_MS = 2000;
+
+    struct Tuning
+    {
+        uint8_t acceptV1 = 1;     // Decoder: also accept v1 packets (no check bit)
+        uint8_t minReads = 1;     // Packets needed for a crossing
+        uint16_t passGapMs = 100; // Silence that ends a pass
+        uint16_t maxPassMs = 500; // Longest pass
+        uint16_t minLapMs = 1000; // Shorter laps don't count for bests
+        uint8_t brightness = 50;  // LED ring
+        uint8_t volume = 80;      // Tones
+    };
+
+    // Stored size of each schema version
+    static constexpr uint16_t SIZE_V1 = 272;
+    static constexpr uint16_t SIZE_V2 = 308;
+    static constexpr uint16_t SIZE_V3 = 308;
+
+    // Stored layout. Only ever append fields (and bump VERSION): a blob
+    // from an older version is shorter, and the fields it lacks keep their
+    // defaults. No implicit padding: it is stored and checksummed like
+    // the fields, so spare bytes are spelled out as reserved.
+    //
+    // Version 3 took the two bytes of version 2's tail padding, so both
+    // store 308 bytes; decode() resets the version 3 fields of an older
+    // blob rather than going by its size.
+    struct Data
+    {
+        uint32_t magic = MAGIC;
+        uint16_t version = VERSION;
+        uint16_t size = sizeof(Data);
+        uint32_t crc = 0; // Over the bytes after it, up to size
+        uint8_t mode = 0; // RaceState::Mode
+        char names[MAX_RACERS][MAX_NAME_LENGTH + 1] = {};
+        uint8_t reserved1 = 0; // Aligns tuning
+        Tuning tuning;
+        // Version 2
+        IRTiming::Windows windows = IRTiming::nominal();
+        uint8_t calibrated = 0; // windows came from IRCalibrator
+        // Version 3
+        uint8_t gateId = 0;    // 0 = start/finish (master), else split in track order
+        uint8_t gateCount = 1; // Gates in the network; 1 = standalone
+        uint8_t reserved3 = 0; // Rest of version 2's tail padding
+    };
+
+    // The fields Data starts with
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint32_t crc;
+    };
+
+    enum class LoadResult : uint8_t
+    {
+        LOADED,
+        MIGRATED, // Other schema version: loaded, should be rewritten
+        EMPTY,    // Nothing stored: defaults
+        CORRUPT   // Failed a check: defaults
+    };
+
+private:
+    static constexpr size_t HEADER_SIZE = sizeof(Header);
+    static_assert(offsetof(Data, mode) == HEADER_SIZE, "Data must start with a Header");
+    static_assert(offsetof(Data, tuning) == offsetof(Data, reserved1) + 1, "No padding before tuning");
+    static_assert(offsetof(Data, windows) == SIZE_V1, "Version 1 ends with tuning");
+    static_assert(offsetof(Data, gateId) == offsetof(Data, calibrated) + 1 && (offsetof(Data, gateId) + 3) / 4 * 4 == SIZE_V2,
+                  "Version 2 ends with calibrated, padded to 4 bytes");
+    static_assert(sizeof(Data) == SIZE_V3 && offsetof(Data, reserved3) + 1 == SIZE_V3, "Version 3 has no tail padding");
+
+    Data data;
+    bool dirty = false;
+    uint32_t changedMs = 0;
+
+    static uint32_t checksum(const uint8_t *blob, size_t size)
+    {
+        return crc32(blob + HEADER_SIZE, size - HEADER_SIZE);
+    }
+
+    void changed(uint32_t nowMs)
+    {
+        dirty = true;
+        changedMs = nowMs;
+    }
+
+    static void clampGate(uint8_t &gateId, uint8_t &gateCount)
+    {
+        gateCount = gateCount < 1 ? 1 : gateCount > SectorBoard::MAX_GATES ? SectorBoard::MAX_GATES : gateCount;
+        if (gateId >= SectorBoard::MAX_GATES)
+            gateId = 0;
+        if (gateId >= gateCount)
+            gateCount = gateId + 1;
+    }
+
+    static Tuning clamp(Tuning t)
+    {
+        t.acceptV1 = t.acceptV1 ? 1 : 0;
+        t.minReads = t.minReads < 1 ? 1 : t.minReads > 16 ? 16 : t.minReads;
+        t.passGapMs = t.passGapMs < 10 ? 10 : t.passGapMs > 1000 ? 1000 : t.passGapMs;
+        t.maxPassMs = t.maxPassMs < t.passGapMs ? t.passGapMs : t.maxPassMs > 5000 ? 5000 : t.maxPassMs;
+        t.minLapMs = t.minLapMs > 60000 ? 60000 : t.minLapMs;
+        return t;
+    }
+
+public:
+    Settings() { reset(); }
+
+    void reset()
+    {
+        data = Data();
+        for (uint8_t i = 0; i < MAX_RACERS; i++)
+            snprintf(data.names[i], sizeof(data.names[i]), "Racer %u", i);
+    }
+
+    // Take a stored blob. Anything that fails a check leaves the defaults.
+    LoadResult decode(const uint8_t *blob, size_t length)
+    {
+        reset();
+        if (length == 0)
+            return LoadResult::EMPTY;
+
+        Header header;
+        if (length < HEADER_SIZE)
+            return LoadResult::CORRUPT;
+        memcpy(&header, blob, HEADER_SIZE);
+        if (header.magic != MAGIC || header.size <= HEADER_SIZE || header.size > length ||
+            header.crc != checksum(blob, header.size))
+            return LoadResult::CORRUPT;
+
+        // A newer layout only appended fields: keep the ones known here
+        memcpy(&data, blob, header.size < sizeof(Data) ? header.size : sizeof(Data));
+        data.magic = MAGIC;
+        data.version = VERSION;
+        data.size = sizeof(Data);
+
+        for (auto &name : data.names)
+            name[MAX_NAME_LENGTH] = '\0';
+        if (data.mode > (uint8_t)RaceState::Mode::LAP_TIMER)
+            data.mode = 0;
+        data.tuning = clamp(data.tuning);
+        if (!IRTiming::valid(data.windows))
+        {
+            data.windows = IRTiming::nominal();
+            data.calibrated = 0;
+        }
+        if (header.version < 3)
+        {
+            // Stored in what is now gateId/gateCount: padding, not settings
+            Data defaults;
+            data.gateId = defaults.gateId;
+            data.gateCount = defaults.gateCount;
+        }
+        data.reserved1 = 0;
+        data.reserved3 = 0;
+        clampGate(data.gateId, data.gateCount);
+        return header.version == VERSION ? LoadResult::LOADED : LoadResult::MIGRATED;
+    }
+
+    // The blob to store (sizeof(Data) bytes)
+    const uint8_t *encode()
+    {
+        data.crc = checksum(reinterpret_cast<const uint8_t *>(&data), sizeof(Data));
+        return reinterpret_cast<const uint8_t *>(&data);
+    }
+
+    // Names from the old EEPROM layout: per racer a length byte and up to
+    // 30 characters, packed back to back. Returns how many were taken.
+    uint8_t importLegacyNames(const uint8_t *eeprom, size_t length, uint32_t nowMs)
+    {
+        uint8_t imported = 0;
+        size_t addr = 0;
+        for (uint8_t i = 0; i < MAX_RACERS && addr < length; i++)
+        {
+            uint8_t len = eeprom[addr++];
+            if (len == 0xFF)
+                break; // Erased: nothing was ever saved past here
+
+            // The old loader skipped 30 bytes after a bad length, but the
+            // saver wrote only the characters it had
+            size_t stored = len < MAX_NAME_LENGTH ? len : MAX_NAME_LENGTH;
+            if (addr + stored > length)
+                break;
+            if (len > 0 && len < MAX_NAME_LENGTH)
+            {
+                char name[MAX_NAME_LENGTH + 1];
+                memcpy(name, eeprom + addr, len);
+                name[len] = '\0';
+                setName(i, name, nowMs);
+                imported++;
+            }
+            addr += stored;
+        }
+        return imported;
+    }
+
+    const char *name(uint8_t racerId) const { return racerId < MAX_RACERS ? data.names[racerId] : ""; }
+
+    void setName(uint8_t racerId, const char *name, uint32_t nowMs)
+    {
+        if (racerId >= MAX_RACERS || !strncmp(data.names[racerId], name, MAX_NAME_LENGTH))
+            return;
+        strncpy(data.names[racerId], name, MAX_NAME_LENGTH);
+        data.names[racerId][MAX_NAME_LENGTH] = '\0';
+        changed(nowMs);
+    }
+
+    RaceState::Mode mode() const { return (RaceState::Mode)data.mode; }
+
+    void setMode(RaceState::Mode mode, uint32_t nowMs)
+    {
+        if (data.mode == (uint8_t)mode)
+            return;
+        data.mode = (uint8_t)mode;
+        changed(nowMs);
+    }
+
+    const Tuning &tuning() const { return data.tuning; }
+
+    // Out-of-range values are clamped
+    void setTuning(const Tuning &tuning, uint32_t nowMs)
+    {
+        Tuning t = clamp(tuning);
+        if (!memcmp(&t, &data.tuning, sizeof(Tuning)))
+            return;
+        data.tuning = t;
+        changed(nowMs);
+    }
+
+    const IRTiming::Windows &windows() const { return data.windows; }
+    bool calibrated() const { return data.calibrated; }
+
+    // Decoder timing windows; calibrated = learned rather than nominal.
+    // Windows the decoder could not use are ignored.
+    void setWindows(const IRTiming::Windows &windows, bool calibrated, uint32_t nowMs)
+    {
+        if (!IRTiming::valid(windows))
+            return;
+        data.windows = windows;
+        data.calibrated = calibrated;
+        changed(nowMs);
+    }
+
+    uint8_t gateId() const { return data.gateId; }
+    uint8_t gateCount() const { return data.gateCount; }
+
+    // A split's id is in the count: raising the id raises the count
+    void setGate(uint8_t gateId, uint8_t gateCount, uint32_t nowMs)
+    {
+        clampGate(gateId, gateCount);
+        if (gateId == data.gateId && gateCount == data.gateCount)
+            return;
+        data.gateId = gateId;
+        data.gateCount = gateCount;
+        changed(nowMs);
+    }
+
+    // Write now? True once changes have been quiet for COMMIT_DELAY_MS
+    bool commitDue(uint32_t nowMs) const { return dirty && nowMs - changedMs >= COMMIT_DELAY_MS; }
+    bool pending() const { return dirty; }
+    void committed() { dirty = false; }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Preferences.h>
+#include "Settings.hpp"
+
+// ============================================================================
+// Settings Store (NVS)
+// ============================================================================
+// Keeps the Settings blob under one key in NVS, which spreads writes over
+// its pages instead of erasing the same sector every time the way the
+// EEPROM emulation did. begin() loads it, or on first boot takes the racer
+// names from the old EEPROM layout; after that update() writes the blob
+// from the loop once the changes have settled.
+//
+// No writes while a race runs: writing flash stalls the cache on both
+// cores, which would delay the IR capture interrupt. Changes made during
+// a race are written after it.
+class SettingsStore
+{
+private:
+    static constexpr const char *NAMESPACE = "hitscan";
+    static constexpr const char *KEY = "settings";
+    static constexpr size_t LEGACY_EEPROM_SIZE = 512;
+
+    Preferences prefs;
+    bool ready = false;
+    uint32_t commits = 0;
+    uint32_t failures = 0;
+    uint32_t slowestUs = 0;
+
+    void importLegacy(Settings &settings)
+    {
+        uint8_t eeprom[LEGACY_EEPROM_SIZE];
+        if (!EEPROM.begin(LEGACY_EEPROM_SIZE))
+            return;
+        for (size_t i = 0; i < sizeof(eeprom); i++)
+            eeprom[i] = EEPROM.read(i);
+        EEPROM.end();
+
+        uint8_t imported = settings.importLegacyNames(eeprom, sizeof(eeprom), millis());
+        if (imported)
+            Serial.printf("Settings: %u racer names taken from EEPROM\n", imported);
+    }
+
+public:
+    // Load settings from NVS. A missing, corrupt or older blob is rewritten
+    // right away.
+    Settings::LoadResult begin(Settings &settings)
+    {
+        ready = prefs.begin(NAMESPACE, false);
+        if (!ready)
+        {
+            Serial.println("Settings: NVS unavailable, using defaults");
+            return Settings::LoadResult::EMPTY;
+        }
+
+        size_t length = prefs.getBytesLength(KEY);
+        uint8_t *blob = length ? (uint8_t *)malloc(length) : nullptr;
+        if (blob)
+            length = prefs.getBytes(KEY, blob, length);
+        Settings::LoadResult result = settings.decode(blob, blob ? length : 0);
+        free(blob);
+
+        switch (result)
+        {
+        case Settings::LoadResult::LOADED:
+            Serial.println("Settings loaded");
+            return result;
+        case Settings::LoadResult::MIGRATED:
+            Serial.println("Settings: migrated from an older version");
+            break;
+        case Settings::LoadResult::EMPTY:
+            Serial.println("Settings: none stored, using defaults");
+            importLegacy(settings);
+            break;
+        case Settings::LoadResult::CORRUPT:
+            Serial.println("Settings: stored copy failed its check, using defaults");
+            break;
+        }
+        commit(settings);
+        return result;
+    }
+
+    // Call from the loop: writes the settings once they are due
+    void update(Settings &settings, bool raceActive)
+    {
+        if (!raceActive && settings.commitDue(millis()))
+            commit(settings);
+    }
+
+    bool commit(Settings &settings)
+    {
+        if (!ready)
+            return false;
+
+        uint32_t start = micros();
+        const uint8_t *blob = settings.encode();
+        bool ok = prefs.putBytes(KEY, blob, sizeof(Settings::Data)) == sizeof(Settings::Data);
+        uint32_t took = micros() - start;
+        if (took > slowestUs)
+            slowestUs = took;
+
+        // A failed write is retried after the next change
+        settings.committed();
+        if (!ok)
+        {
+            failures++;
+            Serial.println("Settings: write failed");
+            return false;
+        }
+        commits++;
+        Serial.printf("Settings saved (%u us)\n", took);
+        return true;
+    }
+
+    uint32_t commitCount() const { return commits; }
+    uint32_t failureCount() const { return failures; }
+    uint32_t slowestCommit() const { return slowestUs; }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// ============================================================================
+// Single-Producer / Single-Consumer Ring Buffer
+// ============================================================================
+// Lock-free FIFO with capacity fixed at compile time. Exactly one context
+// (ISR or task) may push and exactly one may pop. Never allocates or blocks,
+// so it is safe to push from an interrupt handler.
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head{0}; // Next slot to write (producer owned)
+    std::atomic<uint32_t> tail{0}; // Next slot to read (consumer owned)
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> highWater{0}; // Deepest fill seen (producer owned)
+
+public:
+    // Producer side. Returns false (and counts a drop) when full.
+    __attribute__((always_inline)) inline bool push(const T &item)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N)
+        {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+            return false;
+        }
+
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+
+        uint32_t depth = h + 1 - tail.load(std::memory_order_relaxed);
+        if (depth > highWater.load(std::memory_order_relaxed))
+            highWater.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    __attribute__((always_inline)) inline bool pop(T &item)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Discards everything currently queued.
+    void clear()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+    uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Most items ever queued at once; close to capacity() means the consumer
+    // is falling behind before anything is actually dropped
+    uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+};
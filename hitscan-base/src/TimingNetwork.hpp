@@ -0,0 +1,500 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "GateClock.hpp"
+#include "SectorBoard.hpp"
+#include "SpscRing.hpp"
+
+// Where a gate is: IPv4 address (as the transport keeps it) and UDP port
+struct GatePeer
+{
+    uint32_t ip;
+    uint16_t port;
+};
+
+// ============================================================================
+// Timing Network
+// ============================================================================
+// Links several base stations into one timing system. Gate 0 is the master
+// (start/finish, race control, results); gates 1-3 are splits in track
+// order. A split keeps a GateClock against the master's clock and sends
+// every crossing with its time already on the master's clock, so the
+// master can put crossings from all gates side by side (SectorBoard).
+//
+// One datagram per message, little endian (ESP32 and x86 alike):
+//
+//   SYNC        split -> master  t1; also the split's clock state
+//   SYNC_REPLY  master -> split  t1 echoed, t2 and t3
+//   RACE        master -> splits race state, sent the moment it changes
+//   CROSSING    split -> master  racer, reads, time; resent until acked
+//   ACK         master -> split  for one CROSSING (by seq)
+//
+// Every message from the master carries the race state, so a split that
+// missed a RACE message catches up with its next exchange. A split finds
+// the master by broadcasting SYNC until one answers, and again if the
+// master goes quiet for MASTER_LOST_US. A split that lost the master stops
+// racing until it hears the race state again.
+//
+// Runs on the loop; nothing here blocks or allocates. The Transport does
+// the I/O and tells the time, so messages are stamped as they go:
+//
+//   bool send(const GatePeer &to, const void *data, size_t length);
+//   bool receive(GatePeer &from, void *data, size_t &length); // length: in capacity, out size
+//   GatePeer broadcast();                                    // to find the master
+//   uint64_t now();                                          // µs
+//
+// UdpTransport is the ESP32 one (WiFi); tools/gate_network_sim runs gates
+// as processes on loopback UDP.
+template <typename Transport>
+class TimingNetwork
+{
+public:
+    static constexpr uint16_t PORT = 4210;
+    static constexpr uint8_t MAX_GATES = SectorBoard::MAX_GATES;
+    static constexpr uint32_t SYNC_FAST_US = 250000; // Exchange interval until synced
+    static constexpr uint32_t SYNC_US = 500000;      // and after
+    static constexpr uint32_t RESEND_US = 100000;    // Unacked crossing
+    static constexpr uint32_t MASTER_LOST_US = 5000000;
+    static constexpr uint32_t MAX_EXCHANGE_US = 500000; // Replies slower than this are ignored
+    static constexpr uint8_t OUTBOX_SIZE = 16;
+
+    // A split crossing as the master gets it
+    struct Crossing
+    {
+        uint64_t time; // Master clock (µs)
+        uint8_t gate;
+        uint8_t racerId;
+        uint8_t reads;
+    };
+
+    // One gate as the master sees it
+    struct GateStatus
+    {
+        bool seen;
+        bool synced;
+        uint64_t lastSeenUs;
+        uint32_t delayUs; // Last exchange
+        int32_t driftPpb;
+        uint32_t crossings;
+        uint32_t duplicates; // Resent crossings that had arrived already
+    };
+
+    struct Status
+    {
+        uint8_t gate;
+        bool enabled;
+        bool racing; // Split: as last heard from the master
+        uint32_t raceNumber;
+        uint32_t badMessages;
+
+        // Split
+        bool masterFound;
+        bool synced;
+        int64_t offsetUs;
+        int32_t driftPpb;
+        uint32_t delayUs;
+        uint32_t exchanges;
+        uint32_t masterRestarts;
+        uint32_t crossingsSent;
+        uint32_t crossingsAcked;
+        uint32_t resends;
+        uint32_t outboxDrops;
+
+        // Master
+        GateStatus gates[MAX_GATES];
+    };
+
+private:
+    static constexpr uint16_t MAGIC = 0x4748; // "HG"
+    static constexpr uint8_t PROTOCOL = 1;
+    static constexpr uint8_t FLAG_RACING = 0x01; // From the master
+    static constexpr uint8_t FLAG_SYNCED = 0x02; // From a split
+    static constexpr uint8_t DEDUP_WINDOW = 32;
+
+    enum Type : uint8_t
+    {
+        SYNC = 1,
+        SYNC_REPLY,
+        RACE,
+        CROSSING,
+        ACK
+    };
+
+    struct Header
+    {
+        uint16_t magic;
+        uint8_t protocol;
+        uint8_t type;
+        uint8_t gate; // Sender
+        uint8_t flags;
+        uint16_t seq;
+        uint32_t session;    // Random per boot, so a restarted split's seqs are new
+        uint32_t raceNumber; // From the master
+    };
+
+    struct SyncMessage
+    {
+        Header header;
+        uint64_t t1;
+        uint32_t delayUs;
+        int32_t driftPpb;
+    };
+
+    struct SyncReply
+    {
+        Header header;
+        uint64_t t1;
+        uint64_t t2;
+        uint64_t t3;
+    };
+
+    struct CrossingMessage
+    {
+        Header header; // seq identifies the crossing
+        uint64_t time;
+        uint8_t racerId;
+        uint8_t reads;
+        uint8_t reserved[6];
+    };
+
+    static_assert(sizeof(Header) == 16 && sizeof(SyncMessage) == 32 && sizeof(SyncReply) == 40 &&
+                      sizeof(CrossingMessage) == 32,
+                  "TimingNetwork messages must not depend on padding");
+
+    struct Pending
+    {
+        bool used;
+        uint16_t seq;
+        uint8_t racerId;
+        uint8_t reads;
+        uint64_t localTime;
+        uint64_t nextSendUs;
+    };
+
+    // Recent crossing seqs from one split
+    struct Dedup
+    {
+        uint32_t session;
+        uint16_t newest;
+        uint32_t seen; // Bit n: newest - n arrived
+    };
+
+    Transport &transport;
+    uint8_t gateId = 0;
+    bool enabled = false;
+    uint32_t session = 0;
+    Status stats;
+
+    // Split
+    GateClock clock;
+    GatePeer master = {};
+    uint64_t lastReplyUs = 0;
+    uint64_t nextSyncUs = 0;
+    uint16_t nextSeq = 0;
+    Pending outbox[OUTBOX_SIZE];
+
+    // Master
+    GatePeer peers[MAX_GATES] = {};
+    Dedup dedup[MAX_GATES];
+    SpscRing<Crossing, 16> arrivals;
+
+    Header header(Type type, uint16_t seq = 0) const
+    {
+        uint8_t flags = 0;
+        if (gateId == 0 && stats.racing)
+            flags |= FLAG_RACING;
+        if (gateId != 0 && clock.synced())
+            flags |= FLAG_SYNCED;
+        return {MAGIC, PROTOCOL, type, gateId, flags, seq, session, gateId == 0 ? stats.raceNumber : 0};
+    }
+
+    // Seen before? Marks it seen.
+    bool duplicate(Dedup &d, const Header &h)
+    {
+        if (d.session != h.session)
+        {
+            d = {h.session, h.seq, 1};
+            return false;
+        }
+        int16_t ahead = (int16_t)(h.seq - d.newest);
+        if (ahead > 0)
+        {
+            d.seen = ahead < DEDUP_WINDOW ? (d.seen << ahead) | 1 : 1;
+            d.newest = h.seq;
+            return false;
+        }
+        if (-ahead >= DEDUP_WINDOW)
+            return true; // Too old to tell; it was resent for long enough
+        uint32_t bit = 1u << -ahead;
+        if (d.seen & bit)
+            return true;
+        d.seen |= bit;
+        return false;
+    }
+
+    // ------------------------------------------------------------------------
+    // Master side
+    // ------------------------------------------------------------------------
+    void onSync(const GatePeer &from, const uint8_t *data, size_t length, uint64_t received)
+    {
+        SyncMessage sync;
+        if (length < sizeof(sync))
+        {
+            stats.badMessages++;
+            return;
+        }
+        memcpy(&sync, data, sizeof(sync));
+        uint8_t gate = sync.header.gate;
+
+        peers[gate] = from;
+        GateStatus &status = stats.gates[gate];
+        status.seen = true;
+        status.synced = sync.header.flags & FLAG_SYNCED;
+        status.lastSeenUs = received;
+        status.delayUs = sync.delayUs;
+        status.driftPpb = sync.driftPpb;
+
+        SyncReply reply = {header(SYNC_REPLY, sync.header.seq), sync.t1, received, 0};
+        reply.t3 = transport.now();
+        transport.send(from, &reply, sizeof(reply));
+    }
+
+    void onCrossing(const GatePeer &from, const uint8_t *data, size_t length)
+    {
+        CrossingMessage message;
+        if (length < sizeof(message))
+        {
+            stats.badMessages++;
+            return;
+        }
+        memcpy(&message, data, sizeof(message));
+        uint8_t gate = message.header.gate;
+
+        // Acked even if it is a repeat: the first ack may have been lost
+        Header ack = header(ACK, message.header.seq);
+        transport.send(from, &ack, sizeof(ack));
+
+        GateStatus &status = stats.gates[gate];
+        if (duplicate(dedup[gate], message.header))
+        {
+            status.duplicates++;
+            return;
+        }
+        status.crossings++;
+        arrivals.push({message.time, gate, message.racerId, message.reads});
+    }
+
+    // ------------------------------------------------------------------------
+    // Split side
+    // ------------------------------------------------------------------------
+    void followMaster(const GatePeer &from, const Header &h)
+    {
+        master = from;
+        stats.masterFound = true;
+        lastReplyUs = transport.now();
+        stats.racing = h.flags & FLAG_RACING;
+        stats.raceNumber = h.raceNumber;
+    }
+
+    void onSyncReply(const GatePeer &from, const uint8_t *data, size_t length, uint64_t received)
+    {
+        SyncReply reply;
+        if (length < sizeof(reply))
+        {
+            stats.badMessages++;
+            return;
+        }
+        memcpy(&reply, data, sizeof(reply));
+        if (reply.t1 > received || received - reply.t1 > MAX_EXCHANGE_US)
+            return; // Stale, or not one of ours
+        followMaster(from, reply.header);
+        clock.add(reply.t1, reply.t2, reply.t3, received);
+    }
+
+    void onAck(const Header &h)
+    {
+        for (Pending &p : outbox)
+        {
+            if (p.used && p.seq == h.seq)
+            {
+                p.used = false;
+                stats.crossingsAcked++;
+            }
+        }
+    }
+
+    void sendSync(uint64_t now)
+    {
+        bool found = stats.masterFound && now - lastReplyUs < MASTER_LOST_US;
+        if (!found)
+        {
+            stats.masterFound = false;
+            stats.racing = false;
+        }
+
+        SyncMessage sync = {header(SYNC), 0, clock.lastDelay(), clock.driftPpb()};
+        sync.t1 = transport.now();
+        transport.send(found ? master : transport.broadcast(), &sync, sizeof(sync));
+        nextSyncUs = now + (clock.synced() ? SYNC_US : SYNC_FAST_US);
+    }
+
+    // Crossings wait for the clock; the time is mapped as they go out, with
+    // the latest fit
+    void sendPending(uint64_t now)
+    {
+        if (!stats.masterFound || !clock.synced())
+            return;
+        for (Pending &p : outbox)
+        {
+            if (!p.used || now < p.nextSendUs)
+                continue;
+            CrossingMessage message = {header(CROSSING, p.seq), clock.toMaster(p.localTime), p.racerId, p.reads, {}};
+            transport.send(master, &message, sizeof(message));
+            if (p.nextSendUs)
+                stats.resends++;
+            else
+                stats.crossingsSent++;
+            p.nextSendUs = now + RESEND_US;
+        }
+    }
+
+    void handle(const GatePeer &from, const uint8_t *data, size_t length)
+    {
+        uint64_t received = transport.now();
+        Header h;
+        if (length < sizeof(h))
+        {
+            stats.badMessages++;
+            return;
+        }
+        memcpy(&h, data, sizeof(h));
+        if (h.magic != MAGIC || h.protocol != PROTOCOL || h.gate >= MAX_GATES || h.gate == gateId)
+        {
+            stats.badMessages++;
+            return;
+        }
+
+        if (gateId == 0)
+        {
+            if (h.type == SYNC)
+                onSync(from, data, length, received);
+            else if (h.type == CROSSING)
+                onCrossing(from, data, length);
+        }
+        else if (h.gate == 0)
+        {
+            if (h.type == SYNC_REPLY)
+                onSyncReply(from, data, length, received);
+            else if (h.type == RACE)
+                followMaster(from, h);
+            else if (h.type == ACK)
+                onAck(h);
+        }
+    }
+
+public:
+    explicit TimingNetwork(Transport &transport) : transport(transport)
+    {
+        begin(0, false, 0);
+    }
+
+    // gate 0 = master. Disabled: update() does nothing (a lone gate).
+    // session: random per boot.
+    void begin(uint8_t gate, bool enable, uint32_t bootSession)
+    {
+        gateId = gate < MAX_GATES ? gate : 0;
+        enabled = enable;
+        session = bootSession;
+        memset(&stats, 0, sizeof(stats));
+        stats.gate = gateId;
+        stats.enabled = enabled;
+        clock.reset();
+        memset(outbox, 0, sizeof(outbox));
+        memset(peers, 0, sizeof(peers));
+        memset(dedup, 0, sizeof(dedup));
+        Crossing stale;
+        while (arrivals.pop(stale))
+        {
+        }
+        nextSyncUs = 0;
+    }
+
+    // Handle everything received and send what is due. Returns true if
+    // anything arrived.
+    bool update()
+    {
+        if (!enabled)
+            return false;
+
+        uint8_t buffer[64];
+        size_t length = sizeof(buffer);
+        GatePeer from;
+        bool any = false;
+        while (transport.receive(from, buffer, length))
+        {
+            handle(from, buffer, length);
+            length = sizeof(buffer);
+            any = true;
+        }
+
+        if (gateId != 0)
+        {
+            uint64_t now = transport.now();
+            if (now >= nextSyncUs)
+                sendSync(now);
+            sendPending(now);
+            stats.synced = clock.synced();
+            stats.offsetUs = clock.offsetUs();
+            stats.driftPpb = clock.driftPpb();
+            stats.delayUs = clock.lastDelay();
+            stats.exchanges = clock.exchanges();
+            stats.masterRestarts = clock.steps();
+        }
+        return any;
+    }
+
+    // Master: race state for the splits
+    void setRace(bool racing, uint32_t raceNumber)
+    {
+        if (!enabled || gateId != 0 || (racing == stats.racing && raceNumber == stats.raceNumber))
+            return;
+        stats.racing = racing;
+        stats.raceNumber = raceNumber;
+        Header race = header(RACE);
+        for (uint8_t gate = 1; gate < MAX_GATES; gate++)
+        {
+            if (stats.gates[gate].seen)
+                transport.send(peers[gate], &race, sizeof(race));
+        }
+    }
+
+    // Master: next crossing from a split
+    bool poll(Crossing &crossing) { return arrivals.pop(crossing); }
+
+    // Split: a crossing at a local time, to go to the master. False (and
+    // counted) if OUTBOX_SIZE are still unacknowledged.
+    bool report(uint8_t racerId, uint64_t localTime, uint8_t reads)
+    {
+        for (Pending &p : outbox)
+        {
+            if (!p.used)
+            {
+                p = {true, nextSeq++, racerId, reads, localTime, 0};
+                sendPending(transport.now());
+                return true;
+            }
+        }
+        stats.outboxDrops++;
+        return false;
+    }
+
+    bool active() const { return enabled; }
+    bool isMaster() const { return gateId == 0; }
+    uint8_t gate() const { return gateId; }
+    bool racing() const { return stats.racing; }
+    uint32_t raceNumber() const { return stats.raceNumber; }
+    const GateClock &masterClock() const { return clock; }
+    const Status &status() const { return stats; }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <esp_timer.h>
+#include "TimingNetwork.hpp"
+
+// ============================================================================
+// UDP Transport (ESP32)
+// ============================================================================
+// TimingNetwork's link over WiFi: one UDP socket on TimingNetwork's port,
+// polled from the loop. Splits join the master's access point (or the same
+// network as it), so the master is found with a broadcast on the STA
+// subnet.
+class UdpTransport
+{
+private:
+    WiFiUDP udp;
+    uint16_t port = 0;
+    bool open = false;
+
+public:
+    bool begin(uint16_t localPort)
+    {
+        if (open)
+            udp.stop();
+        port = localPort;
+        open = udp.begin(port);
+        if (!open)
+            Serial.printf("Timing network: UDP port %u unavailable\n", port);
+        return open;
+    }
+
+    bool send(const GatePeer &to, const void *data, size_t length)
+    {
+        if (!open || !udp.beginPacket(IPAddress(to.ip), to.port))
+            return false;
+        udp.write(static_cast<const uint8_t *>(data), length);
+        return udp.endPacket();
+    }
+
+    // Next datagram, if any. Never blocks.
+    bool receive(GatePeer &from, void *data, size_t &length)
+    {
+        if (!open)
+            return false;
+        int size = udp.parsePacket();
+        if (size <= 0)
+            return false;
+        length = udp.read(static_cast<uint8_t *>(data), length);
+        from.ip = (uint32_t)udp.remoteIP();
+        from.port = udp.remotePort();
+        return true;
+    }
+
+    GatePeer broadcast()
+    {
+        IPAddress address = WiFi.status() == WL_CONNECTED ? WiFi.broadcastIP() : IPAddress(0xFFFFFFFF);
+        return {(uint32_t)address, port};
+    }
+
+    uint64_t now() { return esp_timer_get_time(); }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <SPIFFS.h>
+
+// ============================================================================
+// Web Assets
+// ============================================================================
+// Serves the web app as built by tools/build_web.py: every file is stored
+// only gzipped, and /assets.txt lists "path hash" for each one. Responses
+// carry Content-Encoding: gzip and a strong ETag (the hash); a browser
+// revalidating a copy it already holds gets 304 with no body. Files
+// requested by hash (?v=<hash>, as index.html links css and js) are cached
+// for a year; anything else, index.html included, revalidates on each load.
+class WebAssets
+{
+public:
+    static constexpr uint8_t MAX_ASSETS = 16;
+    static constexpr const char *MANIFEST = "/assets.txt";
+
+private:
+    struct Asset
+    {
+        char path[32];
+        char hash[17];
+        char etag[19]; // Quoted hash
+    };
+
+    Asset assets[MAX_ASSETS];
+    uint8_t count = 0;
+
+    static const char *contentType(const char *path)
+    {
+        const char *ext = strrchr(path, '.');
+        if (!ext)
+            return "application/octet-stream";
+        if (!strcmp(ext, ".html"))
+            return "text/html";
+        if (!strcmp(ext, ".css"))
+            return "text/css";
+        if (!strcmp(ext, ".js"))
+            return "application/javascript";
+        if (!strcmp(ext, ".svg"))
+            return "image/svg+xml";
+        if (!strcmp(ext, ".png"))
+            return "image/png";
+        if (!strcmp(ext, ".ico"))
+            return "image/x-icon";
+        return "application/octet-stream";
+    }
+
+    static void serve(AsyncWebServerRequest *request, const Asset &asset)
+    {
+        bool hashed = request->hasParam("v") && request->getParam("v")->value() == asset.hash;
+        const char *cacheControl = hashed ? "public, max-age=31536000, immutable" : "no-cache";
+
+        AsyncWebServerResponse *response;
+        if (request->hasHeader("If-None-Match") &&
+            request->header("If-None-Match").indexOf(asset.etag) >= 0)
+            response = request->beginResponse(304);
+        else
+            // Only <path>.gz exists, so the file response sends it with
+            // Content-Encoding: gzip
+            response = request->beginResponse(SPIFFS, asset.path, contentType(asset.path));
+
+        response->addHeader("ETag", asset.etag);
+        response->addHeader("Cache-Control", cacheControl);
+        request->send(response);
+    }
+
+public:
+    // Register a route per listed file ("/" for /index.html). Returns false
+    // when there is no manifest (data/ uploaded without the build step);
+    // the caller's serveStatic then serves the raw files.
+    bool begin(AsyncWebServer &server)
+    {
+        File file = SPIFFS.open(MANIFEST, FILE_READ);
+        if (!file)
+            return false;
+
+        char text[MAX_ASSETS * 64];
+        size_t length = file.readBytes(text, sizeof(text) - 1);
+        file.close();
+        text[length] = '\0';
+
+        char *save = nullptr;
+        for (char *line = strtok_r(text, "\n", &save); line && count < MAX_ASSETS;
+             line = strtok_r(nullptr, "\n", &save))
+        {
+            Asset &asset = assets[count];
+            if (sscanf(line, "%31s %16s", asset.path, asset.hash) != 2)
+                continue;
+            snprintf(asset.etag, sizeof(asset.etag), "\"%s\"", asset.hash);
+
+            const Asset *registered = &asset;
+            server.on(asset.path, HTTP_GET, [registered](AsyncWebServerRequest *request)
+                      { serve(request, *registered); });
+            if (!strcmp(asset.path, "/index.html"))
+                server.on("/", HTTP_GET, [registered](AsyncWebServerRequest *request)
+                          { serve(request, *registered); });
+            count++;
+        }
+
+        Serial.printf("Web assets: %u gzipped files\n", count);
+        return count > 0;
+    }
+
+    uint8_t assetCount() const { return count; }
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+// ============================================================================
+// TSOP receiver model (host tools)
+// ============================================================================
+// Turns the blaster's burst/gap schedule into the receiver output edges the
+// base station would capture during one pass through the gate. Transmitters
+// run the blaster firmware's own PacketScheduler, so encodings and
+// inter-packet spacing match what is flown.
+
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "IRPacketDecoder.hpp"
+#include "../../hitscan/src/PacketScheduler.hpp"
+
+enum class Encoding
+{
+    V1,     // sync + 3 bits
+    V2,     // sync + 3 bits + parity
+    COMPACT // marker + 2 four-level gap symbols
+};
+
+inline const char *encodingName(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::V1:
+        return "v1";
+    case Encoding::V2:
+        return "v2";
+    default:
+        return "compact";
+    }
+}
+
+struct Edge
+{
+    double time; // µs
+    uint8_t level;
+};
+
+struct ChannelParams
+{
+    double delayUs = 150;     // TSOP response delay
+    double minStretchUs = 0;  // TSOP lengthens each burst by at least this
+    double maxStretchUs = 60; // and up to this (more with a stronger signal)
+    double jitterUs = 15;     // Per-edge timing noise (sd)
+    double glitchesPerMs = 0.1;
+    double levelErrors = 0; // Share of packets with one data gap a level off
+};
+
+struct Span
+{
+    double start; // µs
+    double end;
+};
+
+// What a transmitter put on air inside its window, for collision accounting
+struct Transmission
+{
+    std::vector<Span> packets; // Whole packets, first burst to the end of the last symbol
+    std::vector<Span> bursts;
+};
+
+inline uint8_t packetVersion(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::V1:
+        return 1;
+    case Encoding::V2:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+inline double packetDuration(Encoding encoding, uint8_t id)
+{
+    PacketScheduler scheduler;
+    scheduler.begin(id, packetVersion(encoding));
+    return scheduler.packetUs();
+}
+
+// A data gap read one level off: the neighbouring compact gap length, or
+// the other bit value (the sync gap is never picked)
+inline double levelError(Encoding encoding, double gapUs, std::mt19937 &rng)
+{
+    if (encoding != Encoding::COMPACT)
+        return gapUs < IR_ONE_GAP_US ? IR_ONE_GAP_US - IR_ZERO_GAP_US : IR_ZERO_GAP_US - IR_ONE_GAP_US;
+    int level = (int)((gapUs - IR_COMPACT_GAP_BASE_US) / IR_COMPACT_GAP_STEP_US + 0.5);
+    int direction = level == 0 ? 1 : level == 3 ? -1 : (rng() & 1 ? 1 : -1);
+    return direction * IR_COMPACT_GAP_STEP_US;
+}
+
+// Receiver output edges for one transmitter that is visible from enterUs for
+// windowUs. The scheduler starts phaseUs before the window opens; bursts are
+// only seen if they fall entirely inside the window.
+inline void addTransmitter(std::vector<Edge> &edges, std::mt19937 &rng, Encoding encoding,
+                           uint8_t id, double phaseUs, double windowUs, const ChannelParams &channel,
+                           uint8_t dutyPercent = IR_MAX_DUTY_PERCENT, double enterUs = 0,
+                           Transmission *log = nullptr)
+{
+    std::uniform_real_distribution<double> stretch(channel.minStretchUs, channel.maxStretchUs);
+    std::normal_distribution<double> jitter(0, channel.jitterUs > 0 ? channel.jitterUs : 1e-9);
+
+    PacketScheduler scheduler;
+    scheduler.begin(id, packetVersion(encoding), dutyPercent);
+    double packetUs = scheduler.packetUs() + (scheduler.spaced() ? IR_BURST_US : 0);
+    double exitUs = enterUs + windowUs;
+
+    // Level errors: which gap of the current packet is misread, if any
+    int firstData = encoding == Encoding::COMPACT ? 0 : 1;
+    int bursts = 0;
+    int misread = -1;
+
+    double t = enterUs - phaseUs;
+    while (t < exitUs)
+    {
+        if (scheduler.atPacketStart())
+        {
+            bursts = 0;
+            misread = -1;
+            if (channel.levelErrors > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < channel.levelErrors)
+                misread = firstData + rng() % (scheduler.symbolCount() - firstData);
+        }
+        if (log && scheduler.atPacketStart() && t >= enterUs && t + packetUs <= exitUs)
+            log->packets.push_back({t, t + packetUs});
+
+        PacketScheduler::Step step = scheduler.next();
+        double durationUs = step.durationUs;
+        if (step.carrier)
+            bursts++;
+        else if (bursts - 1 == misread)
+        {
+            durationUs += levelError(encoding, durationUs, rng);
+            misread = -1;
+        }
+
+        if (step.carrier && t >= enterUs && t + step.durationUs <= exitUs)
+        {
+            edges.push_back({t + channel.delayUs + jitter(rng), 0});
+            edges.push_back({t + step.durationUs + channel.delayUs + stretch(rng) + jitter(rng), 1});
+            if (log)
+                log->bursts.push_back({t, t + step.durationUs});
+        }
+        t += durationUs;
+    }
+}
+
+// Short noise spikes (sunlight flicker, reflections)
+inline void addGlitches(std::vector<Edge> &edges, std::mt19937 &rng, double windowUs,
+                        const ChannelParams &channel)
+{
+    std::poisson_distribution<int> glitchCount(channel.glitchesPerMs * windowUs / 1000.0);
+    std::uniform_real_distribution<double> glitchAt(0, windowUs);
+    std::uniform_real_distribution<double> glitchLen(20, 120);
+    int count = glitchCount(rng);
+    for (int i = 0; i < count; i++)
+    {
+        double at = glitchAt(rng);
+        edges.push_back({at, 0});
+        edges.push_back({at + glitchLen(rng), 1});
+    }
+}
+
+// Sort and merge overlapping carrier (the TSOP output is LOW while any
+// transmitter or glitch is active), bracketed by long idle periods.
+inline std::vector<Edge> receiverOutput(std::vector<Edge> edges, double windowUs)
+{
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+              { return a.time < b.time; });
+
+    std::vector<Edge> clean;
+    clean.push_back({-100000, 1});
+    int depth = 0;
+    for (const Edge &e : edges)
+    {
+        depth += e.level == 0 ? 1 : -1;
+        if (e.level == 0 && depth == 1)
+            clean.push_back(e);
+        else if (e.level == 1 && depth <= 0)
+        {
+            depth = 0;
+            clean.push_back(e);
+        }
+    }
+    clean.push_back({windowUs + 100000, 0}); // Far-future edge terminates the last pulse
+    return clean;
+}
+
+inline std::vector<Edge> synthesisePass(std::mt19937 &rng, Encoding encoding, uint8_t id,
+                                        double windowUs, const ChannelParams &channel)
+{
+    std::uniform_real_distribution<double> phase(0, packetDuration(encoding, id));
+    std::vector<Edge> edges;
+    addTransmitter(edges, rng, encoding, id, phase(rng), windowUs, channel);
+    addGlitches(edges, rng, windowUs, channel);
+    return receiverOutput(edges, windowUs);
+}
+
+// Replay edges through a decoder. Times are offset so they stay positive.
+template <typename Decoder, typename OnPacket>
+inline void replay(const std::vector<Edge> &edges, Decoder &decoder, OnPacket onPacket)
+{
+    typename Decoder::Packet packet;
+    for (size_t i = 0; i + 1 < edges.size(); i++)
+    {
+        uint64_t start = (uint64_t)(edges[i].time + 1000000);
+        uint32_t duration = (uint32_t)(edges[i + 1].time - edges[i].time);
+        if (decoder.feed(edges[i].level, duration, start, packet))
+            onPacket(packet);
+    }
+}
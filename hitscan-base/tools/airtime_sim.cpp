@@ -0,0 +1,78 @@
+// ============================================================================
+// Airtime simulation (host)
+// ============================================================================
+// Expected packets per gate pass against speed for each packet encoding:
+// "ideal" is the average number of whole packets that fit in the detection
+// window, "decoded" is what IRPacketDecoder actually recovers from the
+// modelled TSOP output, "hit" is the fraction of passes with at least one.
+//
+// Build: g++ -std=c++17 -O2 -I../src airtime_sim.cpp -o airtime_sim
+// Usage: ./airtime_sim [passes] [cone_mm] [jitter_us] [glitches_per_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "TsopModel.hpp"
+
+int main(int argc, char **argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 2000;
+    double coneMm = argc > 2 ? atof(argv[2]) : 200;
+
+    ChannelParams channel;
+    channel.jitterUs = argc > 3 ? atof(argv[3]) : 15;
+    channel.glitchesPerMs = argc > 4 ? atof(argv[4]) : 0.1;
+
+    const Encoding encodings[] = {Encoding::V1, Encoding::V2, Encoding::COMPACT};
+    std::mt19937 rng(1234);
+
+    printf("cone %.0fmm, jitter %.0fus, %.2f glitches/ms, %d passes per point\n\n",
+           coneMm, channel.jitterUs, channel.glitchesPerMs, passes);
+
+    printf("%-8s", "");
+    for (Encoding encoding : encodings)
+    {
+        double average = 0;
+        for (uint8_t id = 0; id < 8; id++)
+            average += packetDuration(encoding, id) / 8;
+        printf(" | %-7s %6.2fms avg     ", encodingName(encoding), average / 1000.0);
+    }
+    printf("\n%-8s", "km/h");
+    for (size_t i = 0; i < sizeof(encodings) / sizeof(encodings[0]); i++)
+        printf(" | %7s %7s %6s", "ideal", "decoded", "hit");
+    printf("\n");
+
+    for (int kmh = 50; kmh <= 300; kmh += 25)
+    {
+        double windowUs = coneMm / (kmh / 3.6) * 1000.0;
+        printf("%-8d", kmh);
+
+        for (Encoding encoding : encodings)
+        {
+            double ideal = 0;
+            long decoded = 0;
+            int hits = 0;
+
+            for (int p = 0; p < passes; p++)
+            {
+                uint8_t id = p % 8;
+                double length = packetDuration(encoding, id);
+                ideal += windowUs > length ? windowUs / length - 1 : 0;
+
+                IRPacketDecoder decoder;
+                int good = 0;
+                replay(synthesisePass(rng, encoding, id, windowUs, channel), decoder,
+                       [&](const IRPacketDecoder::Packet &packet)
+                       { good += packet.racerId == id; });
+
+                decoded += good;
+                hits += good > 0;
+            }
+
+            printf(" | %7.2f %7.2f %5.1f%%", ideal / passes, (double)decoded / passes,
+                   100.0 * hits / passes);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
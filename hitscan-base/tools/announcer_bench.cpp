@@ -0,0 +1,185 @@
+// ============================================================================
+// Lap announcer benchmark (host)
+// ============================================================================
+// Times the parts of an announcement that run on the base station, with
+// synthetic clips in place of the SD card:
+//
+//   compose   - Announcement::lap(): the clip ids for "<racer> - 23.4"
+//   lookup    - ClipCache::get() on a hit
+//   assembly  - what the announcer task does per lap once the cache has
+//               warmed up (misses from evictions included):
+//               name check, compose, resolve every clip, queue them on the
+//               AudioMixer speech channel
+//
+// then replays a race (racers lapping at random around a target lap time)
+// against the phrase lengths the clips give, and reports how many times
+// were read out, coalesced (racer lapped again first) or expired, the
+// delay from crossing to the start of its phrase, and the cache hit rate
+// for the given budget.
+//
+// Build: g++ -std=c++17 -O2 -I../src announcer_bench.cpp -o announcer_bench
+// Usage: ./announcer_bench [racers] [lap_s] [clip_ms] [clip_rate] [cache_kb]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "Announcement.hpp"
+#include "AudioMixer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double nsSince(Clock::time_point start, long count)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+}
+
+int main(int argc, char **argv)
+{
+    int racers = argc > 1 ? atoi(argv[1]) : 4;
+    double lapS = argc > 2 ? atof(argv[2]) : 20.0;
+    int clipMs = argc > 3 ? atoi(argv[3]) : 300;
+    int clipRate = argc > 4 ? atoi(argv[4]) : 11025;
+    size_t cacheBytes = argc > 5 ? (size_t)atoi(argv[5]) * 1024 : ClipCache::DEFAULT_BYTES;
+    racers = std::max(1, std::min(racers, (int)RaceState::MAX_RACERS));
+
+    uint32_t clipSamples = (uint32_t)clipRate * clipMs / 1000;
+    long loads = 0;
+    auto load = [&](uint8_t clip, ClipCache::Entry &entry)
+    {
+        if (clip >= Announcement::NAME && clip < Announcement::NAME + RaceState::MAX_RACERS &&
+            clip - Announcement::NAME >= racers)
+            return false; // Only the racers in the race have a name clip
+        entry.samples = (int16_t *)malloc(clipSamples * sizeof(int16_t));
+        memset(entry.samples, 0, clipSamples * sizeof(int16_t));
+        entry.count = clipSamples;
+        entry.sampleRate = clipRate;
+        loads++;
+        return true;
+    };
+
+    printf("%d racers, %.1f s laps, clips %d ms at %d Hz (%u bytes), cache %zu KB\n\n", racers, lapS, clipMs,
+           clipRate, clipSamples * 2, cacheBytes / 1024);
+
+    // Compose
+    const long ROUNDS = 1000000;
+    volatile uint8_t sink = 0;
+    auto start = Clock::now();
+    for (long i = 0; i < ROUNDS; i++)
+    {
+        Announcement::Phrase phrase = Announcement::lap(i & 7, 15000000 + i * 37, i & 1);
+        sink = sink + phrase.length;
+    }
+    printf("compose          %7.1f ns per phrase\n", nsSince(start, ROUNDS));
+
+    // Lookup (hit)
+    ClipCache cache(cacheBytes);
+    cache.get(Announcement::NUMBER + 3, load);
+    start = Clock::now();
+    for (long i = 0; i < ROUNDS; i++)
+        sink = sink + cache.get(Announcement::NUMBER + 3, load)->count;
+    printf("lookup (hit)     %7.1f ns per clip\n", nsSince(start, ROUNDS));
+
+    // Assembly, draining the speech channel in between
+    static AudioMixer mixer(44100);
+    int16_t block[64];
+    const long WARMUP = 200;
+    const long PHRASES = 2000; // Each one is played out before the next
+    double assemblyNs = 0;
+    for (long i = 0; i < WARMUP + PHRASES; i++)
+    {
+        if (i == WARMUP)
+            assemblyNs = 0;
+        auto t0 = Clock::now();
+        uint8_t racerId = i % racers;
+        bool haveName = cache.get(Announcement::NAME + racerId, load) != nullptr;
+        Announcement::Phrase phrase = Announcement::lap(racerId, 18000000 + (i % 5000) * 1000, haveName);
+        uint64_t pinned = 0;
+        for (uint8_t c = 0; c < phrase.length; c++)
+        {
+            uint8_t id = phrase.clips[c];
+            if (id == Announcement::PAUSE)
+            {
+                mixer.say({nullptr, 120, 1000});
+                continue;
+            }
+            const ClipCache::Entry *entry = cache.get(id, load, pinned);
+            pinned |= (uint64_t)1 << id;
+            mixer.say({entry->samples, entry->count, entry->sampleRate});
+        }
+        assemblyNs += std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        while (mixer.speaking())
+            mixer.render(block, 64);
+    }
+    printf("assembly         %7.1f ns per phrase, %u hits / %u misses, %u evictions, %zu bytes cached\n\n",
+           assemblyNs / PHRASES, cache.hits(), cache.misses(), cache.evictions(), cache.bytes());
+
+    // Race replay on a simulated clock (ms)
+    std::mt19937 rng(7);
+    std::normal_distribution<double> lapJitter(lapS * 1000, lapS * 100);
+    std::vector<double> nextCrossing(racers);
+    std::vector<uint64_t> crossedAt(RaceState::MAX_RACERS);
+    for (int r = 0; r < racers; r++)
+        nextCrossing[r] = std::uniform_real_distribution<double>(0, 3000)(rng); // Start spread
+
+    ClipCache raceCache(cacheBytes);
+    Announcement::Backlog backlog;
+    std::vector<double> delays;
+    long crossings = 0, spoken = 0;
+    double speakingUntil = 0;
+    uint32_t loadsBefore = loads;
+    const double RACE_MS = 10 * 60 * 1000;
+
+    for (uint32_t now = 0; now < RACE_MS; now += 20)
+    {
+        for (int r = 0; r < racers; r++)
+        {
+            if (nextCrossing[r] > now)
+                continue;
+            uint64_t lap = (uint64_t)(std::max(1000.0, lapJitter(rng)) * 1000);
+            backlog.add(r, lap, now);
+            crossedAt[r] = now;
+            nextCrossing[r] += lap / 1000.0;
+            crossings++;
+        }
+        if (now < speakingUntil)
+            continue;
+
+        uint8_t racerId;
+        uint64_t timeUs;
+        if (!backlog.next(now, racerId, timeUs))
+            continue;
+        bool haveName = raceCache.get(Announcement::NAME + racerId, load) != nullptr;
+        Announcement::Phrase phrase = Announcement::lap(racerId, timeUs, haveName);
+        double phraseMs = 0;
+        uint64_t pinned = 0;
+        for (uint8_t c = 0; c < phrase.length; c++)
+        {
+            uint8_t id = phrase.clips[c];
+            if (id == Announcement::PAUSE)
+            {
+                phraseMs += 120;
+                continue;
+            }
+            const ClipCache::Entry *entry = raceCache.get(id, load, pinned);
+            pinned |= (uint64_t)1 << id;
+            phraseMs += entry->count * 1000.0 / entry->sampleRate;
+        }
+        speakingUntil = now + phraseMs;
+        delays.push_back(now - crossedAt[racerId]);
+        spoken++;
+    }
+
+    std::sort(delays.begin(), delays.end());
+    auto at = [&](double f) { return delays.empty() ? 0.0 : delays[(size_t)(f * (delays.size() - 1))]; };
+    printf("race: %ld crossings in 10 min, %ld read out, %u coalesced, %u expired\n", crossings, spoken,
+           backlog.coalescedCount(), backlog.expiredCount());
+    printf("crossing to phrase start: median %.0f ms, p95 %.0f ms, max %.0f ms\n", at(0.5), at(0.95), at(1.0));
+    printf("clip cache: %u hits / %u misses (%.1f%% hit rate), %ld card reads\n", raceCache.hits(),
+           raceCache.misses(), 100.0 * raceCache.hits() / std::max(1u, raceCache.hits() + raceCache.misses()),
+           loads - loadsBefore);
+    return sink == 255 ? 1 : 0;
+}
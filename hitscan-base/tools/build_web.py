@@ -0,0 +1,124 @@
+# ============================================================================
+# Web asset build (PlatformIO extra script)
+# ============================================================================
+# Turns data/ into the filesystem image contents in .pio/data/:
+#
+#   - minifies html, css and js (conservative: whitespace and comments only)
+#   - links css/js from the html with their content hash (?v=<hash>), so the
+#     browser may cache them for good and still pick up a new build
+#   - gzips every file (only the .gz goes into the image)
+#   - writes /assets.txt, one "path etag" line per file, read by WebAssets
+#
+# Runs before buildfs/uploadfs. Standalone, it also prints the size report:
+#   python tools/build_web.py
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+def minify_html(text):
+    # Collapse whitespace outside of <pre>, <textarea> and inline <script>
+    parts = re.split(r"(<(pre|textarea|script)\b.*?</\2>)", text, flags=re.S | re.I)
+    out = []
+    for i, part in enumerate(parts):
+        if i % 3 == 2:
+            continue  # Tag name captured by the inner group
+        if i % 3 == 1:
+            out.append(part)
+        else:
+            part = re.sub(r"<!--.*?-->", "", part, flags=re.S)
+            out.append(re.sub(r"\s+", " ", part))
+    return "".join(out).strip()
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};,>])\s*", r"\1", text)
+    text = re.sub(r":\s+", ":", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    # Indentation, blank lines and whole-line comments only; newlines stay
+    # so automatic semicolon insertion behaves exactly as in the source
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line and not line.startswith("//"):
+            lines.append(line)
+    return "\n".join(lines) + "\n"
+
+
+MINIFIERS = {".html": minify_html, ".css": minify_css, ".js": minify_js}
+
+
+def content_hash(data):
+    return hashlib.sha1(data).hexdigest()[:16]
+
+
+def build(source_dir, output_dir, report=print):
+    if os.path.isdir(output_dir):
+        shutil.rmtree(output_dir)
+    os.makedirs(output_dir)
+
+    files = {}
+    for root, _, names in os.walk(source_dir):
+        for name in sorted(names):
+            path = os.path.join(root, name)
+            web_path = "/" + os.path.relpath(path, source_dir).replace(os.sep, "/")
+            with open(path, "rb") as f:
+                files[web_path] = f.read()
+
+    # Minify, then hash everything that is not html first so the html can
+    # link the hashed names
+    raw_total = sum(len(data) for data in files.values())
+    built = {}
+    for web_path, data in files.items():
+        ext = os.path.splitext(web_path)[1].lower()
+        if ext in MINIFIERS:
+            data = MINIFIERS[ext](data.decode("utf-8")).encode("utf-8")
+        built[web_path] = data
+
+    hashes = {p: content_hash(d) for p, d in built.items() if not p.endswith(".html")}
+    for web_path in [p for p in built if p.endswith(".html")]:
+        text = built[web_path].decode("utf-8")
+        for linked, digest in hashes.items():
+            text = re.sub(r'(["\'])%s\1' % re.escape(linked), r"\g<1>%s?v=%s\g<1>" % (linked, digest), text)
+        built[web_path] = text.encode("utf-8")
+        hashes[web_path] = content_hash(built[web_path])
+
+    manifest = []
+    gz_total = 0
+    report("%-20s %8s %8s %8s" % ("file", "raw", "minified", "gzip"))
+    for web_path in sorted(built):
+        data = built[web_path]
+        target = os.path.join(output_dir, web_path.lstrip("/") + ".gz")
+        os.makedirs(os.path.dirname(target), exist_ok=True)
+        packed = gzip.compress(data, 9, mtime=0)
+        with open(target, "wb") as f:
+            f.write(packed)
+        gz_total += len(packed)
+        manifest.append("%s %s" % (web_path, hashes[web_path]))
+        report("%-20s %8d %8d %8d" % (web_path, len(files[web_path]), len(data), len(packed)))
+
+    with open(os.path.join(output_dir, "assets.txt"), "w") as f:
+        f.write("\n".join(manifest) + "\n")
+
+    report("%-20s %8d %8s %8d  (%.0f%% of raw)" % ("total", raw_total, "", gz_total, 100.0 * gz_total / raw_total))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+except NameError:
+    env = None
+
+if env is not None:
+    if any(t in COMMAND_LINE_TARGETS for t in ("buildfs", "uploadfs", "uploadfsota")):  # noqa: F821
+        build(os.path.join(env.subst("$PROJECT_DIR"), "data"), env.subst("$PROJECT_DATA_DIR"))
+elif __name__ == "__main__":
+    here = os.path.dirname(os.path.abspath(__file__))
+    build(os.path.join(here, "..", "data"), sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "..", ".pio", "data"))
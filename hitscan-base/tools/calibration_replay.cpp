@@ -0,0 +1,215 @@
+// ============================================================================
+// Calibration replay (host)
+// ============================================================================
+// Checks IRCalibrator against receivers that distort the signal. For each
+// receiver condition and encoding it calibrates on a trace of one
+// transmitter held at the gate (up to 20 s, until the calibrator finishes), then decodes the same set of gate passes
+// (random racers, 50 km/h) with:
+//
+//   nominal  - the compile-time ±30% windows
+//   strong   - the compile-time StrongSignal profile
+//   learned  - the calibrated windows, at runtime
+//
+// and prints the decode success rate (packets decoded / packets sent) of
+// each, plus the stretch the calibrator measured and its own before/after
+// count from the verification phase.
+//
+// --trace decodes a recorded pulse trace instead: one "level,duration_us"
+// line per receiver pulse (a serial dump of IRPulses). The first part
+// calibrates, and every decoder runs over the whole file.
+//
+// Build: g++ -std=c++17 -O2 -I../src calibration_replay.cpp -o calibration_replay
+// Usage: ./calibration_replay [passes] [seed]
+//        ./calibration_replay --trace pulses.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "IRCalibrator.hpp"
+#include "TsopModel.hpp"
+
+using LearnedDecoder = BasicIRPacketDecoder<IRTiming::Runtime>;
+using StrongDecoder = BasicIRPacketDecoder<IRTiming::StrongSignal>;
+
+static const double CALIBRATION_US = 20000000; // Held long enough for VERIFY_PULSES at any encoding
+static const double PASS_US = 200.0 / (50 / 3.6) * 1000.0; // 200 mm cone at 50 km/h
+static const uint8_t CALIBRATION_ID = 6;                  // 110: short and long gaps; compact 600 and 300 us
+
+struct Condition
+{
+    const char *name;
+    double minStretchUs;
+    double maxStretchUs;
+    double jitterUs;
+};
+
+static const Condition CONDITIONS[] = {
+    {"datasheet", 0, 60, 15},   // TsopModel defaults
+    {"weak", -70, -30, 20},     // Far from the gate: short bursts
+    {"close", 90, 150, 15},     // Strong signal: long bursts, short gaps
+    {"blinding", 130, 190, 20}, // Blaster right at the receiver
+    {"noisy", 0, 60, 40},       // Sunlight, long cable
+};
+
+struct Pulse
+{
+    uint8_t level;
+    uint32_t duration;
+    uint64_t start;
+};
+
+static std::vector<Pulse> pulses(const std::vector<Edge> &edges)
+{
+    std::vector<Pulse> out;
+    for (size_t i = 0; i + 1 < edges.size(); i++)
+        out.push_back({edges[i].level, (uint32_t)(edges[i + 1].time - edges[i].time),
+                       (uint64_t)(edges[i].time + 1000000)});
+    return out;
+}
+
+static bool calibrate(IRCalibrator &calibrator, const std::vector<Pulse> &trace)
+{
+    calibrator.begin(IRTiming::nominal());
+    for (const Pulse &p : trace)
+    {
+        calibrator.feed(p.level, p.duration, p.start);
+        if (calibrator.finished())
+            break;
+    }
+    return calibrator.improves();
+}
+
+// Verification outcome: packets before -> after, or why there is none
+static const char *verifyText(const IRCalibrator &calibrator, char *text, size_t size)
+{
+    const IRCalibrator::Result &r = calibrator.result();
+    if (calibrator.state() == IRCalibrator::Phase::DONE)
+        snprintf(text, size, "%u->%u", r.packetsBefore, r.packetsAfter);
+    else if (calibrator.state() == IRCalibrator::Phase::FAILED)
+        snprintf(text, size, "failed");
+    else
+        snprintf(text, size, "unfinished"); // Trace ended before VERIFY_PULSES
+    return text;
+}
+
+template <typename Decoder>
+static long decode(Decoder &decoder, const std::vector<Pulse> &trace, int id)
+{
+    long good = 0;
+    typename Decoder::Packet packet;
+    for (const Pulse &p : trace)
+    {
+        if (decoder.feed(p.level, p.duration, p.start, packet))
+            good += id < 0 || packet.racerId == id;
+    }
+    return good;
+}
+
+static void printWindows(const IRTiming::Windows &w)
+{
+    printf("    burst %u-%u  marker %u-%u  short %u-%u  long %u-%u  sync %u-%u  compact %u-%u base %u\n",
+           w.bitBurst.min, w.bitBurst.max, w.markerBurst.min, w.markerBurst.max, w.shortGap.min, w.shortGap.max,
+           w.longGap.min, w.longGap.max, w.syncGap.min, w.syncGap.max, w.compactGap.min, w.compactGap.max,
+           w.compactBase);
+}
+
+static int replayTrace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return 1;
+    }
+    std::vector<Pulse> trace;
+    uint64_t time = 0;
+    unsigned level, duration;
+    char line[64];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "%u,%u", &level, &duration) != 2)
+            continue; // Header or comment
+        trace.push_back({(uint8_t)level, duration, time});
+        time += duration;
+    }
+    fclose(file);
+
+    IRCalibrator calibrator;
+    calibrate(calibrator, trace);
+    const IRCalibrator::Result &r = calibrator.result();
+    char verify[24];
+    printf("%zu pulses; stretch %d us, %u classes learned, verify %s packets\n", trace.size(), r.stretchUs,
+           r.learnedClasses, verifyText(calibrator, verify, sizeof(verify)));
+    printWindows(r.windows);
+
+    IRPacketDecoder nominal;
+    StrongDecoder strong;
+    LearnedDecoder learned;
+    learned.setWindows(r.windows);
+    printf("packets decoded: nominal %ld, strong %ld, learned %ld\n", decode(nominal, trace, -1),
+           decode(strong, trace, -1), decode(learned, trace, -1));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && !strcmp(argv[1], "--trace"))
+        return replayTrace(argv[2]);
+
+    int passes = argc > 1 ? atoi(argv[1]) : 500;
+    unsigned seed = argc > 2 ? atoi(argv[2]) : 1;
+
+    printf("%d passes of %.1f ms per point; decode success = packets decoded / packets sent\n\n", passes,
+           PASS_US / 1000.0);
+    printf("%-10s %-8s %8s %12s | %8s %8s %8s\n", "receiver", "encoding", "stretch", "verify", "nominal", "strong",
+           "learned");
+
+    for (const Condition &condition : CONDITIONS)
+    {
+        ChannelParams channel;
+        channel.minStretchUs = condition.minStretchUs;
+        channel.maxStretchUs = condition.maxStretchUs;
+        channel.jitterUs = condition.jitterUs;
+
+        for (Encoding encoding : {Encoding::V2, Encoding::COMPACT})
+        {
+            std::mt19937 rng(seed);
+
+            // Transmitter held at the gate
+            std::vector<Edge> held;
+            addTransmitter(held, rng, encoding, CALIBRATION_ID, 0, CALIBRATION_US, channel);
+            addGlitches(held, rng, CALIBRATION_US, channel);
+            IRCalibrator calibrator;
+            calibrate(calibrator, pulses(receiverOutput(held, CALIBRATION_US)));
+            const IRCalibrator::Result &r = calibrator.result();
+
+            long sent = 0, nominal = 0, strong = 0, learned = 0;
+            for (int p = 0; p < passes; p++)
+            {
+                uint8_t id = rng() % 8;
+                std::uniform_real_distribution<double> phase(0, packetDuration(encoding, id));
+                std::vector<Edge> edges;
+                Transmission air;
+                addTransmitter(edges, rng, encoding, id, phase(rng), PASS_US, channel, IR_MAX_DUTY_PERCENT, 0, &air);
+                addGlitches(edges, rng, PASS_US, channel);
+                std::vector<Pulse> trace = pulses(receiverOutput(edges, PASS_US));
+
+                IRPacketDecoder nominalDecoder;
+                StrongDecoder strongDecoder;
+                LearnedDecoder learnedDecoder;
+                learnedDecoder.setWindows(r.windows);
+                sent += air.packets.size();
+                nominal += decode(nominalDecoder, trace, id);
+                strong += decode(strongDecoder, trace, id);
+                learned += decode(learnedDecoder, trace, id);
+            }
+
+            char verify[24];
+            printf("%-10s %-8s %6dus %12s | %7.1f%% %7.1f%% %7.1f%%%s\n", condition.name, encodingName(encoding),
+                   r.stretchUs, verifyText(calibrator, verify, sizeof(verify)), 100.0 * nominal / sent, 100.0 * strong / sent, 100.0 * learned / sent,
+                   calibrator.improves() ? "" : "  (not kept)");
+        }
+    }
+    return 0;
+}
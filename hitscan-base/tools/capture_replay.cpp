@@ -0,0 +1,242 @@
+// ============================================================================
+// Capture replay check (host)
+// ============================================================================
+// Replays recorded edge buffers through the IRCapture pulse ring and checks
+// that what comes out decodes at least as well as the old polling path
+// decoded the same signal. Each synthetic v2 pass is quantised to whole µs once; then:
+//
+//   ring     - a producer thread pushes the pulses into IRCapture::ring()
+//              the way the edge ISR does, while this thread, the one
+//              consumer, reads them back with IRCapture::read() into
+//              IRPacketDecoder
+//   polling  - the detectSync()/readBit() loop the ISR replaced, reading
+//              the pin level at every µs (no vTaskDelay between packets, so
+//              it misses nothing it could decode), with the v2 check bit
+//              read as a fourth bit
+//
+// Every packet the polling path decodes (racer ID and sync burst start)
+// must come out of the ring path too, and a pulse dropped or altered by the
+// ring fails the run. The ring path may decode more: the streaming decoder
+// restarts on any sync, where the polling loop was still busy with a
+// broken packet. It must not report more wrong IDs. Only its v2 packets
+// are compared: the polling path knows no other encoding, and the decoder
+// runs with v1 off, as for an all-v2 fleet.
+//
+// Build: g++ -std=c++17 -O2 -pthread -Imock -I../src capture_replay.cpp -o capture_replay
+// Usage: ./capture_replay [passes] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+#include "IRCapture.hpp"
+#include "TsopModel.hpp"
+
+struct Decoded
+{
+    uint8_t racerId;
+    uint64_t timestamp;
+
+    bool operator==(const Decoded &other) const { return racerId == other.racerId && timestamp == other.timestamp; }
+};
+
+// Edges at whole µs, as the ISR timestamps them, and the pulses between
+static std::vector<IRPulse> pulsesOf(const std::vector<Edge> &edges)
+{
+    std::vector<IRPulse> pulses;
+    for (size_t i = 0; i + 1 < edges.size(); i++)
+    {
+        uint64_t start = (uint64_t)(edges[i].time + 1000000.5);
+        uint64_t end = (uint64_t)(edges[i + 1].time + 1000000.5);
+        if (end > start)
+            pulses.push_back({edges[i].level, (uint32_t)(end - start), start});
+    }
+    return pulses;
+}
+
+// Producer thread in, decoder on this thread out
+static std::vector<Decoded> decodeRing(IRCapture &capture, const std::vector<IRPulse> &pulses, bool &intact)
+{
+    std::atomic<bool> done{false};
+    std::thread producer([&]
+                         {
+        for (const IRPulse &pulse : pulses)
+        {
+            while (!capture.ring().push(pulse)) // Counts a drop; the check below fails the run
+                std::this_thread::yield();
+        }
+        done = true; });
+
+    IRPacketDecoder decoder;
+    decoder.setAcceptV1(false);
+    IRPacketDecoder::Packet packet;
+    std::vector<Decoded> out;
+    size_t next = 0;
+    IRPulse pulse;
+    while (true)
+    {
+        bool finished = done;
+        while (capture.read(pulse))
+        {
+            const IRPulse &sent = pulses[next++];
+            intact = intact && pulse.level == sent.level && pulse.duration == sent.duration && pulse.start == sent.start;
+            if (decoder.feed(pulse.level, pulse.duration, pulse.start, packet) && packet.version == 2)
+                out.push_back({packet.racerId, packet.timestamp});
+        }
+        if (finished && capture.ring().empty())
+            break;
+    }
+    producer.join();
+    intact = intact && next == pulses.size();
+    return out;
+}
+
+// The old blocking decoder, on the same pulses
+static std::vector<Decoded> decodePolling(const std::vector<IRPulse> &pulses)
+{
+    std::vector<Decoded> out;
+    if (pulses.empty())
+        return out;
+    uint64_t end = pulses.back().start + pulses.back().duration;
+    size_t index = 0;
+    uint64_t t = pulses[0].start;
+
+    auto level = [&]() -> uint8_t
+    {
+        while (index + 1 < pulses.size() && pulses[index + 1].start <= t)
+            index++;
+        return t < end ? pulses[index].level : 1;
+    };
+    auto nextChange = [&]() -> uint64_t
+    {
+        level();
+        return pulses[index].start + pulses[index].duration;
+    };
+
+    // measurePulse(): time until the pin leaves level, 0 on timeout
+    auto measure = [&](uint8_t wanted, uint32_t timeout) -> uint32_t
+    {
+        if (level() != wanted)
+            return 0;
+        uint64_t change = nextChange();
+        if (change - t > timeout)
+        {
+            t += timeout;
+            return 0;
+        }
+        uint32_t length = change - t;
+        t = change;
+        return length;
+    };
+
+    while (t < end)
+    {
+        // detectSync(): wait for LOW, then burst + gap
+        while (t < end && level() == 1)
+            t = nextChange();
+        uint64_t syncStart = t;
+
+        uint32_t burst = measure(0, 2000);
+        if (burst < IRTiming::SYNC_BURST_MIN || burst > IRTiming::SYNC_BURST_MAX)
+            continue;
+        uint32_t gap = measure(1, 2000);
+        if (gap < IRTiming::SYNC_GAP_MIN || gap > IRTiming::SYNC_GAP_MAX)
+            continue;
+
+        // readBit() x3, then the check bit
+        uint8_t value = 0;
+        uint8_t bits = 0;
+        for (; bits < 4; bits++)
+        {
+            uint32_t b = measure(0, 2000);
+            if (b < IRTiming::BIT_BURST_MIN || b > IRTiming::BIT_BURST_MAX)
+                break;
+            uint32_t g = measure(1, 2000);
+            if (g >= IRTiming::SHORT_GAP_MIN && g <= IRTiming::SHORT_GAP_MAX)
+                value = value << 1;
+            else if (g >= IRTiming::LONG_GAP_MIN && g <= IRTiming::LONG_GAP_MAX)
+                value = (value << 1) | 1;
+            else
+                break;
+        }
+        uint8_t id = value >> 1;
+        if (bits == 4 && ((id >> 2) ^ (id >> 1) ^ id ^ value) % 2 == 0)
+            out.push_back({id, syncStart});
+    }
+    return out;
+}
+
+struct Tally
+{
+    long passes = 0;
+    long ringPackets = 0;
+    long pollingPackets = 0;
+    long missedPasses = 0; // Polling decoded a packet the ring path did not
+    long damagedPasses = 0; // Pulses lost or altered by the ring
+    long ringWrongIds = 0;
+    long pollingWrongIds = 0;
+};
+
+static Tally run(int passes, const ChannelParams &channel, std::mt19937 &rng)
+{
+    IRCapture capture(4);
+    Tally tally;
+    for (int p = 0; p < passes; p++)
+    {
+        uint8_t id = p % 8;
+        std::vector<IRPulse> pulses = pulsesOf(synthesisePass(rng, Encoding::V2, id, 20000, channel));
+
+        bool intact = true;
+        std::vector<Decoded> ring = decodeRing(capture, pulses, intact);
+        std::vector<Decoded> polling = decodePolling(pulses);
+
+        tally.passes++;
+        tally.ringPackets += ring.size();
+        tally.pollingPackets += polling.size();
+        bool missed = false;
+        for (const Decoded &d : polling)
+            missed = missed || std::find(ring.begin(), ring.end(), d) == ring.end();
+        tally.missedPasses += missed;
+        tally.damagedPasses += !intact;
+        for (const Decoded &d : ring)
+            tally.ringWrongIds += d.racerId != id;
+        for (const Decoded &d : polling)
+            tally.pollingWrongIds += d.racerId != id;
+    }
+    if (capture.overflowCount())
+        tally.damagedPasses++;
+    return tally;
+}
+
+static void print(const char *name, const Tally &t)
+{
+    printf("%-8s %6ld passes | packets ring %6ld polling %6ld | ring missed in %ld passes | wrong IDs ring %4ld polling %4ld | ring damaged %ld\n",
+           name, t.passes, t.ringPackets, t.pollingPackets, t.missedPasses, t.ringWrongIds, t.pollingWrongIds,
+           t.damagedPasses);
+}
+
+int main(int argc, char **argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned seed = argc > 2 ? atoi(argv[2]) : 1234;
+    std::mt19937 rng(seed);
+
+    ChannelParams clean;
+    clean.glitchesPerMs = 0;
+    ChannelParams glitchy;
+    glitchy.glitchesPerMs = 0.5;
+
+    Tally a = run(passes, clean, rng);
+    Tally b = run(passes, glitchy, rng);
+    print("clean", a);
+    print("glitchy", b);
+
+    bool ok = a.ringPackets > 0;
+    for (const Tally *t : {&a, &b})
+        ok = ok && t->missedPasses == 0 && t->damagedPasses == 0 && t->ringWrongIds <= t->pollingWrongIds;
+    printf("%s\n", ok ? "PASS: the ring path decodes what the polling path did" : "FAIL");
+    return ok ? 0 : 1;
+}
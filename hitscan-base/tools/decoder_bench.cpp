@@ -0,0 +1,169 @@
+// ============================================================================
+// Decoder benchmark (host)
+// ============================================================================
+// Synthesises TSOP output for a v2 quad flying through the gate and counts how
+// many packets per pass the streaming IRPacketDecoder recovers compared with
+// the old blocking detectSync()/readBit() loop (modelled at µs resolution,
+// including its 1ms vTaskDelay between decode attempts). Both read the v2
+// check bit and drop a packet that fails it.
+//
+// Build: g++ -std=c++17 -O2 -I../src decoder_bench.cpp -o decoder_bench
+// Usage: ./decoder_bench [passes] [cone_mm] [jitter_us] [glitches_per_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "TsopModel.hpp"
+
+static int decodeStreaming(const std::vector<Edge> &edges, uint8_t id)
+{
+    IRPacketDecoder decoder;
+    int good = 0;
+    replay(edges, decoder, [&](const IRPacketDecoder::Packet &packet)
+           { good += packet.racerId == id; });
+    return good;
+}
+
+// ---------------------------------------------------------------------------
+// Model of the old polling decoder
+// ---------------------------------------------------------------------------
+struct PinModel
+{
+    const std::vector<Edge> &edges;
+
+    size_t indexAt(double t) const
+    {
+        size_t lo = 0, hi = edges.size();
+        while (hi - lo > 1)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (edges[mid].time <= t)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    uint8_t level(double t) const { return edges[indexAt(t)].level; }
+
+    double nextChange(double t) const
+    {
+        size_t i = indexAt(t);
+        return i + 1 < edges.size() ? edges[i + 1].time : 1e12;
+    }
+};
+
+static int decodeLegacy(const std::vector<Edge> &edges, uint8_t id, double windowUs, std::mt19937 &rng)
+{
+    PinModel pin{edges};
+    std::uniform_real_distribution<double> wake(-1000, 0);
+    double t = wake(rng);
+    int good = 0;
+
+    // measurePulse(): time until the pin leaves level, 0 on timeout
+    auto measure = [&](uint8_t level, double timeout) -> double
+    {
+        if (pin.level(t) != level)
+            return 0;
+        double end = pin.nextChange(t);
+        double length = end - t;
+        if (length > timeout)
+        {
+            t += timeout;
+            return 0;
+        }
+        t = end;
+        return length;
+    };
+
+    while (t < windowUs + 5000)
+    {
+        int result = -1;
+
+        // detectSync(): wait for LOW, then burst + gap
+        while (pin.level(t) == 1 && t < windowUs + 5000)
+            t = pin.nextChange(t);
+
+        double burst = measure(0, 2000);
+        if (burst >= IRTiming::SYNC_BURST_MIN && burst <= IRTiming::SYNC_BURST_MAX)
+        {
+            double gap = measure(1, 2000);
+            if (gap >= IRTiming::SYNC_GAP_MIN && gap <= IRTiming::SYNC_GAP_MAX)
+            {
+                // readBit() x3, then the v2 check bit
+                int value = 0;
+                int bits = 0;
+                for (; bits < 4; bits++)
+                {
+                    double b = measure(0, 2000);
+                    if (b < IRTiming::BIT_BURST_MIN || b > IRTiming::BIT_BURST_MAX)
+                        break;
+                    double g = measure(1, 2000);
+                    if (g >= IRTiming::SHORT_GAP_MIN && g <= IRTiming::SHORT_GAP_MAX)
+                        value = value << 1;
+                    else if (g >= IRTiming::LONG_GAP_MIN && g <= IRTiming::LONG_GAP_MAX)
+                        value = (value << 1) | 1;
+                    else
+                        break;
+                }
+                int decoded = value >> 1;
+                if (bits == 4 && ((decoded >> 2) ^ (decoded >> 1) ^ decoded ^ value) % 2 == 0)
+                    result = decoded;
+            }
+        }
+
+        if (result == id)
+            good++;
+
+        // vTaskDelay(1): sleep to the next 1ms tick
+        t = (double)((long long)(t / 1000.0) + 1) * 1000.0;
+    }
+    return good;
+}
+
+int main(int argc, char **argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 2000;
+    double coneMm = argc > 2 ? atof(argv[2]) : 200;
+    double jitterUs = argc > 3 ? atof(argv[3]) : 15;
+    double glitchesPerMs = argc > 4 ? atof(argv[4]) : 0.1;
+
+    ChannelParams channel;
+    channel.jitterUs = jitterUs;
+    channel.glitchesPerMs = glitchesPerMs;
+
+    std::mt19937 rng(1234);
+
+    printf("cone %.0fmm, jitter %.0fus, %.2f glitches/ms, %d passes per speed\n\n",
+           coneMm, jitterUs, glitchesPerMs, passes);
+    printf("%6s %8s | %14s %10s | %14s %10s\n",
+           "km/h", "window", "legacy pkts", "legacy hit", "stream pkts", "stream hit");
+
+    for (int kmh = 50; kmh <= 250; kmh += 25)
+    {
+        double windowUs = coneMm / (kmh / 3.6) * 1000.0;
+        long legacyPackets = 0, streamPackets = 0;
+        int legacyHits = 0, streamHits = 0;
+
+        for (int p = 0; p < passes; p++)
+        {
+            uint8_t id = p % 8;
+            std::vector<Edge> edges = synthesisePass(rng, Encoding::V2, id, windowUs, channel);
+
+            int legacy = decodeLegacy(edges, id, windowUs, rng);
+            int stream = decodeStreaming(edges, id);
+
+            legacyPackets += legacy;
+            streamPackets += stream;
+            legacyHits += legacy > 0;
+            streamHits += stream > 0;
+        }
+
+        printf("%6d %6.1fms | %14.2f %9.1f%% | %14.2f %9.1f%%\n",
+               kmh, windowUs / 1000.0,
+               (double)legacyPackets / passes, 100.0 * legacyHits / passes,
+               (double)streamPackets / passes, 100.0 * streamHits / passes);
+    }
+
+    return 0;
+}
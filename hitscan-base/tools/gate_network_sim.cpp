@@ -0,0 +1,467 @@
+// ============================================================================
+// Timing network simulator (host)
+// ============================================================================
+// Runs a start/finish gate and its splits as separate processes that talk
+// TimingNetwork over loopback UDP, in real time. Every gate has its own
+// simulated clock: a random boot offset and a crystal drift of up to
+// --drift ppm. Datagrams get a random extra delay of up to --jitter µs each
+// way (WiFi retries, a busy loop) and --loss percent are dropped.
+//
+// Racers lap at their own pace through the gates in order; each gate
+// reports its crossings (after a pass-length delay, like the pass
+// aggregator) with its own clock's timestamp. Splits send theirs to gate 0,
+// which builds sector times with SectorBoard. At the end:
+//
+//   splits  - how long until synced, and the error of the mapped clock
+//             against the master's real clock (sampled every 10 ms),
+//             the drift estimate against the real one, crossings
+//             sent / acked / resent / dropped
+//   master  - crossings received per gate, duplicates filtered, sectors
+//             completed, and the worst error of the last and best sector
+//             times against the schedule
+//
+// A split whose p99 clock error is over --max-p99 µs (or that never
+// synced), or sector times off by more than two gates' worth of it, fail
+// the run. Leave it running for minutes: the clock has to hold over a
+// race, not just after the first fit.
+//
+// Without --gate it forks all gates itself. With --gate N it runs just that
+// one, so gates can be started in separate terminals (give them the same
+// --start, or let them meet at the next 10 s boundary).
+//
+// Build: g++ -std=c++17 -O2 -I../src gate_network_sim.cpp -o gate_network_sim
+// Usage: ./gate_network_sim [--gates N] [--seconds S] [--racers N] [--loss PERCENT]
+//                           [--jitter US] [--drift PPM] [--max-p99 US] [--port P]
+//                           [--seed N] [--gate N] [--start EPOCH_US]
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "TimingNetwork.hpp"
+
+struct Options
+{
+    int gates = 3;
+    double seconds = 180;
+    int racers = 4;
+    double lossPercent = 0;
+    double jitterUs = 2000;
+    double driftPpm = 50;
+    double maxP99Us = 1000; // Clock error a split may reach
+    int port = 42100;
+    unsigned seed = 1;
+    int gate = -1; // All
+    uint64_t startUs = 0;
+};
+
+static uint64_t epochUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ----------------------------------------------------------------------------
+// The simulated world: same on every process, from the seed
+// ----------------------------------------------------------------------------
+struct World
+{
+    struct GateClockModel
+    {
+        double offsetUs;
+        double drift; // Fraction (ppm * 1e-6)
+    };
+
+    struct Racer
+    {
+        double lapUs;
+        double phaseUs;
+    };
+
+    std::vector<GateClockModel> clocks;
+    std::vector<double> position; // Of each gate along the lap, 0..1
+    std::vector<Racer> racers;
+    uint64_t startUs;
+
+    World(const Options &options) : startUs(options.startUs)
+    {
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<double> boot(1e9, 1e11), drift(-options.driftPpm, options.driftPpm);
+        for (int g = 0; g < options.gates; g++)
+        {
+            clocks.push_back({boot(rng), drift(rng) * 1e-6});
+            std::uniform_real_distribution<double> wobble(-0.05, 0.05);
+            position.push_back(g == 0 ? 0 : (double)g / options.gates + wobble(rng));
+        }
+        std::uniform_real_distribution<double> lap(3e6, 5e6), phase(1.5e6, 2.5e6);
+        for (int r = 0; r < options.racers; r++)
+            racers.push_back({lap(rng), phase(rng)});
+    }
+
+    double trueNow() const { return (double)epochUs() - (double)startUs; }
+
+    uint64_t local(int gate, double trueUs) const
+    {
+        return (uint64_t)(clocks[gate].offsetUs + trueUs * (1 + clocks[gate].drift));
+    }
+
+    // Crossings of one gate: (true time, racer), in time order
+    std::vector<std::pair<double, int>> crossings(int gate, double untilUs) const
+    {
+        std::vector<std::pair<double, int>> out;
+        for (size_t r = 0; r < racers.size(); r++)
+        {
+            for (double t = racers[r].phaseUs + position[gate] * racers[r].lapUs; t < untilUs; t += racers[r].lapUs)
+                out.push_back({t, (int)r});
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    // Sector s of racer r, in master clock µs
+    double sectorUs(int r, int s) const
+    {
+        double to = s + 1 < (int)position.size() ? position[s + 1] : 1.0;
+        return (to - position[s]) * racers[r].lapUs * (1 + clocks[0].drift);
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Loopback UDP with loss and delay
+// ----------------------------------------------------------------------------
+class LoopbackTransport
+{
+    struct Delayed
+    {
+        double dueUs; // True time
+        GatePeer to;
+        std::vector<uint8_t> data;
+    };
+
+    const World &world;
+    int gate;
+    int fd = -1;
+    uint16_t masterPort;
+    double lossPercent;
+    double jitterUs;
+    std::mt19937 rng;
+    std::vector<Delayed> queue;
+
+    void pump()
+    {
+        double now = world.trueNow();
+        for (size_t i = 0; i < queue.size();)
+        {
+            if (queue[i].dueUs > now)
+            {
+                i++;
+                continue;
+            }
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = queue[i].to.ip;
+            address.sin_port = htons(queue[i].to.port);
+            sendto(fd, queue[i].data.data(), queue[i].data.size(), 0, (sockaddr *)&address, sizeof(address));
+            queue.erase(queue.begin() + i);
+        }
+    }
+
+public:
+    LoopbackTransport(const World &world, int gate, const Options &options)
+        : world(world), gate(gate), masterPort(options.port), lossPercent(options.lossPercent),
+          jitterUs(options.jitterUs), rng(options.seed * 100 + gate)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(options.port + gate);
+        if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0)
+        {
+            perror("bind");
+            exit(1);
+        }
+    }
+
+    ~LoopbackTransport() { close(fd); }
+
+    bool send(const GatePeer &to, const void *data, size_t length)
+    {
+        std::uniform_real_distribution<double> chance(0, 100), delay(0, jitterUs);
+        if (chance(rng) < lossPercent)
+            return true;
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        queue.push_back({world.trueNow() + 100 + delay(rng), to, std::vector<uint8_t>(bytes, bytes + length)});
+        pump();
+        return true;
+    }
+
+    bool receive(GatePeer &from, void *data, size_t &length)
+    {
+        pump();
+        sockaddr_in address = {};
+        socklen_t size = sizeof(address);
+        ssize_t n = recvfrom(fd, data, length, 0, (sockaddr *)&address, &size);
+        if (n < 0)
+            return false;
+        length = n;
+        from.ip = address.sin_addr.s_addr;
+        from.port = ntohs(address.sin_port);
+        return true;
+    }
+
+    // Loopback has no broadcast: "finding" the master goes straight to it
+    GatePeer broadcast() { return {htonl(INADDR_LOOPBACK), masterPort}; }
+
+    uint64_t now() { return world.local(gate, world.trueNow()); }
+};
+
+// ----------------------------------------------------------------------------
+// One gate
+// ----------------------------------------------------------------------------
+static const double PASS_DELAY_US = 100000; // Pass aggregator gap before a crossing is reported
+
+// Returns false if the clock missed --max-p99
+static bool reportSplit(FILE *out, const Options &options, int gate, const World &world,
+                        TimingNetwork<LoopbackTransport> &network, std::vector<double> &errors, double syncedAtUs)
+{
+    const auto &status = network.status();
+    std::sort(errors.begin(), errors.end());
+    double mean = 0;
+    for (double e : errors)
+        mean += e;
+    mean = errors.empty() ? 0 : mean / errors.size();
+    double realDrift = ((1 + world.clocks[0].drift) / (1 + world.clocks[gate].drift) - 1) * 1e9;
+
+    fprintf(out, "gate %d  synced after %5.0f ms, %u exchanges, last delay %u us\n", gate, syncedAtUs / 1000,
+            status.exchanges, status.delayUs);
+    double p99 = errors.empty() ? 0 : errors[errors.size() * 99 / 100];
+    bool ok = !errors.empty() && p99 <= options.maxP99Us;
+    if (!errors.empty())
+        fprintf(out, "        clock error: mean %.0f us, p99 %.0f us, max %.0f us (%zu samples)%s\n", mean, p99,
+                errors.back(), errors.size(), ok ? "" : "  FAIL");
+    else
+        fprintf(out, "        never synced  FAIL\n");
+    fprintf(out, "        drift %+.2f ppm estimated, %+.2f ppm real\n", status.driftPpb / 1000.0, realDrift / 1000.0);
+    fprintf(out, "        crossings: %u sent, %u acked, %u resent, %u dropped\n", status.crossingsSent,
+            status.crossingsAcked, status.resends, status.outboxDrops);
+    return ok;
+}
+
+// Returns false if a sector time is off by more than two gates' --max-p99
+static bool reportMaster(FILE *out, const Options &options, const World &world,
+                         TimingNetwork<LoopbackTransport> &network, const SectorBoard &board, uint32_t sectors,
+                         const std::vector<uint32_t> &received)
+{
+    const auto &status = network.status();
+    fprintf(out, "gate 0  crossings:");
+    for (int g = 0; g < options.gates; g++)
+        fprintf(out, " gate %d %u%s", g, received[g], g + 1 < options.gates ? "," : "");
+    fprintf(out, "; %u duplicates filtered\n", status.gates[1].duplicates + status.gates[2].duplicates +
+                                                   status.gates[3].duplicates);
+
+    double worstLast = 0, worstBest = 0;
+    for (int r = 0; r < options.racers; r++)
+    {
+        for (int s = 0; s < options.gates; s++)
+        {
+            double truth = world.sectorUs(r, s);
+            if (board.lastSector(r, s) != SectorBoard::NO_TIME)
+                worstLast = std::max(worstLast, std::abs((double)board.lastSector(r, s) - truth));
+            if (board.bestSector(r, s) != SectorBoard::NO_TIME)
+                worstBest = std::max(worstBest, std::abs((double)board.bestSector(r, s) - truth));
+        }
+    }
+    bool ok = sectors > 0 && std::max(worstLast, worstBest) <= 2 * options.maxP99Us;
+    fprintf(out, "        %u sectors completed; worst error: last %.0f us, best %.0f us%s\n", sectors, worstLast,
+            worstBest, ok ? "" : "  FAIL");
+    for (int r = 0; r < options.racers; r++)
+    {
+        fprintf(out, "        racer %d:", r);
+        for (int s = 0; s < options.gates; s++)
+        {
+            uint64_t last = board.lastSector(r, s);
+            fprintf(out, " S%d %.3f s (%+.0f us)", s + 1, last == SectorBoard::NO_TIME ? 0 : last / 1e6,
+                    last == SectorBoard::NO_TIME ? 0 : (double)last - world.sectorUs(r, s));
+        }
+        fprintf(out, "\n");
+    }
+    return ok;
+}
+
+static int runGate(int gate, const Options &options, FILE *out)
+{
+    World world(options);
+    LoopbackTransport transport(world, gate, options);
+    TimingNetwork<LoopbackTransport> network(transport);
+    network.begin(gate, true, options.seed * 1000 + gate + (uint32_t)getpid());
+
+    double endUs = options.seconds * 1e6;
+    std::vector<std::pair<double, int>> crossings = world.crossings(gate, endUs - 1e6);
+    size_t nextCrossing = 0;
+
+    SectorBoard board;
+    board.begin(options.gates);
+    uint32_t sectors = 0;
+    std::vector<uint32_t> received(options.gates, 0);
+
+    std::vector<double> errors;
+    double syncedAtUs = 0;
+    double nextSampleUs = 0;
+
+    while (world.trueNow() < 0)
+        usleep(1000);
+    if (gate == 0)
+        network.setRace(true, 1);
+
+    while (world.trueNow() < endUs)
+    {
+        network.update();
+        double now = world.trueNow();
+
+        // This gate's own crossings, once the pass is over
+        while (nextCrossing < crossings.size() && crossings[nextCrossing].first + PASS_DELAY_US <= now)
+        {
+            double at = crossings[nextCrossing].first;
+            int racer = crossings[nextCrossing].second;
+            if (gate == 0)
+            {
+                sectors += __builtin_popcount(board.add(racer, 0, world.local(0, at)));
+                received[0]++;
+            }
+            else if (network.racing())
+                network.report(racer, world.local(gate, at), 3);
+            nextCrossing++;
+        }
+
+        if (gate == 0)
+        {
+            TimingNetwork<LoopbackTransport>::Crossing crossing;
+            while (network.poll(crossing))
+            {
+                sectors += __builtin_popcount(board.add(crossing.racerId, crossing.gate, crossing.time));
+                received[crossing.gate]++;
+            }
+        }
+        else if (network.masterClock().synced() && now >= nextSampleUs)
+        {
+            if (!syncedAtUs)
+                syncedAtUs = now;
+            double error = (double)network.masterClock().toMaster(world.local(gate, now)) - world.local(0, now);
+            errors.push_back(std::abs(error));
+            nextSampleUs = now + 10000;
+        }
+        usleep(200);
+    }
+
+    bool ok = gate == 0 ? reportMaster(out, options, world, network, board, sectors, received)
+                        : reportSplit(out, options, gate, world, network, errors, syncedAtUs);
+    return ok ? 0 : 1;
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const char *arg = argv[i];
+        const char *value = argv[i + 1];
+        if (strcmp(arg, "--gates") == 0)
+            options.gates = atoi(value);
+        else if (strcmp(arg, "--seconds") == 0)
+            options.seconds = atof(value);
+        else if (strcmp(arg, "--racers") == 0)
+            options.racers = atoi(value);
+        else if (strcmp(arg, "--loss") == 0)
+            options.lossPercent = atof(value);
+        else if (strcmp(arg, "--jitter") == 0)
+            options.jitterUs = atof(value);
+        else if (strcmp(arg, "--drift") == 0)
+            options.driftPpm = atof(value);
+        else if (strcmp(arg, "--max-p99") == 0)
+            options.maxP99Us = atof(value);
+        else if (strcmp(arg, "--port") == 0)
+            options.port = atoi(value);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = atoi(value);
+        else if (strcmp(arg, "--gate") == 0)
+            options.gate = atoi(value);
+        else if (strcmp(arg, "--start") == 0)
+            options.startUs = strtoull(value, nullptr, 10);
+        else
+            return false;
+    }
+    return argc % 2 == 1 && options.gates >= 2 && options.gates <= SectorBoard::MAX_GATES &&
+           options.racers >= 1 && options.racers <= SectorBoard::MAX_RACERS && options.gate < options.gates;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--gates 2-4] [--seconds S] [--racers N] [--loss PERCENT] [--jitter US] "
+                        "[--drift PPM] [--max-p99 US] [--port P] [--seed N] [--gate N] [--start EPOCH_US]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (options.gate >= 0)
+    {
+        if (!options.startUs)
+            options.startUs = (epochUs() / 10000000 + 1) * 10000000;
+        return runGate(options.gate, options, stdout);
+    }
+
+    // All gates, each in its own process; reports come back through pipes
+    // so they print in gate order
+    options.startUs = epochUs() + 500000;
+    printf("%d gates, %d racers, %.0f s, loss %.0f%%, jitter %.0f us, drift up to %.0f ppm, clock p99 limit %.0f us\n\n",
+           options.gates, options.racers, options.seconds, options.lossPercent, options.jitterUs, options.driftPpm,
+           options.maxP99Us);
+    std::vector<int> pipes;
+    std::vector<pid_t> children;
+    for (int g = 0; g < options.gates; g++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return 1;
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+            FILE *out = fdopen(fds[1], "w");
+            int result = runGate(g, options, out);
+            fclose(out);
+            _exit(result);
+        }
+        close(fds[1]);
+        pipes.push_back(fds[0]);
+        children.push_back(pid);
+    }
+
+    int failed = 0;
+    for (int g = 0; g < options.gates; g++)
+    {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(pipes[g], buffer, sizeof(buffer))) > 0)
+            fwrite(buffer, 1, n, stdout);
+        close(pipes[g]);
+        int status;
+        waitpid(children[g], &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    printf("%s\n", failed ? "FAIL" : "PASS: every split within the clock limit, sectors within two gates of it");
+    return failed;
+}
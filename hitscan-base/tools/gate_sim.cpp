@@ -0,0 +1,294 @@
+// ============================================================================
+// Gate simulator (host)
+// ============================================================================
+// End-to-end regression benchmark for the detection path. Synthesised TSOP
+// output is driven onto a mocked GPIO pin, so the real IRCapture ISR, pulse
+// ring, IRPacketDecoder and PassAggregator run exactly as on the ESP32, polled
+// every 1ms like detectionTask. For each encoding and speed it reports:
+//
+//   detect   - share of racer passes that produced a crossing
+//   reads    - packets fused into each reported crossing
+//   phantom  - crossings per pass for racers that were not there
+//   err      - crossing time minus the true centre of the cone (µs); the mean
+//              includes the TSOP response delay
+//   cpu      - host time per pass spent in the ISR + decode + aggregation
+//
+// Build: g++ -std=c++17 -O2 -Imock -I../src gate_sim.cpp -o gate_sim
+//        (or: pio run -e native, binary in .pio/build/native/program)
+// Usage: ./gate_sim [--passes N] [--cone MM] [--speeds 100,150,200]
+//                   [--encodings v1,v2,compact] [--jitter US] [--glitches PER_MS]
+//                   [--racers N] [--spread MS] [--duty PERCENT] [--min-reads N]
+//                   [--seed N] [--csv]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "IRRacerDetector.hpp"
+#include "TsopModel.hpp"
+
+static constexpr uint8_t IR_PIN = 4;
+static constexpr uint64_t POLL_US = 1000;           // detectionTask tick
+static constexpr uint64_t PASS_PERIOD_US = 2000000; // Time between simulated passes
+
+struct Options
+{
+    int passes = 1000;
+    double coneMm = 200;
+    std::vector<double> speeds = {50, 100, 150, 200, 250, 300};
+    std::vector<Encoding> encodings = {Encoding::V1, Encoding::V2, Encoding::COMPACT};
+    ChannelParams channel;
+    int racers = 1;
+    double spreadMs = 5;
+    uint8_t duty = IR_MAX_DUTY_PERCENT;
+    uint8_t minReads = 1;
+    unsigned seed = 1234;
+    bool csv = false;
+};
+
+struct PointResult
+{
+    long racerPasses = 0;
+    long detected = 0;
+    long reads = 0;
+    long phantoms = 0;
+    std::vector<double> errors;
+    double cpuUs = 0;
+};
+
+static bool parseEncoding(const char *name, Encoding &encoding)
+{
+    const Encoding all[] = {Encoding::V1, Encoding::V2, Encoding::COMPACT};
+    for (Encoding candidate : all)
+    {
+        if (strcmp(name, encodingName(candidate)) == 0)
+        {
+            encoding = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--csv") == 0)
+        {
+            options.csv = true;
+            continue;
+        }
+        if (!value)
+            return false;
+        i++;
+
+        if (strcmp(arg, "--passes") == 0)
+            options.passes = atoi(value);
+        else if (strcmp(arg, "--cone") == 0)
+            options.coneMm = atof(value);
+        else if (strcmp(arg, "--jitter") == 0)
+            options.channel.jitterUs = atof(value);
+        else if (strcmp(arg, "--glitches") == 0)
+            options.channel.glitchesPerMs = atof(value);
+        else if (strcmp(arg, "--racers") == 0)
+            options.racers = atoi(value);
+        else if (strcmp(arg, "--spread") == 0)
+            options.spreadMs = atof(value);
+        else if (strcmp(arg, "--duty") == 0)
+            options.duty = atoi(value);
+        else if (strcmp(arg, "--min-reads") == 0)
+            options.minReads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = atoi(value);
+        else if (strcmp(arg, "--speeds") == 0 || strcmp(arg, "--encodings") == 0)
+        {
+            bool speeds = arg[2] == 's';
+            if (speeds)
+                options.speeds.clear();
+            else
+                options.encodings.clear();
+
+            char list[256];
+            snprintf(list, sizeof(list), "%s", value);
+            for (char *item = strtok(list, ","); item; item = strtok(nullptr, ","))
+            {
+                Encoding encoding;
+                if (speeds)
+                    options.speeds.push_back(atof(item));
+                else if (parseEncoding(item, encoding))
+                    options.encodings.push_back(encoding);
+                else
+                    return false;
+            }
+        }
+        else
+            return false;
+    }
+    return options.passes > 0 && options.racers >= 1 && options.racers <= 8 &&
+           !options.speeds.empty() && !options.encodings.empty();
+}
+
+static PointResult runPoint(const Options &options, Encoding encoding, double kmh, std::mt19937 &rng)
+{
+    PointResult result;
+    double windowUs = options.coneMm / (kmh / 3.6) * 1000.0;
+
+    MockHal::setTimeNs(0);
+    MockHal::writePin(IR_PIN, HIGH);
+    IRRacerDetector detector(IR_PIN);
+    PassAggregator::Config config;
+    config.minReads = options.minReads;
+    detector.configurePasses(config);
+    detector.begin();
+
+    uint64_t nextPollUs = POLL_US;
+    uint64_t passStartUs = PASS_PERIOD_US;
+    uint8_t ids[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    double centreUs[8];
+    bool seen[8];
+
+    auto poll = [&](uint64_t untilUs)
+    {
+        for (; nextPollUs <= untilUs; nextPollUs += POLL_US)
+        {
+            MockHal::setTimeNs(nextPollUs * 1000);
+            IRRacerDetector::Crossing crossing;
+            while (detector.poll(crossing))
+            {
+                int r = 0;
+                while (r < options.racers && ids[r] != crossing.racerId)
+                    r++;
+                if (r == options.racers || seen[r])
+                {
+                    result.phantoms++;
+                    continue;
+                }
+                seen[r] = true;
+                result.detected++;
+                result.reads += crossing.reads;
+                result.errors.push_back((double)crossing.timestamp - centreUs[r]);
+            }
+        }
+    };
+
+    for (int p = 0; p < options.passes; p++, passStartUs += PASS_PERIOD_US)
+    {
+        std::shuffle(ids, ids + 8, rng);
+        std::uniform_real_distribution<double> enter(0, options.spreadMs * 1000.0);
+        std::vector<Edge> edges;
+        double endUs = 0;
+
+        for (int r = 0; r < options.racers; r++)
+        {
+            double enterUs = options.racers > 1 ? enter(rng) : 0;
+            double periodUs = packetDuration(encoding, ids[r]) * 100.0 / options.duty;
+            std::uniform_real_distribution<double> phase(0, periodUs * 64);
+            addTransmitter(edges, rng, encoding, ids[r], phase(rng), windowUs, options.channel,
+                           options.duty, enterUs);
+            centreUs[r] = passStartUs + enterUs + windowUs / 2;
+            seen[r] = false;
+            endUs = std::max(endUs, enterUs + windowUs);
+        }
+        addGlitches(edges, rng, endUs, options.channel);
+        edges = receiverOutput(edges, endUs);
+
+        auto begin = std::chrono::steady_clock::now();
+
+        // Skip the idle/far-future sentinels: the pin idles high and the
+        // last gap is closed by whatever edge comes next
+        uint64_t lastNs = passStartUs * 1000;
+        for (size_t i = 1; i + 1 < edges.size(); i++)
+        {
+            uint64_t atNs = (uint64_t)std::max<double>(passStartUs * 1000.0 + edges[i].time * 1000.0, lastNs);
+            poll(atNs / 1000);
+            MockHal::setTimeNs(atNs);
+            MockHal::writePin(IR_PIN, edges[i].level);
+            lastNs = atNs;
+        }
+        MockHal::writePin(IR_PIN, HIGH);
+        poll(passStartUs + (uint64_t)endUs + config.gapUs + 2 * POLL_US);
+
+        result.cpuUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+        result.racerPasses += options.racers;
+
+        // Idle until the next pass is due
+        nextPollUs = std::max(nextPollUs, passStartUs + PASS_PERIOD_US - POLL_US);
+    }
+
+    detector.edges().end();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0;
+    for (double &v : values)
+        v = std::fabs(v);
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(fraction * values.size()))];
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--passes N] [--cone MM] [--speeds 100,150,200] "
+                        "[--encodings v1,v2,compact] [--jitter US] [--glitches PER_MS] "
+                        "[--racers N] [--spread MS] [--duty PERCENT] [--min-reads N] [--seed N] [--csv]\n",
+                argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+
+    if (options.csv)
+        printf("encoding,kmh,window_ms,racers,passes,detect_pct,reads_avg,phantom_per_pass,"
+               "err_mean_us,err_p95_us,err_max_us,cpu_us_per_pass\n");
+    else
+    {
+        printf("cone %.0fmm, jitter %.0fus, %.2f glitches/ms, %d racer(s) within %.1fms, "
+               "%u%% duty, min %u reads, %d passes per point\n\n",
+               options.coneMm, options.channel.jitterUs, options.channel.glitchesPerMs, options.racers,
+               options.spreadMs, options.duty, options.minReads, options.passes);
+        printf("%-8s %5s %7s | %7s %6s %8s | %9s %8s %8s | %8s\n", "encoding", "km/h", "window",
+               "detect", "reads", "phantom", "err mean", "err p95", "err max", "cpu/pass");
+    }
+
+    for (Encoding encoding : options.encodings)
+    {
+        for (double kmh : options.speeds)
+        {
+            PointResult r = runPoint(options, encoding, kmh, rng);
+            double windowMs = options.coneMm / (kmh / 3.6);
+            double detect = 100.0 * r.detected / r.racerPasses;
+            double reads = r.detected ? (double)r.reads / r.detected : 0;
+            double phantom = (double)r.phantoms / options.passes;
+            double mean = 0;
+            for (double e : r.errors)
+                mean += e;
+            mean = r.errors.empty() ? 0 : mean / r.errors.size();
+            double p95 = percentile(r.errors, 0.95);
+            double max = percentile(r.errors, 1.0);
+            double cpu = r.cpuUs / options.passes;
+
+            if (options.csv)
+                printf("%s,%.0f,%.2f,%d,%d,%.2f,%.2f,%.4f,%.1f,%.1f,%.1f,%.2f\n", encodingName(encoding),
+                       kmh, windowMs, options.racers, options.passes, detect, reads, phantom, mean, p95,
+                       max, cpu);
+            else
+                printf("%-8s %5.0f %5.1fms | %6.1f%% %6.2f %8.3f | %7.0fus %6.0fus %6.0fus | %6.1fus\n",
+                       encodingName(encoding), kmh, windowMs, detect, reads, phantom, mean, p95, max, cpu);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+// ============================================================================
+// Journal power-loss simulator (host)
+// ============================================================================
+// Records a synthetic session (mode change, two races, lap and race mode,
+// personal bests carried over) as the firmware journals it, then cuts the
+// journal at every byte offset - as if power failed mid-write - and
+// replays each cut:
+//
+//   clean  - the file simply ends at the cut
+//   torn   - the bytes after the cut up to the end of that entry are junk
+//            (a partially programmed sector)
+//
+// Every replay must restore exactly the state of the complete entries
+// before the cut, keep exactly those bytes, and accept new appends after
+// truncation. The last race on its own, as the firmware rewrites the file,
+// must restore the live state, personal best laps and runs included. Also
+// times a replay of a full MAX_BYTES journal.
+//
+// Build: g++ -std=c++17 -O2 -I../src journal_sim.cpp -o journal_sim
+// Usage: ./journal_sim [laps] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "Journal.hpp"
+
+using Bytes = std::vector<uint8_t>;
+
+static void append(Bytes &bytes, const Journal::Entry &entry)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&entry);
+    bytes.insert(bytes.end(), p, p + sizeof(entry));
+}
+
+struct Restored
+{
+    size_t validBytes = 0;
+    bool active = false;
+    uint64_t elapsedUs = 0;
+    uint64_t fingerprint = 0;
+};
+
+static void mix(uint64_t &hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x100000001B3ull;
+}
+
+// Everything a client or the loop could observe after a resume
+static uint64_t fingerprint(const RaceState &race)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    mix(hash, (uint64_t)race.getMode());
+    mix(hash, race.raceNumber());
+    mix(hash, race.lastSeq());
+    mix(hash, race.fastestLap());
+    mix(hash, race.fastestLapRacer());
+    for (uint8_t i = 0; i < race.finishers(); i++)
+    {
+        const RaceState::Result &r = race.result(i);
+        mix(hash, r.racerId);
+        mix(hash, r.timestamp);
+        mix(hash, r.position);
+        mix(hash, r.seq);
+    }
+    for (uint8_t r = 0; r < RaceState::MAX_RACERS; r++)
+    {
+        mix(hash, race.personalBest(r));
+        mix(hash, race.personalBestRun(r));
+        mix(hash, race.lapsRecorded(r));
+        mix(hash, race.lastCrossing(r));
+        const LapStats &stats = race.lapStats(r);
+        mix(hash, stats.laps());
+        mix(hash, stats.bestRun());
+        mix(hash, stats.mean());
+        mix(hash, stats.median());
+    }
+    race.forEachLap([&](const RaceState::Lap &lap)
+                    {
+        mix(hash, lap.lapTime);
+        mix(hash, lap.seq);
+        mix(hash, lap.number); });
+    return hash;
+}
+
+// What JournalStore::begin() does with a file
+static Restored replay(const Bytes &bytes)
+{
+    RaceState race;
+    race.begin();
+    Journal::Replay replay(race);
+    Restored restored;
+
+    for (size_t at = 0; at + sizeof(Journal::Entry) <= bytes.size(); at += sizeof(Journal::Entry))
+    {
+        Journal::Entry entry;
+        memcpy(&entry, bytes.data() + at, sizeof(entry));
+        if (!replay.apply(entry))
+            break;
+        restored.validBytes = at + sizeof(entry);
+    }
+    restored.active = replay.active;
+    restored.elapsedUs = replay.elapsedUs;
+    restored.fingerprint = fingerprint(race);
+    return restored;
+}
+
+// The session as the firmware would journal it, driving a live RaceState.
+// The firmware's file holds only the last race, from lastStart on.
+static Bytes recordSession(int laps, std::mt19937 &rng, size_t &lastStart, uint64_t &liveFingerprint)
+{
+    Bytes bytes;
+    RaceState live;
+    live.begin();
+    std::uniform_int_distribution<int> racer(0, 7);
+    std::normal_distribution<double> lap(20e6, 3e6);
+
+    auto startRace = [&](RaceState::Mode mode)
+    {
+        live.setMode(mode);
+        live.reset();
+        lastStart = bytes.size();
+        append(bytes, Journal::start(live.raceNumber(), live.lastSeq(), live.getMode()));
+        for (uint8_t r = 0; r < RaceState::MAX_RACERS; r++)
+        {
+            if (live.personalBest(r) != RaceState::NO_TIME)
+                append(bytes, Journal::best(r, live.personalBest(r)));
+            if (live.personalBestRun(r) != RaceState::NO_TIME)
+                append(bytes, Journal::bestRun(r, live.personalBestRun(r)));
+        }
+    };
+
+    append(bytes, Journal::mode(RaceState::Mode::LAP_TIMER));
+
+    // Race 1: lap practice, stopped
+    startRace(RaceState::Mode::LAP_TIMER);
+    uint64_t clock = 0;
+    for (int i = 0; i < laps; i++)
+    {
+        clock += (uint64_t)std::max(2e6, lap(rng)) / 8;
+        uint8_t r = racer(rng);
+        live.record(r, clock, 3);
+        append(bytes, Journal::crossing(r, clock, 3));
+    }
+    append(bytes, Journal::stop(clock + 1000000));
+
+    // Race 2: race mode, cut off while running (ticks while quiet)
+    startRace(RaceState::Mode::RACE);
+    clock = 0;
+    for (int i = 0; i < 12; i++)
+    {
+        clock += 4000000;
+        if (i % 3 == 2)
+        {
+            append(bytes, Journal::tick(clock));
+            continue;
+        }
+        uint8_t r = racer(rng);
+        RaceState::Update update = live.record(r, clock, 2);
+        if (update.outcome != RaceState::Outcome::ALREADY_FINISHED)
+            append(bytes, Journal::crossing(r, clock, 2));
+    }
+    liveFingerprint = fingerprint(live);
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    int laps = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned seed = argc > 2 ? atoi(argv[2]) : 7;
+    std::mt19937 rng(seed);
+
+    size_t lastStart;
+    uint64_t liveFingerprint;
+    Bytes journal = recordSession(laps, rng, lastStart, liveFingerprint);
+    const size_t ENTRY = sizeof(Journal::Entry);
+    size_t entries = journal.size() / ENTRY;
+    printf("session: %zu entries (%zu bytes)\n", entries, journal.size());
+
+    // Reference state after each whole-entry prefix
+    std::vector<Restored> expected(entries + 1);
+    for (size_t k = 0; k <= entries; k++)
+        expected[k] = replay(Bytes(journal.begin(), journal.begin() + k * ENTRY));
+
+    // The last race as rewritten at its start must restore what was live,
+    // bests from the race before included
+    bool restoresLive = replay(Bytes(journal.begin() + lastStart, journal.end())).fingerprint == liveFingerprint;
+    printf("last race alone restores the live state: %s\n", restoresLive ? "yes" : "NO");
+
+    long cuts = 0, failures = 0;
+    std::uniform_int_distribution<int> junk(0, 255);
+    for (size_t cut = 0; cut <= journal.size(); cut++)
+    {
+        const Restored &want = expected[cut / ENTRY];
+        for (int torn = 0; torn < 2; torn++)
+        {
+            Bytes file(journal.begin(), journal.begin() + cut);
+            // The first torn byte differs from the one written, or a lucky
+            // junk byte would complete the entry
+            if (torn && file.size() % ENTRY)
+                file.push_back(journal[cut] ^ (uint8_t)(1 + junk(rng) % 255));
+            if (torn)
+                while (file.size() % ENTRY)
+                    file.push_back(junk(rng));
+
+            Restored got = replay(file);
+            bool ok = got.validBytes == want.validBytes && got.fingerprint == want.fingerprint &&
+                      got.active == want.active && got.elapsedUs == want.elapsedUs;
+
+            // Truncate, resume and keep journaling: the new entry must count
+            file.resize(got.validBytes);
+            append(file, Journal::tick(got.elapsedUs + 1));
+            ok = ok && replay(file).validBytes == file.size();
+
+            cuts++;
+            if (!ok)
+            {
+                failures++;
+                if (failures <= 10)
+                    printf("FAIL cut %zu%s: kept %zu (want %zu)\n", cut, torn ? " torn" : "", got.validBytes,
+                           want.validBytes);
+            }
+        }
+    }
+    printf("power cut at every byte offset, clean and torn: %ld replays, %ld failures\n", cuts, failures);
+
+    // Replay time bound: a full journal of crossings
+    Bytes full;
+    append(full, Journal::start(1, 0, RaceState::Mode::LAP_TIMER));
+    for (uint64_t i = 1; full.size() < Journal::MAX_BYTES; i++)
+        append(full, Journal::crossing(i % 8, i * 3000000, 2));
+    auto start = std::chrono::steady_clock::now();
+    Restored big = replay(full);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("full journal: %zu entries replayed in %.2f ms on this host (%s)\n", big.validBytes / ENTRY, ms,
+           big.validBytes == full.size() ? "all valid" : "INCOMPLETE");
+
+    return failures == 0 && restoresLive && big.validBytes == full.size() ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// ============================================================================
+// LED engine benchmark (host)
+// ============================================================================
+// Drives LedEngine through a few minutes of simulated race time per
+// scenario at LEDRing's frame rate and reports the render cost per frame
+// and how many frames actually changed (the only ones LEDRing sends).
+// For comparison it prints what the old LEDRing spent with interrupts off:
+// it bit-banged a show() on every loop() pass while a pulse ran, about
+// 30 us per LED plus the 50 us latch.
+//
+//   idle     - status colour only
+//   laps     - 4 racers, one crossing every few seconds
+//   pack     - 8 racers crossing within 300 ms of each other every 15 s
+//   storm    - a crossing every 50 ms, random racer
+//
+// --dump <scenario> prints every changed frame as CSV (time, then one hex
+// RGB per LED) to check the animation by eye or diff it.
+//
+// Build: g++ -std=c++17 -O2 -I../src led_bench.cpp -o led_bench
+// Usage: ./led_bench [leds] [loop_hz]
+//        ./led_bench --dump pack [leds] > frames.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "LedEngine.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t FRAME_MS = 20; // LEDRing::FRAME_MS
+static const uint32_t RUN_MS = 5 * 60 * 1000;
+
+static const LedEngine::Pixel COLORS[8] = {{255, 0, 0},   {0, 255, 0},   {0, 0, 255},   {255, 255, 0},
+                                           {255, 0, 255}, {0, 255, 255}, {255, 128, 0}, {128, 0, 255}};
+
+// Crossing times (ms, racer) for a scenario
+static std::vector<std::pair<uint32_t, uint8_t>> crossings(const char *scenario)
+{
+    std::vector<std::pair<uint32_t, uint8_t>> list;
+    std::mt19937 rng(3);
+    if (!strcmp(scenario, "laps"))
+    {
+        for (uint8_t r = 0; r < 4; r++)
+            for (uint32_t t = 1000 + r * 700; t < RUN_MS; t += 9000 + rng() % 3000)
+                list.push_back({t, r});
+    }
+    else if (!strcmp(scenario, "pack"))
+    {
+        for (uint32_t t = 1000; t < RUN_MS; t += 15000)
+            for (uint8_t r = 0; r < 8; r++)
+                list.push_back({t + rng() % 300, r});
+    }
+    else if (!strcmp(scenario, "storm"))
+    {
+        for (uint32_t t = 0; t < RUN_MS; t += 50)
+            list.push_back({t, (uint8_t)(rng() % 8)});
+    }
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+struct Result
+{
+    long frames = 0;
+    long changed = 0;
+    long pulsingMs = 0; // Time with at least one pulse running
+    double renderNs = 0;
+};
+
+static Result run(const char *scenario, uint16_t leds, FILE *dump)
+{
+    LedEngine engine(leds);
+    engine.setBrightness(50);
+    engine.setBase({0, 100, 0});
+    auto list = crossings(scenario);
+    size_t next = 0;
+    uint32_t pulseUntil = 0;
+    Result result;
+
+    for (uint32_t now = 0; now < RUN_MS; now += FRAME_MS)
+    {
+        while (next < list.size() && list[next].first <= now)
+        {
+            engine.pulse(list[next].second, COLORS[list[next].second], list[next].first);
+            pulseUntil = list[next].first + LedEngine::PULSE_MS;
+            next++;
+        }
+        if (now < pulseUntil)
+            result.pulsingMs += FRAME_MS;
+
+        auto start = Clock::now();
+        bool changed = engine.render(now);
+        result.renderNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        result.frames++;
+        if (!changed)
+            continue;
+
+        engine.markShown();
+        result.changed++;
+        if (dump)
+        {
+            fprintf(dump, "%u", now);
+            for (uint16_t i = 0; i < engine.size(); i++)
+            {
+                const LedEngine::Pixel &p = engine.pixels()[i];
+                fprintf(dump, ",%02x%02x%02x", p.r, p.g, p.b);
+            }
+            fprintf(dump, "\n");
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && !strcmp(argv[1], "--dump"))
+    {
+        run(argv[2], argc > 3 ? atoi(argv[3]) : 16, stdout);
+        return 0;
+    }
+
+    uint16_t leds = argc > 1 ? atoi(argv[1]) : 16;
+    double loopHz = argc > 2 ? atof(argv[2]) : 1000;
+    double showUs = leds * 30.0 + 50; // WS2812 at 800 kHz, 24 bits per LED
+
+    printf("%u LEDs, %u ms frames, %u s per scenario; old show() %.0f us at a %.0f Hz loop\n\n", leds, FRAME_MS,
+           RUN_MS / 1000, showUs, loopHz);
+    printf("%-6s %9s %9s %8s %12s %16s\n", "", "frames", "sent", "sent %", "render ns", "old irq-off ms/s");
+    for (const char *scenario : {"idle", "laps", "pack", "storm"})
+    {
+        Result r = run(scenario, leds, nullptr);
+        // Old LEDRing: one show() per loop() pass while pulsing
+        double oldShows = r.pulsingMs / 1000.0 * loopHz;
+        printf("%-6s %9ld %9ld %7.1f%% %12.1f %16.1f\n", scenario, r.frames, r.changed,
+               100.0 * r.changed / r.frames, r.renderNs / r.frames, oldShows * showUs / 1000.0 / (RUN_MS / 1000.0));
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# ============================================================================
+# Web load test (against a running base station)
+# ============================================================================
+# N clients fetch /results in a loop for a fixed time, like browsers that
+# lost their event stream and fell back to polling. Prints requests per
+# second and the longest gap between update() calls on the base station
+# (/decoder loopMaxGapUs, reset by the first fetch) - that is the LED and
+# race loop jitter caused by the load.
+#
+# Usage: tools/load_test.sh [host] [clients] [seconds]
+
+HOST=${1:-racetimer.local}
+CLIENTS=${2:-10}
+DURATION=${3:-20}
+
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+curl -s "http://$HOST/decoder" > /dev/null || { echo "cannot reach $HOST"; exit 1; }
+
+END=$(($(date +%s) + DURATION))
+i=0
+while [ $i -lt "$CLIENTS" ]; do
+    (
+        n=0
+        while [ "$(date +%s)" -lt $END ]; do
+            curl -s -o /dev/null "http://$HOST/results?since=0" && n=$((n + 1))
+        done
+        echo $n > "$OUT/$i"
+    ) &
+    i=$((i + 1))
+done
+wait
+
+TOTAL=$(cat "$OUT"/* | awk '{ s += $1 } END { print s }')
+GAP=$(curl -s "http://$HOST/decoder" | sed -n 's/.*"loopMaxGapUs":\([0-9]*\).*/\1/p')
+echo "$CLIENTS clients, ${DURATION}s: $TOTAL requests, $((TOTAL / DURATION)) req/s, loop max gap ${GAP}us"
@@ -0,0 +1,210 @@
+// ============================================================================
+// Race logger benchmark (host)
+// ============================================================================
+// Runs the RaceLog block pipeline in real time: a 1ms "loop" logs lap
+// crossings while a writer thread drains blocks to a simulated SD card with
+// realistic latency (mostly a few ms per sector, with occasional long
+// stalls while the card erases). Reports what logging costs the loop:
+//
+//   double-buffered - RaceLog::append()/update() as used by RaceLogger
+//   blocking        - one card write inline per crossing (the old
+//                     SD.open/append/close in logToSD)
+//
+// and checks every record that was not dropped reached the card in order.
+//
+// Build: g++ -std=c++17 -O2 -pthread -I../src logger_bench.cpp -o logger_bench
+// Usage: ./logger_bench [crossings] [crossings_per_s] [stall_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "RaceLog.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Write latency of a cheap microSD card over SPI (assumed model): a sector
+// usually takes 1-3ms, one write in 50 hits an erase and stalls
+struct SimulatedCard
+{
+    std::vector<uint8_t> data;
+    std::mt19937 rng{99};
+    double stallMs;
+
+    explicit SimulatedCard(double stallMs) : stallMs(stallMs) {}
+
+    void write(const uint8_t *bytes, size_t length)
+    {
+        std::uniform_real_distribution<double> normal(1.0, 3.0);
+        std::uniform_int_distribution<int> stall(0, 49);
+        double ms = stall(rng) == 0 ? stallMs : normal(rng);
+        std::this_thread::sleep_for(std::chrono::microseconds((long)(ms * 1000)));
+        data.insert(data.end(), bytes, bytes + length);
+    }
+};
+
+struct Stats
+{
+    std::vector<double> perCallNs;
+    std::vector<double> perTickUs;
+    long overruns = 0; // Ticks where logging alone took longer than the tick
+
+    static double at(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(fraction * values.size()))];
+    }
+
+    void print(const char *name) const
+    {
+        printf("%-16s | %9.0f %9.0f %11.0f | %9.1f %9.1f %10.1f | %8ld\n", name, at(perCallNs, 0.5),
+               at(perCallNs, 0.99), at(perCallNs, 1.0), at(perTickUs, 0.5), at(perTickUs, 0.99),
+               at(perTickUs, 1.0), overruns);
+    }
+};
+
+static RaceLog::Record crossing(int i)
+{
+    return {RaceLog::Type::LAP, (uint8_t)(i % 8), 3, 0, 1, (uint64_t)i * 1000};
+}
+
+// Drive a 1ms loop for `count` crossings at `rate` per second; log(i) is
+// timed per call, tick() once per loop iteration
+template <typename Log, typename Tick>
+static Stats runLoop(int count, double rate, Log log, Tick tick)
+{
+    Stats stats;
+    Clock::time_point start = Clock::now();
+    Clock::time_point next = start;
+    int sent = 0;
+
+    while (sent < count)
+    {
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        int due = std::min(count, (int)(elapsed * rate));
+
+        Clock::time_point tickStart = Clock::now();
+        for (; sent < due; sent++)
+        {
+            Clock::time_point callStart = Clock::now();
+            log(sent);
+            stats.perCallNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - callStart).count());
+        }
+        tick();
+        double tickUs = std::chrono::duration<double, std::micro>(Clock::now() - tickStart).count();
+        stats.perTickUs.push_back(tickUs);
+        if (tickUs > 1000)
+            stats.overruns++;
+    }
+    return stats;
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    double rate = argc > 2 ? atof(argv[2]) : 400;
+    double stallMs = argc > 3 ? atof(argv[3]) : 200;
+
+    printf("%d crossings at %.0f/s, card: 1-3ms per sector, %.0fms stall 1 write in 50\n\n", count, rate,
+           stallMs);
+    printf("%-16s | %9s %9s %11s | %9s %9s %10s | %8s\n", "", "call p50", "call p99", "call max",
+           "tick p50", "tick p99", "tick max", "overruns");
+    printf("%-16s | %9s %9s %11s | %9s %9s %10s | %8s\n", "", "ns", "ns", "ns", "us", "us", "us", ">1ms");
+
+    // Double-buffered: loop appends, writer thread drains
+    RaceLog log;
+    log.setFlushInterval(RaceLog::FLUSH_INTERVAL_MS);
+    SimulatedCard card(stallMs);
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool notified = false;
+    std::atomic<bool> done{false};
+
+    std::thread writer([&]
+                       {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return notified || done; });
+                notified = false;
+            }
+            log.drain([&](const uint8_t *data, size_t length) { card.write(data, length); });
+            if (done)
+                return;
+        } });
+
+    auto notify = [&]
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            notified = true;
+        }
+        wake.notify_one();
+    };
+
+    Clock::time_point loopStart = Clock::now();
+    auto nowMs = [&]
+    { return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - loopStart).count(); };
+    Stats buffered = runLoop(
+        count, rate,
+        [&](int i)
+        {
+            if (log.append(crossing(i), nowMs()))
+                notify();
+        },
+        [&]
+        {
+            if (log.update(nowMs()))
+                notify();
+        });
+    log.flush();
+    done = true;
+    notify();
+    writer.join();
+    buffered.print("double-buffered");
+
+    // Blocking: every crossing waits for the card
+    SimulatedCard blockingCard(stallMs);
+    Stats blocking = runLoop(
+        count / 4, rate,
+        [&](int i)
+        {
+            RaceLog::Record record = crossing(i);
+            blockingCard.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+        },
+        [] {});
+    blocking.print("blocking (1/4)");
+
+    // Everything not dropped is on the card, in order
+    int expected = 0;
+    bool ordered = true;
+    const RaceLog::Record *records = reinterpret_cast<const RaceLog::Record *>(card.data.data());
+    size_t total = card.data.size() / sizeof(RaceLog::Record);
+    for (size_t i = 0; i < total; i++)
+    {
+        if (records[i].type != RaceLog::Type::LAP)
+            continue;
+        if (records[i].timestamp < (uint64_t)expected * 1000)
+            ordered = false;
+        expected = records[i].timestamp / 1000 + 1;
+    }
+    long onCard = 0;
+    for (size_t i = 0; i < total; i++)
+        onCard += records[i].type == RaceLog::Type::LAP;
+
+    printf("\n%ld of %d records on card (%u dropped), %u blocks, in order: %s\n", onCard, count,
+           log.recordsDropped(), log.blocksWritten(), ordered ? "yes" : "NO");
+    return onCard + log.recordsDropped() == (long)count && ordered ? 0 : 1;
+}
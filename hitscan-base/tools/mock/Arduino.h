@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MockHal.hpp"
+#include "esp_timer.h"
+
+#define IRAM_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define CHANGE 0x03
+
+class EspClass
+{
+public:
+    uint32_t getCycleCount() { return (uint32_t)(MockHal::nowNs * MockHal::cpuMhz / 1000); }
+};
+
+inline EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz() { return MockHal::cpuMhz; }
+inline unsigned long micros() { return (unsigned long)MockHal::timeUs(); }
+inline unsigned long millis() { return (unsigned long)(MockHal::timeUs() / 1000); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t pin) { return MockHal::readPin(pin); }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int)
+{
+    if (pin < MockHal::PIN_COUNT)
+        MockHal::interrupts[pin] = {handler, arg};
+}
+
+inline void detachInterrupt(uint8_t pin)
+{
+    if (pin < MockHal::PIN_COUNT)
+        MockHal::interrupts[pin] = {};
+}
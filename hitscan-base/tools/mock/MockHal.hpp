@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// Mock HAL (host builds)
+// ============================================================================
+// Just enough of the ESP32 Arduino core for IRCapture/IRRacerDetector to
+// build and run on a PC. Time is a simulated clock the caller advances, and
+// writing the IR pin fires the attached CHANGE interrupt exactly as the GPIO
+// would, so the real capture ISR, ring, decoder and aggregator all run
+// unmodified.
+
+struct gpio_dev_t
+{
+    uint32_t in; // GPIO 0-31
+    struct
+    {
+        uint32_t data; // GPIO 32-39
+    } in1;
+};
+
+inline gpio_dev_t GPIO = {0xFFFFFFFF, {0xFF}};
+
+namespace MockHal
+{
+    static constexpr uint8_t PIN_COUNT = 40;
+
+    struct Interrupt
+    {
+        void (*handler)(void *) = nullptr;
+        void *arg = nullptr;
+    };
+
+    inline uint64_t nowNs = 0;
+    inline uint32_t cpuMhz = 240;
+    inline Interrupt interrupts[PIN_COUNT];
+
+    inline void setTimeNs(uint64_t ns) { nowNs = ns; }
+    inline uint64_t timeUs() { return nowNs / 1000; }
+
+    inline uint8_t readPin(uint8_t pin)
+    {
+        if (pin < 32)
+            return (GPIO.in >> pin) & 1;
+        return (GPIO.in1.data >> (pin - 32)) & 1;
+    }
+
+    // Drive an input at the current time; a change fires its interrupt
+    inline void writePin(uint8_t pin, uint8_t level)
+    {
+        if (pin >= PIN_COUNT || readPin(pin) == (level ? 1 : 0))
+            return;
+
+        uint32_t &reg = pin < 32 ? GPIO.in : GPIO.in1.data;
+        uint32_t bit = 1u << (pin < 32 ? pin : pin - 32);
+        reg = level ? (reg | bit) : (reg & ~bit);
+
+        if (interrupts[pin].handler)
+            interrupts[pin].handler(interrupts[pin].arg);
+    }
+}
@@ -0,0 +1,203 @@
+// ============================================================================
+// Pass aggregator check (host)
+// ============================================================================
+// Feeds scripted packet streams to PassAggregator the way the detection
+// task does (packets in time order, poll() between them) and checks the
+// crossings that come out:
+//
+//   merge       - the packets of one pass fuse into one crossing at their
+//                 median, with every packet counted
+//   gap split   - a silence of gapUs ends the pass: two groups of packets
+//                 are two crossings, a silence just short of it is not
+//   hover       - a transmitter parked in the gate is cut off every
+//                 maxPassUs and reports while still hovering
+//   interleaved - two racers in the gate at once keep separate passes,
+//                 reported earliest first
+//   min reads   - with minReads 2 a lone decode is dropped and counted
+//
+// Build: g++ -std=c++17 -O2 -I../src pass_check.cpp -o pass_check
+// Usage: ./pass_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "PassAggregator.hpp"
+
+struct Packet
+{
+    uint8_t racerId;
+    uint64_t timestamp;
+};
+
+static const uint64_t T0 = 1000000; // Keeps every time positive
+static const uint64_t POLL_US = 1000;
+
+static int failures = 0;
+
+static void check(bool ok, const char *scenario, const char *what)
+{
+    if (!ok)
+    {
+        failures++;
+        printf("FAIL %s: %s\n", scenario, what);
+    }
+}
+
+// Packets every intervalUs from start to end (inclusive), relative to T0
+static void addRun(std::vector<Packet> &packets, uint8_t racerId, uint64_t startUs, uint64_t endUs,
+                   uint64_t intervalUs)
+{
+    for (uint64_t t = startUs; t <= endUs; t += intervalUs)
+        packets.push_back({racerId, T0 + t});
+}
+
+struct Reported
+{
+    PassAggregator::Crossing crossing;
+    uint64_t at; // When the aggregator gave it out
+};
+
+// Packets in time order, polled every POLL_US, then polled until idle
+static std::vector<Reported> run(PassAggregator &passes, std::vector<Packet> packets)
+{
+    std::stable_sort(packets.begin(), packets.end(),
+                     [](const Packet &a, const Packet &b) { return a.timestamp < b.timestamp; });
+
+    std::vector<Reported> out;
+    PassAggregator::Crossing crossing;
+    size_t next = 0;
+    uint64_t end = packets.empty() ? T0 : packets.back().timestamp + 2 * passes.getConfig().gapUs;
+    for (uint64_t now = T0; now <= end; now += POLL_US)
+    {
+        for (; next < packets.size() && packets[next].timestamp <= now; next++)
+        {
+            if (passes.add(packets[next].racerId, packets[next].timestamp, crossing))
+                out.push_back({crossing, now});
+        }
+        while (passes.poll(now, crossing))
+            out.push_back({crossing, now});
+    }
+    return out;
+}
+
+static void print(const char *scenario, const std::vector<Reported> &out)
+{
+    printf("%-12s", scenario);
+    for (const Reported &r : out)
+        printf(" | racer %u at %+lldus, %u reads", r.crossing.racerId,
+               (long long)(r.crossing.timestamp - T0), r.crossing.reads);
+    printf("\n");
+}
+
+int main()
+{
+    PassAggregator::Config config; // Firmware defaults: 100ms gap, 500ms cap
+    const uint64_t gap = config.gapUs;
+
+    // One pass: 9 packets 2ms apart fuse into one crossing at their median
+    {
+        PassAggregator passes;
+        passes.configure(config);
+        std::vector<Packet> packets;
+        addRun(packets, 3, 10000, 26000, 2000);
+        std::vector<Reported> out = run(passes, packets);
+        print("merge", out);
+        check(out.size() == 1, "merge", "one crossing");
+        if (out.size() == 1)
+        {
+            check(out[0].crossing.racerId == 3, "merge", "racer ID kept");
+            check(out[0].crossing.timestamp == T0 + 18000, "merge", "time is the median packet");
+            check(out[0].crossing.reads == 9, "merge", "every packet counted");
+            check(out[0].at >= T0 + 26000 + gap && out[0].at < T0 + 26000 + gap + 2 * POLL_US, "merge",
+                  "reported one gap after the last packet");
+        }
+    }
+
+    // Two passes one gap apart, and two groups just short of a gap apart
+    {
+        PassAggregator passes;
+        passes.configure(config);
+        std::vector<Packet> packets;
+        addRun(packets, 2, 0, 8000, 2000);
+        addRun(packets, 2, 8000 + gap, 8000 + gap + 4000, 2000);
+        std::vector<Reported> out = run(passes, packets);
+        print("gap split", out);
+        check(out.size() == 2, "gap split", "a gap of silence splits the pass");
+        if (out.size() == 2)
+        {
+            check(out[0].crossing.timestamp == T0 + 4000 && out[0].crossing.reads == 5, "gap split",
+                  "first pass keeps its own packets");
+            check(out[1].crossing.timestamp == T0 + 8000 + gap + 2000 && out[1].crossing.reads == 3,
+                  "gap split", "second pass keeps its own packets");
+        }
+
+        passes.reset();
+        packets.clear();
+        addRun(packets, 2, 0, 8000, 2000);
+        addRun(packets, 2, 8000 + gap - 1, 8000 + gap - 1, 2000);
+        out = run(passes, packets);
+        print("no split", out);
+        check(out.size() == 1 && out[0].crossing.reads == 6, "no split", "a shorter silence keeps one pass");
+    }
+
+    // Hovering for 2s, a packet every 2ms: cut into passes of maxPassUs
+    {
+        PassAggregator passes;
+        passes.configure(config);
+        std::vector<Packet> packets;
+        addRun(packets, 6, 0, 2000000, 2000);
+        std::vector<Reported> out = run(passes, packets);
+        print("hover", out);
+        check(out.size() == 4, "hover", "cut every maxPassUs");
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            check(out[i].crossing.racerId == 6, "hover", "racer ID kept");
+            if (i + 1 < out.size())
+                check(out[i].at <= T0 + (i + 1) * (config.maxPassUs + 2000) + POLL_US, "hover",
+                      "reported while still hovering");
+        }
+        if (!out.empty())
+            check(out[0].crossing.timestamp == T0 + config.maxPassUs / 2 && out[0].crossing.reads == 251,
+                  "hover", "first cut spans maxPassUs, timed at its midpoint");
+    }
+
+    // Racer 1 and racer 5 in the gate together, packets alternating
+    {
+        PassAggregator passes;
+        passes.configure(config);
+        std::vector<Packet> packets;
+        addRun(packets, 5, 3000, 23000, 2000);
+        addRun(packets, 1, 0, 16000, 2000);
+        std::vector<Reported> out = run(passes, packets);
+        print("interleaved", out);
+        check(out.size() == 2, "interleaved", "one crossing per racer");
+        if (out.size() == 2)
+        {
+            check(out[0].crossing.racerId == 1 && out[0].crossing.timestamp == T0 + 8000 &&
+                      out[0].crossing.reads == 9,
+                  "interleaved", "racer 1 first, its own median and reads");
+            check(out[1].crossing.racerId == 5 && out[1].crossing.timestamp == T0 + 13000 &&
+                      out[1].crossing.reads == 11,
+                  "interleaved", "racer 5 second, its own median and reads");
+        }
+    }
+
+    // minReads 2: a lone decode is dropped, a pair is kept
+    {
+        PassAggregator::Config strict = config;
+        strict.minReads = 2;
+        PassAggregator passes;
+        passes.configure(strict);
+        std::vector<Packet> packets;
+        packets.push_back({4, T0});
+        addRun(packets, 4, 300000, 302000, 2000);
+        std::vector<Reported> out = run(passes, packets);
+        print("min reads", out);
+        check(out.size() == 1 && out[0].crossing.reads == 2, "min reads", "lone decode dropped");
+        check(passes.rejected() == 1, "min reads", "dropped pass counted");
+    }
+
+    printf("%s\n", failures ? "FAIL" : "PASS: every scenario gave the expected crossings");
+    return failures ? 1 : 0;
+}
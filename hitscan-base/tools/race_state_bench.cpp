@@ -0,0 +1,167 @@
+// ============================================================================
+// Race state benchmark (host)
+// ============================================================================
+// Feeds thousands of synthetic lap-mode crossings (8 racers, ~30s laps with
+// some spread) into RaceState and into a model of the old vector-based
+// update() logic, and reports the cost per crossing as the session grows
+// plus heap allocations made after begin(). Also checks both ring-full
+// policies behave as documented.
+//
+// Build: g++ -std=c++17 -O2 -I../src race_state_bench.cpp -o race_state_bench
+// Usage: ./race_state_bench [crossings] [laps_per_racer]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "RaceState.hpp"
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    allocations++;
+    return malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+struct Crossing
+{
+    uint8_t racerId;
+    uint64_t timestamp;
+};
+
+// ---------------------------------------------------------------------------
+// Model of the old update(): vectors, reverse scan for the previous lap
+// ---------------------------------------------------------------------------
+struct LegacyLaps
+{
+    struct LapTime
+    {
+        uint8_t racerId;
+        uint64_t lapTime;
+        uint64_t timestamp;
+        uint8_t reads;
+    };
+
+    std::vector<LapTime> laps;
+    uint64_t fastestLap = UINT64_MAX;
+    uint64_t personalBest[8] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX,
+                                UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+
+    void record(uint8_t racerId, uint64_t timestamp)
+    {
+        uint64_t lapTime = timestamp;
+        for (int i = laps.size() - 1; i >= 0; i--)
+        {
+            if (laps[i].racerId == racerId)
+            {
+                lapTime = timestamp - laps[i].timestamp;
+                break;
+            }
+        }
+        if (lapTime < fastestLap && lapTime > 1000000)
+            fastestLap = lapTime;
+        if (lapTime < personalBest[racerId] && lapTime > 1000000)
+            personalBest[racerId] = lapTime;
+        laps.push_back({racerId, lapTime, timestamp, 1});
+    }
+};
+
+static std::vector<Crossing> synthesise(int count)
+{
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> lap(30e6, 3e6);
+    uint64_t next[8];
+    for (int r = 0; r < 8; r++)
+        next[r] = (uint64_t)(5e6 + r * 250e3);
+
+    std::vector<Crossing> crossings;
+    crossings.reserve(count);
+    while ((int)crossings.size() < count)
+    {
+        int r = 0;
+        for (int i = 1; i < 8; i++)
+            if (next[i] < next[r])
+                r = i;
+        crossings.push_back({(uint8_t)r, next[r]});
+        next[r] += (uint64_t)std::max(2e6, lap(rng));
+    }
+    return crossings;
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    RaceState::Config config;
+    if (argc > 2)
+        config.lapsPerRacer = atoi(argv[2]);
+
+    std::vector<Crossing> crossings = synthesise(count);
+    const int BLOCK = count / 10 > 0 ? count / 10 : 1;
+
+    RaceState state;
+    state.begin(config);
+    state.setMode(RaceState::Mode::LAP_TIMER);
+    LegacyLaps legacy;
+
+    printf("%d crossings, %u laps per racer (%zu KB lap store)\n\n", count, config.lapsPerRacer,
+           (size_t)config.lapsPerRacer * RaceState::MAX_RACERS * sizeof(RaceState::Lap) / 1024);
+    printf("%10s | %16s %12s | %16s %12s\n", "crossings", "RaceState ns/op", "allocs", "legacy ns/op", "allocs");
+
+    using Clock = std::chrono::steady_clock;
+    for (int from = 0; from < count; from += BLOCK)
+    {
+        int to = std::min(count, from + BLOCK);
+
+        size_t before = allocations;
+        Clock::time_point start = Clock::now();
+        for (int i = from; i < to; i++)
+            state.record(crossings[i].racerId, crossings[i].timestamp, 1);
+        double stateNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (to - from);
+        size_t stateAllocs = allocations - before;
+
+        before = allocations;
+        start = Clock::now();
+        for (int i = from; i < to; i++)
+            legacy.record(crossings[i].racerId, crossings[i].timestamp);
+        double legacyNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (to - from);
+        size_t legacyAllocs = allocations - before;
+
+        printf("%10d | %16.1f %12zu | %16.1f %12zu\n", to, stateNs, stateAllocs, legacyNs, legacyAllocs);
+    }
+
+    // Same answers as the old logic
+    bool same = state.fastestLap() == legacy.fastestLap;
+    for (uint8_t r = 0; r < RaceState::MAX_RACERS; r++)
+        same = same && state.personalBest(r) == legacy.personalBest[r];
+    printf("\nfastest/personal bests match legacy: %s\n", same ? "yes" : "NO");
+    printf("overwrite policy: %u laps overwritten, newest lap of racer 0 is #%u\n",
+           state.lapsOverwritten(), state.lap(0, state.lapCount(0) - 1).number);
+
+    RaceState rejecting;
+    config.whenFull = RaceState::FullPolicy::REJECT;
+    rejecting.begin(config);
+    rejecting.setMode(RaceState::Mode::LAP_TIMER);
+    for (const Crossing &c : crossings)
+        rejecting.record(c.racerId, c.timestamp, 1);
+    printf("reject policy:    %u laps rejected, newest lap of racer 0 is #%u\n",
+           rejecting.lapsRejected(), rejecting.lap(0, rejecting.lapCount(0) - 1).number);
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// ============================================================================
+// Race log to CSV (host)
+// ============================================================================
+// Converts the base station's binary race log (/races.bin on the SD card,
+// format in src/RaceLog.hpp) to CSV, one row per event. Lap times are
+// worked out here from each racer's previous crossing in the same race,
+// exactly as RaceState does.
+//
+// Build: g++ -std=c++17 -O2 -I../src racelog2csv.cpp -o racelog2csv
+// Usage: ./racelog2csv races.bin > races.csv
+
+#include <stdio.h>
+#include <string.h>
+#include "RaceLog.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s races.bin\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    RaceLog::Record record;
+    if (fread(&record, sizeof(record), 1, in) != 1 || record.type != RaceLog::Type::HEADER ||
+        record.raceNumber != RaceLog::MAGIC)
+    {
+        fprintf(stderr, "%s: not a race log\n", argv[1]);
+        return 1;
+    }
+    if (record.racerId != RaceLog::VERSION)
+        fprintf(stderr, "warning: log version %u, expected %u\n", record.racerId, RaceLog::VERSION);
+
+    uint64_t lastCrossing[256];
+    uint32_t currentRace = 0;
+    long rows = 0, skipped = 0;
+    memset(lastCrossing, 0xFF, sizeof(lastCrossing));
+
+    printf("race,event,racer,position,reads,time_us,lap_us,mode\n");
+    while (fread(&record, sizeof(record), 1, in) == 1)
+    {
+        switch (record.type)
+        {
+        case RaceLog::Type::PAD:
+            continue;
+
+        case RaceLog::Type::START:
+            currentRace = record.raceNumber;
+            memset(lastCrossing, 0xFF, sizeof(lastCrossing));
+            printf("%u,start,,,,0,,%s\n", record.raceNumber, record.position ? "lap" : "race");
+            break;
+
+        case RaceLog::Type::STOP:
+            printf("%u,stop,,,,%llu,,\n", record.raceNumber, (unsigned long long)record.timestamp);
+            break;
+
+        case RaceLog::Type::RESULT:
+            printf("%u,result,%u,%u,%u,%llu,,\n", record.raceNumber, record.racerId, record.position,
+                   record.reads, (unsigned long long)record.timestamp);
+            break;
+
+        case RaceLog::Type::LAP:
+        {
+            if (record.raceNumber != currentRace)
+            {
+                currentRace = record.raceNumber; // START record lost
+                memset(lastCrossing, 0xFF, sizeof(lastCrossing));
+            }
+            uint64_t &last = lastCrossing[record.racerId];
+            uint64_t lap = last == UINT64_MAX ? record.timestamp : record.timestamp - last;
+            last = record.timestamp;
+            printf("%u,lap,%u,,%u,%llu,%llu,\n", record.raceNumber, record.racerId, record.reads,
+                   (unsigned long long)record.timestamp, (unsigned long long)lap);
+            break;
+        }
+
+        default:
+            skipped++;
+            continue;
+        }
+        rows++;
+    }
+
+    fclose(in);
+    fprintf(stderr, "%ld events, %ld unknown records skipped\n", rows, skipped);
+    return 0;
+}
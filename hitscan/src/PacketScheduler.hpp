@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// Packet Scheduler
+// ============================================================================
+// Describes a racer ID packet as carrier bursts and gaps, and steps through
+// them one envelope edge at a time. No hardware access: the firmware's timer
+// interrupt asks for the next step, and a host build can print the same
+// sequence as a timing trace.
+//
+// Packets can be separated by a pseudo-random gap (ALOHA style) so two quads
+// crossing together do not overlap on every packet. The generator is seeded
+// from the racer ID, giving each transmitter a different sequence, and the
+// mean gap is set by a duty budget: the share of time spent sending packets.
+// The last symbol's value is in its gap, so a spaced packet ends with a stop
+// burst that closes that gap before the random silence starts.
+
+struct IRSymbol
+{
+  uint16_t burstUs; // Carrier on
+  uint16_t gapUs;   // Carrier off
+};
+
+// Standard encoding (v1/v2)
+#define IR_BURST_US 270
+#define IR_SYNC_GAP_US 900
+#define IR_ZERO_GAP_US 300
+#define IR_ONE_GAP_US 600
+
+// Compact (v3) encoding: a long marker burst, then two symbols whose gap
+// length carries 2 bits each, Gray coded so that neighbouring lengths differ
+// in one bit (a gap misread by one level then fails parity). Gaps stay
+// >= 300us and bursts >= 10 carrier cycles, within TSOP38x burst/gap minimums.
+#define IR_MARKER_BURST_US 540
+#define IR_COMPACT_GAP_BASE_US 300
+#define IR_COMPACT_GAP_STEP_US 150
+
+#define IR_MAX_SYMBOLS 5
+
+// Longest single step: TCB0 counts to 65535 at CLK_PER/2 (6.5ms at 20MHz),
+// longer gaps are split into several steps
+#define IR_MAX_STEP_US 6000
+
+// Duty budget limits - below 20% the gap range overflows the 16-bit scaling
+#define IR_MIN_DUTY_PERCENT 20
+#define IR_MAX_DUTY_PERCENT 100
+
+// Shortest silence after the stop burst (TSOP38x minimum gap)
+#define IR_PACKET_GAP_MIN_US 300
+
+// Even parity over the 3 ID bits
+inline uint8_t parity(uint8_t id)
+{
+  return ((id >> 2) ^ (id >> 1) ^ id) & 1;
+}
+
+// Compact gap carrying 2 bits: level 0-3 is their Gray code
+inline uint16_t compactGap(uint8_t value)
+{
+  return IR_COMPACT_GAP_BASE_US + (value ^ (value >> 1)) * IR_COMPACT_GAP_STEP_US;
+}
+
+// Fill symbols for one packet, returns the symbol count
+inline uint8_t encodePacket(uint8_t id, uint8_t version, IRSymbol *symbols)
+{
+  if (version == 3)
+  {
+    symbols[0] = {IR_MARKER_BURST_US, compactGap((id >> 1) & 3)};
+    symbols[1] = {IR_BURST_US, compactGap(((id & 1) << 1) | parity(id))};
+    return 2;
+  }
+
+  uint8_t count = 0;
+  symbols[count++] = {IR_BURST_US, IR_SYNC_GAP_US}; // Sync - unique long gap
+  for (int8_t bit = 2; bit >= 0; bit--)             // ID, MSB first
+    symbols[count++] = {IR_BURST_US, ((id >> bit) & 1) ? (uint16_t)IR_ONE_GAP_US : (uint16_t)IR_ZERO_GAP_US};
+  if (version == 2) // Check bit - base rejects packets that fail it
+    symbols[count++] = {IR_BURST_US, parity(id) ? (uint16_t)IR_ONE_GAP_US : (uint16_t)IR_ZERO_GAP_US};
+  return count;
+}
+
+class PacketScheduler
+{
+public:
+  struct Step
+  {
+    bool carrier;        // Carrier state to switch to now
+    uint16_t durationUs; // How long to hold it
+  };
+
+private:
+  IRSymbol symbols[IR_MAX_SYMBOLS];
+  uint8_t count = 0;
+  uint8_t index = 0; // == count: the stop burst
+  bool inBurst = false;
+  uint16_t random = 1;      // xorshift16 state, never 0
+  uint32_t gapSpreadUs = 0; // Inter-packet gap is uniform in [0, gapSpreadUs]
+  uint32_t holdUs = 0;      // Carrier-off time still to schedule
+
+  uint16_t nextRandom()
+  {
+    random ^= random << 7;
+    random ^= random >> 9;
+    random ^= random << 8;
+    return random;
+  }
+
+  Step off(uint32_t us)
+  {
+    holdUs = 0;
+    if (us > IR_MAX_STEP_US)
+    {
+      holdUs = us - IR_MAX_STEP_US;
+      us = IR_MAX_STEP_US;
+    }
+    return {false, (uint16_t)us};
+  }
+
+public:
+  // dutyPercent is the share of airtime spent sending packets; 100 sends
+  // them back to back. v1 packets are always back to back: the base only
+  // sees the end of a v1 packet when the next sync follows it.
+  void begin(uint8_t id, uint8_t version, uint8_t dutyPercent = IR_MAX_DUTY_PERCENT)
+  {
+    count = encodePacket(id, version, symbols);
+    index = 0;
+    inBurst = false;
+    holdUs = 0;
+    random = 0x9E37 * (uint16_t)(id + 1); // Odd multiplier: non-zero for every ID
+
+    if (dutyPercent < IR_MIN_DUTY_PERCENT)
+      dutyPercent = IR_MIN_DUTY_PERCENT;
+    if (dutyPercent >= IR_MAX_DUTY_PERCENT || version == 1)
+    {
+      gapSpreadUs = 0;
+      return;
+    }
+    uint32_t frameUs = packetUs() + IR_BURST_US + IR_PACKET_GAP_MIN_US;
+    gapSpreadUs = frameUs * (100 - dutyPercent) / dutyPercent * 2;
+  }
+
+  Step next()
+  {
+    if (holdUs)
+      return off(holdUs);
+
+    if (!inBurst)
+    {
+      inBurst = true;
+      return {true, index < count ? symbols[index].burstUs : (uint16_t)IR_BURST_US};
+    }
+
+    inBurst = false;
+    if (index == count) // After the stop burst
+    {
+      index = 0;
+      return off(IR_PACKET_GAP_MIN_US + (((uint32_t)nextRandom() * (gapSpreadUs + 1)) >> 16));
+    }
+
+    uint16_t gapUs = symbols[index].gapUs;
+    if (++index >= count && !gapSpreadUs)
+      index = 0;
+    return off(gapUs);
+  }
+
+  // True when the next step is the first burst of a packet
+  bool atPacketStart() const { return index == 0 && !inBurst && !holdUs; }
+
+  bool spaced() const { return gapSpreadUs != 0; }
+
+  uint8_t symbolCount() const { return count; }
+
+  // Airtime of one packet, without the stop burst and inter-packet gap
+  uint32_t packetUs() const
+  {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++)
+      total += symbols[i].burstUs + symbols[i].gapUs;
+    return total;
+  }
+};
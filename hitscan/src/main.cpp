@@ -1,74 +1,91 @@
 #include <Arduino.h>
+#include <avr/sleep.h>
+#include "PacketScheduler.hpp"
 
-#define IR_PIN1 1        // PA1
-#define IR_PIN2 2        // PA2
+#define IR_PIN1 1        // PA1 - TCA0 WO1
+#define IR_PIN2 2        // PA2 - TCA0 WO2
 #define STATUS_LED_PIN 3 // PA3
 #define RACER_ID 0       // ID 0 - 7
+#define PACKET_VERSION 3 // 1 = bare ID (original boards), 2 = ID + parity bit,
+                         // 3 = compact: ID + parity in ~half the airtime of v2.
+                         // Only compact fits a 200 km/h pass (3.6ms in a 200mm
+                         // cone); a v2 packet takes ~4.05ms
+#define PACKET_DUTY_PERCENT 100 // Share of airtime spent sending packets, the rest is
+                                // random ID-seeded gaps between them (100 = back to back)
 
-// 38kHz carrier: period = 26.3μs, half-period = 13.15μs
-// ATtiny402 typically runs at 20MHz by default
-// delayMicroseconds() handles the timing
-#define CARRIER_HALF_PERIOD 13
+// 38kHz carrier from TCA0 in single-slope PWM on WO1/WO2 (PA1/PA2):
+// period = F_CPU / 38000 = 526 clocks at 20MHz (38.02kHz), 50% duty.
+// Bursts and gaps are timed by TCB0 interrupts, so both are cycle-exact and
+// the CPU sleeps between envelope edges.
+#define CARRIER_HZ 38000
+#define CARRIER_PERIOD ((F_CPU / CARRIER_HZ) - 1)
+#define CARRIER_OUTPUTS (TCA_SINGLE_CMP1EN_bm | TCA_SINGLE_CMP2EN_bm)
 
-void setup()
-{
-  pinMode(IR_PIN1, OUTPUT);
-  pinMode(IR_PIN2, OUTPUT);
-  pinMode(STATUS_LED_PIN, OUTPUT);
+// TCB0 runs from CLK_PER/2
+#define ENVELOPE_TICKS_PER_US (F_CPU / 2000000UL)
 
-  digitalWrite(IR_PIN1, LOW);
-  digitalWrite(IR_PIN2, LOW);
-  digitalWrite(STATUS_LED_PIN, HIGH); //we booted and have power
-}
+#if defined(MILLIS_USE_TIMERA0) || defined(MILLIS_USE_TIMERB0)
+#error "TCA0/TCB0 drive the IR carrier - build with board_build.millistimer = NONE"
+#endif
 
+PacketScheduler scheduler;
 
-// Generate 38kHz carrier for specified microseconds
-void burstIR(uint16_t micros) {
-  uint16_t cycles = micros / 26; // ~38kHz cycles to generate
-
-  for(uint16_t i = 0; i < cycles; i++) {
-    digitalWrite(IR_PIN1, HIGH);
-    digitalWrite(IR_PIN2, HIGH);
-    delayMicroseconds(CARRIER_HALF_PERIOD);
-    digitalWrite(IR_PIN1, LOW);
-    digitalWrite(IR_PIN2, LOW);
-    delayMicroseconds(CARRIER_HALF_PERIOD);
-  }
+void carrierOn() {
+  TCA0.SINGLE.CNT = 0; // Every burst starts on a whole carrier cycle
+  TCA0.SINGLE.CTRLB |= CARRIER_OUTPUTS;
 }
 
-// Gap with no carrier
-void gapIR(uint16_t micros) {
-  digitalWrite(IR_PIN1, LOW);
-  digitalWrite(IR_PIN2, LOW);
-  delayMicroseconds(micros);
+// Pins fall back to PORT OUT (low) when the waveform outputs are disabled
+void carrierOff() {
+  TCA0.SINGLE.CTRLB &= ~CARRIER_OUTPUTS;
 }
 
-// Send sync burst (unique long gap)
-void sendSync() {
-  burstIR(270);  // Minimum safe burst
-  gapIR(900);    // Unique long gap - never in data
-}
+// Envelope edge: switch the carrier and arm the time until the next edge.
+// TCB0 restarted counting when it fired, so writing CCMP here sets the length
+// of the period already in progress - interrupt latency does not add up.
+ISR(TCB0_INT_vect) {
+  TCB0.INTFLAGS = TCB_CAPT_bm;
 
-// Send a data bit
-void sendBit(uint8_t bit) {
-  burstIR(270);  // Minimum burst
-  if(bit) {
-    gapIR(600);  // Long gap = 1
+  PacketScheduler::Step step = scheduler.next();
+  if (step.carrier) {
+    carrierOn();
   } else {
-    gapIR(300);  // Short gap = 0
+    carrierOff();
   }
+  TCB0.CCMP = step.durationUs * ENVELOPE_TICKS_PER_US - 1;
 }
 
-// Send complete racer ID packet
-void sendPacket(uint8_t id) {
-  sendSync();
-  sendBit((id >> 2) & 1);  // Bit 2 (MSB)
-  sendBit((id >> 1) & 1);  // Bit 1
-  sendBit(id & 1);          // Bit 0 (LSB)
-  // No inter-packet gap - continuous transmission
+void setup()
+{
+  pinMode(STATUS_LED_PIN, OUTPUT);
+  digitalWrite(STATUS_LED_PIN, HIGH); //we booted and have power
+
+  PORTA.OUTCLR = PIN1_bm | PIN2_bm;
+  PORTA.DIRSET = PIN1_bm | PIN2_bm;
+
+  scheduler.begin(RACER_ID, PACKET_VERSION, PACKET_DUTY_PERCENT);
+
+  // Carrier: TCA0 single-slope PWM, outputs left disabled until a burst
+  takeOverTCA0();
+  TCA0.SINGLE.CTRLA = 0;
+  TCA0.SINGLE.CTRLESET = TCA_SINGLE_CMD_RESET_gc;
+  TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc;
+  TCA0.SINGLE.PER = CARRIER_PERIOD;
+  TCA0.SINGLE.CMP1 = CARRIER_PERIOD / 2;
+  TCA0.SINGLE.CMP2 = CARRIER_PERIOD / 2;
+  TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+
+  // Envelope: TCB0 periodic interrupt, first edge shortly after start
+  TCB0.CTRLB = TCB_CNTMODE_INT_gc;
+  TCB0.CCMP = 100 * ENVELOPE_TICKS_PER_US;
+  TCB0.INTCTRL = TCB_CAPT_bm;
+  TCB0.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
 }
 
 void loop() {
-  // Continuously transmit racer ID back-to-back
-  sendPacket(RACER_ID);
-}
\ No newline at end of file
+  // Packets are transmitted from the TCB0 interrupt
+  sleep_cpu();
+}
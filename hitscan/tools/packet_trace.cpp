@@ -0,0 +1,50 @@
+// ============================================================================
+// Packet timing trace (host)
+// ============================================================================
+// Runs the firmware's PacketScheduler on a PC and prints every envelope edge
+// the TCB0 interrupt would program, as CSV:
+//
+//   time_us,carrier,duration_us,tcb_ticks
+//
+// tcb_ticks is the CCMP value written (CLK_PER/2 at 20MHz), so the trace
+// shows exactly what the timer will produce.
+//
+// Build: g++ -std=c++17 -O2 -I../src packet_trace.cpp -o packet_trace
+// Usage: ./packet_trace [racer_id] [packet_version] [packets] [duty_percent]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "PacketScheduler.hpp"
+
+static const unsigned long F_CPU_HZ = 20000000UL;
+static const unsigned long TICKS_PER_US = F_CPU_HZ / 2000000UL;
+
+int main(int argc, char **argv)
+{
+  uint8_t id = argc > 1 ? atoi(argv[1]) : 0;
+  uint8_t version = argc > 2 ? atoi(argv[2]) : 2;
+  int packets = argc > 3 ? atoi(argv[3]) : 2;
+  uint8_t duty = argc > 4 ? atoi(argv[4]) : IR_MAX_DUTY_PERCENT;
+
+  PacketScheduler scheduler;
+  scheduler.begin(id, version, duty);
+
+  unsigned long time = 0;
+  int sent = 0;
+
+  printf("time_us,carrier,duration_us,tcb_ticks\n");
+  while (!(scheduler.atPacketStart() && sent == packets))
+  {
+    if (scheduler.atPacketStart())
+      sent++;
+    PacketScheduler::Step step = scheduler.next();
+    printf("%lu,%d,%u,%lu\n", time, step.carrier ? 1 : 0, step.durationUs,
+           step.durationUs * TICKS_PER_US - 1);
+    time += step.durationUs;
+  }
+
+  fprintf(stderr, "racer %u, v%u: %d symbols, %.3f ms airtime, %.3f ms per packet at %u%% duty\n",
+          id, version, scheduler.symbolCount(), scheduler.packetUs() / 1000.0,
+          time / 1000.0 / packets, duty);
+  return 0;
+}